@@ -4,10 +4,12 @@ PKGCONFIG += nymea-gpio
 
 SOURCES += \
     integrationplugingpio.cpp \
-    gpiodescriptor.cpp
+    gpiodescriptor.cpp \
+    gpioedgecounter.cpp
 
 HEADERS += \
     integrationplugingpio.h \
-    gpiodescriptor.h
+    gpiodescriptor.h \
+    gpioedgecounter.h
 
 
@@ -0,0 +1,321 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "gpioedgecounter.h"
+#include "extern-plugininfo.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <linux/gpio.h>
+
+// Enough for several seconds of history at kHz rates
+static const int edgeBufferSize = 8192;
+
+GpioEdgeCounter::GpioEdgeCounter(int gpio, QObject *parent) :
+    QThread(parent),
+    m_gpio(gpio)
+{
+    m_edges.resize(edgeBufferSize);
+}
+
+GpioEdgeCounter::~GpioEdgeCounter()
+{
+    disable();
+}
+
+bool GpioEdgeCounter::isAvailable()
+{
+    QDir devDir("/dev");
+    return !devDir.entryList({"gpiochip*"}, QDir::System).isEmpty();
+}
+
+int GpioEdgeCounter::gpioNumber() const
+{
+    return m_gpio;
+}
+
+bool GpioEdgeCounter::enable(bool activeLow)
+{
+    if (m_lineFd >= 0)
+        return true;
+
+    QString chipDevice;
+    quint32 lineOffset = 0;
+    if (!findLine(m_gpio, &chipDevice, &lineOffset)) {
+        qCWarning(dcGpioController()) << "Could not find the GPIO chip for gpio" << m_gpio;
+        return false;
+    }
+
+    int chipFd = ::open(chipDevice.toUtf8().constData(), O_RDONLY | O_CLOEXEC);
+    if (chipFd < 0) {
+        qCWarning(dcGpioController()) << "Could not open" << chipDevice << strerror(errno);
+        return false;
+    }
+
+    struct gpioevent_request request;
+    memset(&request, 0, sizeof(request));
+    request.lineoffset = lineOffset;
+    request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    if (activeLow)
+        request.handleflags |= GPIOHANDLE_REQUEST_ACTIVE_LOW;
+
+    // The active low flag swaps the edges, so rising always means "becomes active"
+    request.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+    strncpy(request.consumer_label, "nymea-counter", sizeof(request.consumer_label) - 1);
+
+    int result = ioctl(chipFd, GPIO_GET_LINEEVENT_IOCTL, &request);
+    ::close(chipFd);
+    if (result < 0) {
+        qCWarning(dcGpioController()) << "Could not request line events for" << chipDevice << "line" << lineOffset << strerror(errno);
+        return false;
+    }
+
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_wakeFd < 0) {
+        qCWarning(dcGpioController()) << "Could not create wake up eventfd" << strerror(errno);
+        ::close(request.fd);
+        return false;
+    }
+
+    m_lineFd = request.fd;
+
+    QMutexLocker locker(&m_mutex);
+    m_head = 0;
+    m_count = 0;
+    m_total = 0;
+    m_lastEdge = 0;
+    m_timestampClockDetected = false;
+    locker.unlock();
+
+    qCDebug(dcGpioController()) << "Counting edges of gpio" << m_gpio << "on" << chipDevice << "line" << lineOffset;
+    start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void GpioEdgeCounter::disable()
+{
+    if (m_lineFd < 0)
+        return;
+
+    quint64 wake = 1;
+    if (::write(m_wakeFd, &wake, sizeof(wake)) < 0)
+        qCWarning(dcGpioController()) << "Could not wake up edge reader thread" << strerror(errno);
+
+    wait();
+
+    ::close(m_lineFd);
+    ::close(m_wakeFd);
+    m_lineFd = -1;
+    m_wakeFd = -1;
+}
+
+void GpioEdgeCounter::setDebounceTime(int debounceTime)
+{
+    m_debounceTime.storeRelease(qMax(0, debounceTime));
+}
+
+GpioEdgeCounter::Statistics GpioEdgeCounter::statistics(int window) const
+{
+    Statistics statistics;
+
+    QMutexLocker locker(&m_mutex);
+    statistics.total = m_total;
+    if (m_count == 0)
+        return statistics;
+
+    quint64 now = currentTime();
+    quint64 newest = m_edges.at((m_head - 1 + edgeBufferSize) % edgeBufferSize);
+    quint64 sinceNewest = now > newest ? now - newest : 0;
+    if (m_count >= 2) {
+        quint64 previous = m_edges.at((m_head - 2 + edgeBufferSize) % edgeBufferSize);
+        statistics.pulseInterval = (newest - previous) / 1e9;
+    }
+
+    // Walk back over the edges within the window
+    quint64 windowStart = now - qMin<quint64>(now, static_cast<quint64>(window) * 1000000);
+    quint64 oldest = newest;
+    int edgesInWindow = 0;
+    for (int i = 0; i < m_count; i++) {
+        quint64 timestamp = m_edges.at((m_head - 1 - i + edgeBufferSize) % edgeBufferSize);
+        if (timestamp < windowStart)
+            break;
+
+        oldest = timestamp;
+        edgesInWindow++;
+    }
+    locker.unlock();
+
+    // Measure whole periods between the first and last edge in the window. For slow pulse
+    // trains fall back to the last pulse interval. In both cases a silence longer than the
+    // measured period bounds the rate, so it decays when the pulses stop.
+    double period = 0;
+    if (edgesInWindow >= 2) {
+        period = (newest - oldest) / 1e9 / (edgesInWindow - 1);
+    } else {
+        period = statistics.pulseInterval;
+    }
+
+    if (period > 0)
+        statistics.frequency = 1 / qMax(period, sinceNewest / 1e9);
+
+    return statistics;
+}
+
+void GpioEdgeCounter::run()
+{
+    struct pollfd fds[2];
+    fds[0].fd = m_lineFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeFd;
+    fds[1].events = POLLIN;
+
+    // The kernel buffers only a few events per line, so drain as many as available per read
+    struct gpioevent_data events[64];
+
+    forever {
+        int result = poll(fds, 2, -1);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+
+            qCWarning(dcGpioController()) << "Polling gpio" << m_gpio << "failed" << strerror(errno);
+            break;
+        }
+
+        if (fds[1].revents)
+            break;
+
+        if (fds[0].revents & (POLLERR | POLLHUP)) {
+            qCWarning(dcGpioController()) << "Line event handle for gpio" << m_gpio << "closed by the kernel";
+            break;
+        }
+
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        ssize_t length = ::read(m_lineFd, events, sizeof(events));
+        if (length < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+
+            qCWarning(dcGpioController()) << "Reading line events of gpio" << m_gpio << "failed" << strerror(errno);
+            break;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        for (size_t i = 0; i < length / sizeof(struct gpioevent_data); i++) {
+            processEdge(events[i].timestamp);
+        }
+    }
+}
+
+bool GpioEdgeCounter::findLine(int gpio, QString *chipDevice, quint32 *lineOffset)
+{
+    // Map the global sysfs gpio number to a chip and line offset using the base of each chip
+    QDir gpioClassDir("/sys/class/gpio");
+    foreach (const QString &chipName, gpioClassDir.entryList({"gpiochip*"}, QDir::Dirs | QDir::System)) {
+        QFile baseFile(gpioClassDir.filePath(chipName + "/base"));
+        QFile ngpioFile(gpioClassDir.filePath(chipName + "/ngpio"));
+        if (!baseFile.open(QIODevice::ReadOnly) || !ngpioFile.open(QIODevice::ReadOnly))
+            continue;
+
+        int base = baseFile.readAll().trimmed().toInt();
+        int ngpio = ngpioFile.readAll().trimmed().toInt();
+        if (gpio < base || gpio >= base + ngpio)
+            continue;
+
+        // The character device is a sibling node below the same parent device
+        QDir deviceDir(gpioClassDir.filePath(chipName + "/device"));
+        QStringList devices = deviceDir.entryList({"gpiochip*"}, QDir::Dirs | QDir::System);
+        devices.removeAll(chipName);
+        if (devices.count() != 1)
+            continue;
+
+        *chipDevice = "/dev/" + devices.first();
+        *lineOffset = static_cast<quint32>(gpio - base);
+        return true;
+    }
+
+    // Without sysfs chip information assume the numbering of the first chip, as on the Raspberry Pi
+    int chipFd = ::open("/dev/gpiochip0", O_RDONLY | O_CLOEXEC);
+    if (chipFd < 0)
+        return false;
+
+    struct gpiochip_info info;
+    int result = ioctl(chipFd, GPIO_GET_CHIPINFO_IOCTL, &info);
+    ::close(chipFd);
+    if (result < 0 || gpio < 0 || static_cast<quint32>(gpio) >= info.lines)
+        return false;
+
+    *chipDevice = "/dev/gpiochip0";
+    *lineOffset = static_cast<quint32>(gpio);
+    return true;
+}
+
+void GpioEdgeCounter::processEdge(quint64 timestamp)
+{
+    // Kernels before 5.7 stamp line events with CLOCK_REALTIME instead of CLOCK_MONOTONIC
+    if (!m_timestampClockDetected) {
+        struct timespec monotonic;
+        struct timespec realtime;
+        clock_gettime(CLOCK_MONOTONIC, &monotonic);
+        clock_gettime(CLOCK_REALTIME, &realtime);
+        qint64 monotonicDistance = qAbs(static_cast<qint64>(timestamp - (monotonic.tv_sec * 1000000000ull + monotonic.tv_nsec)));
+        qint64 realtimeDistance = qAbs(static_cast<qint64>(timestamp - (realtime.tv_sec * 1000000000ull + realtime.tv_nsec)));
+        m_realtimeTimestamps = realtimeDistance < monotonicDistance;
+        m_timestampClockDetected = true;
+    }
+
+    quint64 debounceTime = static_cast<quint64>(m_debounceTime.loadAcquire()) * 1000000;
+    if (m_total > 0 && timestamp - m_lastEdge < debounceTime)
+        return;
+
+    m_lastEdge = timestamp;
+    m_total++;
+    m_edges[m_head] = timestamp;
+    m_head = (m_head + 1) % edgeBufferSize;
+    m_count = qMin(m_count + 1, edgeBufferSize);
+}
+
+quint64 GpioEdgeCounter::currentTime() const
+{
+    struct timespec now;
+    clock_gettime(m_realtimeTimestamps ? CLOCK_REALTIME : CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef GPIOEDGECOUNTER_H
+#define GPIOEDGECOUNTER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <QAtomicInt>
+
+// Counts edges of an input line using the GPIO character device line event interface.
+// Edges are read in a dedicated thread and carry the kernel timestamp of the interrupt,
+// so the main event loop latency has no influence on counting or on the derived rates.
+class GpioEdgeCounter : public QThread
+{
+    Q_OBJECT
+public:
+    struct Statistics {
+        quint64 total = 0;          // Debounced edge count since enable()
+        double frequency = 0;       // Edges per second
+        double pulseInterval = 0;   // Seconds between the last two edges, 0 if unknown
+    };
+
+    explicit GpioEdgeCounter(int gpio, QObject *parent = nullptr);
+    ~GpioEdgeCounter() override;
+
+    static bool isAvailable();
+
+    int gpioNumber() const;
+
+    bool enable(bool activeLow);
+    void disable();
+
+    // Edges closer to the previously accepted edge than this are dropped
+    void setDebounceTime(int debounceTime);
+
+    Statistics statistics(int window = 1000) const;
+
+protected:
+    void run() override;
+
+private:
+    static bool findLine(int gpio, QString *chipDevice, quint32 *lineOffset);
+    void processEdge(quint64 timestamp);
+    quint64 currentTime() const;
+
+    int m_gpio = -1;
+    int m_lineFd = -1;
+    int m_wakeFd = -1;
+    QAtomicInt m_debounceTime;
+
+    mutable QMutex m_mutex;
+    QVector<quint64> m_edges;
+    int m_head = 0;
+    int m_count = 0;
+    quint64 m_total = 0;
+    quint64 m_lastEdge = 0;
+    bool m_realtimeTimestamps = false;
+    bool m_timestampClockDetected = false;
+};
+
+#endif // GPIOEDGECOUNTER_H
@@ -266,8 +266,35 @@ void IntegrationPluginGpio::setupThing(ThingSetupInfo *info)
 
     // Counter
     if (thing->thingClassId() == counterRpiThingClassId || thing->thingClassId() == counterBbbThingClassId) {
-        GpioMonitor *monitor = new GpioMonitor(thing->paramValue(m_gpioParamTypeIds.value(thing->thingClassId())).toInt(), this);
+        int gpioNumber = thing->paramValue(m_gpioParamTypeIds.value(thing->thingClassId())).toInt();
         bool activeLow = thing->paramValue(m_activeLowParamTypeIds.value(thing->thingClassId())).toBool();
+
+        // Prefer kernel timestamped line events, the sysfs monitor loses pulses at higher rates
+        if (GpioEdgeCounter::isAvailable()) {
+            GpioEdgeCounter *edgeCounter = new GpioEdgeCounter(gpioNumber, this);
+            if (thing->thingClassId() == counterRpiThingClassId) {
+                edgeCounter->setDebounceTime(thing->setting(counterRpiSettingsDebounceTimeParamTypeId).toInt());
+            } else if (thing->thingClassId() == counterBbbThingClassId) {
+                edgeCounter->setDebounceTime(thing->setting(counterBbbSettingsDebounceTimeParamTypeId).toInt());
+            }
+
+            if (edgeCounter->enable(activeLow)) {
+                connect(thing, &Thing::settingChanged, edgeCounter, [edgeCounter](const ParamTypeId &paramTypeId, const QVariant &value){
+                    if (paramTypeId == counterRpiSettingsDebounceTimeParamTypeId || paramTypeId == counterBbbSettingsDebounceTimeParamTypeId) {
+                        edgeCounter->setDebounceTime(value.toInt());
+                    }
+                });
+
+                m_edgeCounterDevices.insert(edgeCounter, thing);
+                m_counterTotals.insert(thing->id(), 0);
+                return info->finish(Thing::ThingErrorNoError);
+            }
+
+            qCWarning(dcGpioController()) << "Could not enable edge counter for thing" << thing->name() << "falling back to the gpio monitor";
+            delete edgeCounter;
+        }
+
+        GpioMonitor *monitor = new GpioMonitor(gpioNumber, this);
         if (!monitor->enable(activeLow)) {
             qCWarning(dcGpioController()) << "Could not enable gpio monitor for thing" << thing->name();
             monitor->deleteLater();
@@ -409,14 +436,8 @@ void IntegrationPluginGpio::postSetupThing(Thing *thing)
             m_counterTimer = hardwareManager()->pluginTimerManager()->registerTimer(1);
             connect(m_counterTimer, &PluginTimer::timeout, this, [this](){
                 foreach (Thing *thing, myThings()) {
-                    if (thing->thingClassId() == counterRpiThingClassId) {
-                        int counterValue = m_counterValues.value(thing->id());
-                        thing->setStateValue(counterRpiCounterStateTypeId, counterValue);
-                        m_counterValues[thing->id()] = 0;
-                    }
-                    if (thing->thingClassId() == counterBbbThingClassId) {
-                        int counterValue = m_counterValues.value(thing->id());
-                        thing->setStateValue(counterBbbCounterStateTypeId, counterValue);
+                    if (thing->thingClassId() == counterRpiThingClassId || thing->thingClassId() == counterBbbThingClassId) {
+                        updateCounter(thing);
                     }
                 }
             });
@@ -477,16 +498,63 @@ void IntegrationPluginGpio::thingRemoved(Thing *thing)
         delete button;
     }
 
+    GpioEdgeCounter *edgeCounter = m_edgeCounterDevices.key(thing);
+    if (edgeCounter) {
+        m_edgeCounterDevices.remove(edgeCounter);
+        delete edgeCounter;
+    }
+
     if (m_counterValues.contains(thing->id())) {
         m_counterValues.remove(thing->id());
     }
 
+    m_counterTotals.remove(thing->id());
+
     if (myThings().filterByThingClassId(counterRpiThingClassId).isEmpty() && myThings().filterByThingClassId(counterBbbThingClassId).isEmpty()) {
         hardwareManager()->pluginTimerManager()->unregisterTimer(m_counterTimer);
         m_counterTimer = nullptr;
     }
 }
 
+void IntegrationPluginGpio::updateCounter(Thing *thing)
+{
+    // Pulses since the last update and the current pulse rate
+    quint64 pulses = 0;
+    double frequency = 0;
+    GpioEdgeCounter *edgeCounter = m_edgeCounterDevices.key(thing);
+    if (edgeCounter) {
+        GpioEdgeCounter::Statistics statistics = edgeCounter->statistics();
+        pulses = statistics.total - m_counterTotals.value(thing->id());
+        frequency = statistics.frequency;
+        m_counterTotals[thing->id()] = statistics.total;
+    } else {
+        pulses = static_cast<quint64>(m_counterValues.value(thing->id()));
+        frequency = pulses;
+        m_counterValues[thing->id()] = 0;
+    }
+
+    // Totals accumulate on the cached states so they survive restarts and impulse rate changes
+    if (thing->thingClassId() == counterRpiThingClassId) {
+        uint impulsesPerKwh = qMax(1u, thing->setting(counterRpiSettingsImpulsesPerKwhParamTypeId).toUInt());
+        thing->setStateValue(counterRpiCounterStateTypeId, static_cast<int>(pulses));
+        thing->setStateValue(counterRpiFrequencyStateTypeId, frequency);
+        thing->setStateValue(counterRpiCurrentPowerStateTypeId, frequency * 3600000 / impulsesPerKwh);
+        thing->setStateValue(counterRpiTotalCountStateTypeId, thing->stateValue(counterRpiTotalCountStateTypeId).toUInt() + static_cast<uint>(pulses));
+        if (pulses > 0) {
+            thing->setStateValue(counterRpiTotalEnergyConsumedStateTypeId, thing->stateValue(counterRpiTotalEnergyConsumedStateTypeId).toDouble() + static_cast<double>(pulses) / impulsesPerKwh);
+        }
+    } else if (thing->thingClassId() == counterBbbThingClassId) {
+        uint impulsesPerKwh = qMax(1u, thing->setting(counterBbbSettingsImpulsesPerKwhParamTypeId).toUInt());
+        thing->setStateValue(counterBbbCounterStateTypeId, static_cast<int>(pulses));
+        thing->setStateValue(counterBbbFrequencyStateTypeId, frequency);
+        thing->setStateValue(counterBbbCurrentPowerStateTypeId, frequency * 3600000 / impulsesPerKwh);
+        thing->setStateValue(counterBbbTotalCountStateTypeId, thing->stateValue(counterBbbTotalCountStateTypeId).toUInt() + static_cast<uint>(pulses));
+        if (pulses > 0) {
+            thing->setStateValue(counterBbbTotalEnergyConsumedStateTypeId, thing->stateValue(counterBbbTotalEnergyConsumedStateTypeId).toDouble() + static_cast<double>(pulses) / impulsesPerKwh);
+        }
+    }
+}
+
 void IntegrationPluginGpio::executeAction(ThingActionInfo *info)
 {
     Thing *thing = info->thing();
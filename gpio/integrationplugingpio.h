@@ -34,6 +34,7 @@
 #include "integrations/integrationplugin.h"
 #include "plugintimer.h"
 #include "gpiodescriptor.h"
+#include "gpioedgecounter.h"
 
 // libnymea-gpio
 #include <gpio.h>
@@ -65,6 +66,7 @@ private:
     QHash<Gpio *, Thing *> m_gpioDevices;
     QHash<GpioMonitor *, Thing *> m_monitorDevices;
     QHash<GpioButton *, Thing *> m_buttonDevices;
+    QHash<GpioEdgeCounter *, Thing *> m_edgeCounterDevices;
 
     QHash<int, Gpio *> m_raspberryPiGpios;
     QHash<int, GpioMonitor *> m_raspberryPiGpioMoniors;
@@ -78,6 +80,9 @@ private:
     QList<GpioDescriptor> beagleboneBlackGpioDescriptors();
     PluginTimer *m_counterTimer = nullptr;
     QHash<ThingId, int> m_counterValues;
+    QHash<ThingId, quint64> m_counterTotals;
+
+    void updateCounter(Thing *thing);
 
 };
 
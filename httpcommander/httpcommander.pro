@@ -6,10 +6,14 @@ TARGET = $$qtLibraryTarget(nymea_integrationpluginhttpcommander)
 
 SOURCES += \
     integrationpluginhttpcommander.cpp \
-    httpsimpleserver.cpp
+    httpsimpleserver.cpp \
+    httprequestparser.cpp \
+    httprequestqueue.cpp
 
 HEADERS += \
     integrationpluginhttpcommander.h \
-    httpsimpleserver.h
+    httpsimpleserver.h \
+    httprequestparser.h \
+    httprequestqueue.h
 
 
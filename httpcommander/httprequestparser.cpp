@@ -0,0 +1,280 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "httprequestparser.h"
+
+bool HttpRequestParser::Request::keepAlive() const
+{
+    QByteArray connection = headers.value("connection").toLower();
+    if (version == "HTTP/1.0")
+        return connection.contains("keep-alive");
+
+    return !connection.contains("close");
+}
+
+HttpRequestParser::HttpRequestParser(int maxHeaderSize, int maxBodySize) :
+    m_maxHeaderSize(maxHeaderSize),
+    m_maxBodySize(maxBodySize)
+{
+
+}
+
+HttpRequestParser::Result HttpRequestParser::parse(QByteArray *buffer)
+{
+    int offset = 0;
+    QByteArray line;
+
+    forever {
+        switch (m_state) {
+        case StateRequestLine:
+            if (!takeLine(buffer, &offset, &line))
+                break;
+
+            // Empty lines before the request line are allowed
+            if (line.isEmpty())
+                continue;
+
+            if (!parseRequestLine(line))
+                return fail(400);
+
+            m_state = StateHeaders;
+            continue;
+        case StateHeaders:
+            if (!takeLine(buffer, &offset, &line))
+                break;
+
+            if (line.isEmpty()) {
+                if (headersComplete() == ResultError)
+                    return ResultError;
+
+                continue;
+            }
+
+            if (!parseHeaderLine(line))
+                return fail(400);
+
+            continue;
+        case StateBody:
+        case StateChunkData: {
+            qint64 length = qMin<qint64>(buffer->size() - offset, m_remaining);
+            m_request.body.append(buffer->constData() + offset, static_cast<int>(length));
+            offset += static_cast<int>(length);
+            m_remaining -= length;
+            if (m_remaining > 0)
+                break;
+
+            m_state = m_state == StateBody ? StateComplete : StateChunkDataEnd;
+            continue;
+        }
+        case StateChunkSize: {
+            if (!takeLine(buffer, &offset, &line))
+                break;
+
+            // Chunk extensions are ignored
+            int extension = line.indexOf(';');
+            bool ok = false;
+            qint64 chunkSize = line.left(extension).trimmed().toLongLong(&ok, 16);
+            if (!ok || chunkSize < 0)
+                return fail(400);
+
+            if (chunkSize == 0) {
+                m_state = StateTrailers;
+                continue;
+            }
+
+            if (m_request.body.size() + chunkSize > m_maxBodySize)
+                return fail(413);
+
+            m_remaining = chunkSize;
+            m_state = StateChunkData;
+            continue;
+        }
+        case StateChunkDataEnd:
+            if (!takeLine(buffer, &offset, &line))
+                break;
+
+            if (!line.isEmpty())
+                return fail(400);
+
+            m_state = StateChunkSize;
+            continue;
+        case StateTrailers:
+            // Trailer fields are not used, only check their size
+            if (!takeLine(buffer, &offset, &line))
+                break;
+
+            if (line.isEmpty())
+                m_state = StateComplete;
+
+            continue;
+        case StateComplete:
+            buffer->remove(0, offset);
+            return ResultRequestComplete;
+        case StateError:
+            return ResultError;
+        }
+
+        // Waiting for more data, unless a line exceeded its size limit
+        break;
+    }
+
+    if (m_state == StateError)
+        return ResultError;
+
+    buffer->remove(0, offset);
+    return ResultNeedMoreData;
+}
+
+void HttpRequestParser::reset()
+{
+    m_state = StateRequestLine;
+    m_request = Request();
+    m_headerSize = 0;
+    m_remaining = 0;
+    m_errorStatusCode = 0;
+}
+
+HttpRequestParser::State HttpRequestParser::state() const
+{
+    return m_state;
+}
+
+const HttpRequestParser::Request &HttpRequestParser::request() const
+{
+    return m_request;
+}
+
+int HttpRequestParser::errorStatusCode() const
+{
+    return m_errorStatusCode;
+}
+
+bool HttpRequestParser::expectsContinue() const
+{
+    return (m_state == StateBody || m_state == StateChunkSize)
+            && m_request.body.isEmpty()
+            && m_request.headers.value("expect").toLower() == "100-continue";
+}
+
+bool HttpRequestParser::takeLine(QByteArray *buffer, int *offset, QByteArray *line)
+{
+    bool headerLine = m_state == StateRequestLine || m_state == StateHeaders || m_state == StateTrailers;
+    int start = *offset;
+    int end = buffer->indexOf('\n', start);
+    if (end < 0) {
+        // Limit the length of incomplete lines, chunk size lines are short anyways
+        int pending = buffer->size() - start;
+        if (pending > (headerLine ? m_maxHeaderSize - m_headerSize : 1024))
+            fail(headerLine ? 431 : 400);
+
+        return false;
+    }
+
+    if (headerLine) {
+        m_headerSize += end + 1 - start;
+        if (m_headerSize > m_maxHeaderSize) {
+            fail(431);
+            return false;
+        }
+    }
+
+    int length = end - start;
+    if (length > 0 && buffer->at(end - 1) == '\r')
+        length--;
+
+    *line = buffer->mid(start, length);
+    *offset = end + 1;
+    return true;
+}
+
+HttpRequestParser::Result HttpRequestParser::fail(int statusCode)
+{
+    m_state = StateError;
+    m_errorStatusCode = statusCode;
+    return ResultError;
+}
+
+bool HttpRequestParser::parseRequestLine(const QByteArray &line)
+{
+    QList<QByteArray> tokens = line.split(' ');
+    if (tokens.count() != 3 || tokens.at(0).isEmpty() || tokens.at(1).isEmpty() || !tokens.at(2).startsWith("HTTP/1."))
+        return false;
+
+    m_request.method = tokens.at(0);
+    m_request.target = tokens.at(1);
+    m_request.version = tokens.at(2);
+    return true;
+}
+
+bool HttpRequestParser::parseHeaderLine(const QByteArray &line)
+{
+    // Obsolete line folding and fields without name are rejected
+    int colon = line.indexOf(':');
+    if (colon <= 0 || line.at(0) == ' ' || line.at(0) == '\t')
+        return false;
+
+    QByteArray name = line.left(colon).trimmed().toLower();
+    QByteArray value = line.mid(colon + 1).trimmed();
+    if (m_request.headers.contains(name)) {
+        m_request.headers[name] += ", " + value;
+    } else {
+        m_request.headers.insert(name, value);
+    }
+    return true;
+}
+
+HttpRequestParser::Result HttpRequestParser::headersComplete()
+{
+    // Transfer-Encoding overrides Content-Length
+    if (m_request.headers.value("transfer-encoding").toLower().contains("chunked")) {
+        m_state = StateChunkSize;
+        return ResultNeedMoreData;
+    }
+
+    if (m_request.headers.contains("content-length")) {
+        bool ok = false;
+        qint64 contentLength = m_request.headers.value("content-length").toLongLong(&ok);
+        if (!ok || contentLength < 0)
+            return fail(400);
+
+        if (contentLength > m_maxBodySize)
+            return fail(413);
+
+        if (contentLength > 0) {
+            m_request.body.reserve(static_cast<int>(contentLength));
+            m_remaining = contentLength;
+            m_state = StateBody;
+            return ResultNeedMoreData;
+        }
+    }
+
+    m_state = StateComplete;
+    return ResultRequestComplete;
+}
@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HTTPREQUESTPARSER_H
+#define HTTPREQUESTPARSER_H
+
+#include <QByteArray>
+#include <QHash>
+
+// Incremental HTTP/1.1 request parser. Data can arrive in arbitrary segments, the parser consumes
+// the bytes of one request from the front of the buffer and leaves pipelined requests in place.
+class HttpRequestParser
+{
+public:
+    enum State {
+        StateRequestLine,
+        StateHeaders,
+        StateBody,
+        StateChunkSize,
+        StateChunkData,
+        StateChunkDataEnd,
+        StateTrailers,
+        StateComplete,
+        StateError
+    };
+
+    enum Result {
+        ResultNeedMoreData,
+        ResultRequestComplete,
+        ResultError
+    };
+
+    struct Request {
+        QByteArray method;
+        QByteArray target;
+        QByteArray version;
+        QHash<QByteArray, QByteArray> headers; // Lower case names
+        QByteArray body;
+
+        bool keepAlive() const;
+    };
+
+    HttpRequestParser(int maxHeaderSize = 16384, int maxBodySize = 1048576);
+
+    // Consumes data from the front of buffer. On ResultRequestComplete the request is available
+    // until reset() is called, on ResultError the status code to answer is available.
+    Result parse(QByteArray *buffer);
+    void reset();
+
+    State state() const;
+    const Request &request() const;
+    int errorStatusCode() const;
+
+    // The headers are complete and the client waits for "100 Continue" before sending the body
+    bool expectsContinue() const;
+
+private:
+    int m_maxHeaderSize = 0;
+    int m_maxBodySize = 0;
+
+    State m_state = StateRequestLine;
+    Request m_request;
+    int m_headerSize = 0;
+    qint64 m_remaining = 0;
+    int m_errorStatusCode = 0;
+
+    bool takeLine(QByteArray *buffer, int *offset, QByteArray *line);
+    Result fail(int statusCode);
+    bool parseRequestLine(const QByteArray &line);
+    bool parseHeaderLine(const QByteArray &line);
+    Result headersComplete();
+};
+
+#endif // HTTPREQUESTPARSER_H
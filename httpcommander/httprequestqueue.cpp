@@ -0,0 +1,236 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "httprequestqueue.h"
+#include "extern-plugininfo.h"
+
+#include "network/networkaccessmanager.h"
+
+#include <QNetworkRequest>
+
+HttpQueuedReply::HttpQueuedReply(const QByteArray &method, const QUrl &url, const QByteArray &body, QObject *parent) :
+    QObject(parent),
+    m_method(method),
+    m_url(url),
+    m_body(body)
+{
+
+}
+
+QByteArray HttpQueuedReply::method() const
+{
+    return m_method;
+}
+
+QUrl HttpQueuedReply::url() const
+{
+    return m_url;
+}
+
+QByteArray HttpQueuedReply::body() const
+{
+    return m_body;
+}
+
+int HttpQueuedReply::statusCode() const
+{
+    return m_statusCode;
+}
+
+QByteArray HttpQueuedReply::data() const
+{
+    return m_data;
+}
+
+QNetworkReply::NetworkError HttpQueuedReply::error() const
+{
+    return m_error;
+}
+
+QString HttpQueuedReply::errorString() const
+{
+    return m_errorString;
+}
+
+bool HttpQueuedReply::timedOut() const
+{
+    return m_timedOut;
+}
+
+HttpRequestQueue::HttpRequestQueue(NetworkAccessManager *networkManager, QObject *parent) :
+    QObject(parent),
+    m_networkManager(networkManager)
+{
+
+}
+
+HttpRequestQueue::~HttpRequestQueue()
+{
+    // Replies of the network manager outlive this queue, make sure they don't call back
+    foreach (QNetworkReply *reply, m_running.keys()) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+int HttpRequestQueue::maxRequests() const
+{
+    return m_maxRequests;
+}
+
+void HttpRequestQueue::setMaxRequests(int maxRequests)
+{
+    m_maxRequests = qMax(1, maxRequests);
+    sendNext();
+}
+
+int HttpRequestQueue::timeout() const
+{
+    return m_timeout;
+}
+
+void HttpRequestQueue::setTimeout(int timeout)
+{
+    m_timeout = timeout;
+}
+
+int HttpRequestQueue::maxQueueLength() const
+{
+    return m_maxQueueLength;
+}
+
+void HttpRequestQueue::setMaxQueueLength(int maxQueueLength)
+{
+    m_maxQueueLength = maxQueueLength;
+}
+
+bool HttpRequestQueue::isSupportedMethod(const QByteArray &method)
+{
+    return method == "GET" || method == "POST" || method == "PUT" || method == "DELETE";
+}
+
+HttpQueuedReply *HttpRequestQueue::enqueue(const QByteArray &method, const QUrl &url, const QByteArray &body)
+{
+    if (!isSupportedMethod(method)) {
+        qCWarning(dcHttpCommander()) << "Unsupported HTTP method" << method;
+        return nullptr;
+    }
+
+    // Only idempotent reads may share a reply, every write has to reach the target
+    foreach (HttpQueuedReply *queuedReply, m_pending) {
+        if (method == "GET" && queuedReply->method() == method && queuedReply->url() == url && queuedReply->body() == body) {
+            qCDebug(dcHttpCommander()) << "Coalescing request" << method << url.toString() << "with pending request";
+            return queuedReply;
+        }
+    }
+
+    if (m_pending.count() >= m_maxQueueLength) {
+        qCWarning(dcHttpCommander()) << "Request queue for" << url.host() << "is full, dropping request" << method << url.toString();
+        return nullptr;
+    }
+
+    HttpQueuedReply *queuedReply = new HttpQueuedReply(method, url, body, this);
+    m_pending.append(queuedReply);
+    sendNext();
+    return queuedReply;
+}
+
+int HttpRequestQueue::pendingCount() const
+{
+    return m_pending.count();
+}
+
+int HttpRequestQueue::runningCount() const
+{
+    return m_running.count();
+}
+
+void HttpRequestQueue::sendNext()
+{
+    while (m_running.count() < m_maxRequests && !m_pending.isEmpty()) {
+        HttpQueuedReply *queuedReply = m_pending.takeFirst();
+
+        QNetworkRequest request(queuedReply->url());
+        request.setRawHeader("Connection", "keep-alive");
+
+        QNetworkReply *reply = nullptr;
+        if (queuedReply->method() == "GET") {
+            reply = m_networkManager->get(request);
+        } else if (queuedReply->method() == "POST") {
+            reply = m_networkManager->post(request, queuedReply->body());
+        } else if (queuedReply->method() == "PUT") {
+            reply = m_networkManager->put(request, queuedReply->body());
+        } else {
+            reply = m_networkManager->deleteResource(request);
+        }
+        m_running.insert(reply, queuedReply);
+
+        QTimer *timer = nullptr;
+        if (m_timeout > 0) {
+            timer = new QTimer(this);
+            timer->setSingleShot(true);
+            connect(timer, &QTimer::timeout, reply, [reply, queuedReply](){
+                qCWarning(dcHttpCommander()) << "Request" << queuedReply->method() << queuedReply->url().toString() << "timed out";
+                queuedReply->m_timedOut = true;
+                reply->abort();
+            });
+            timer->start(m_timeout);
+        }
+        connect(reply, &QNetworkReply::finished, this, [this, reply, timer](){
+            onReplyFinished(reply, timer);
+        });
+    }
+}
+
+void HttpRequestQueue::onReplyFinished(QNetworkReply *reply, QTimer *timer)
+{
+    HttpQueuedReply *queuedReply = m_running.take(reply);
+    if (timer) {
+        timer->stop();
+        timer->deleteLater();
+    }
+
+    reply->deleteLater();
+    if (!queuedReply)
+        return;
+
+    queuedReply->m_statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    queuedReply->m_data = reply->readAll();
+    queuedReply->m_error = reply->error();
+    queuedReply->m_errorString = queuedReply->m_timedOut ? QStringLiteral("Request timed out") : reply->errorString();
+
+    // Free the slot before notifying, so a request enqueued in response is queued behind the waiting ones
+    sendNext();
+
+    emit requestFinished(queuedReply);
+    emit queuedReply->finished();
+    queuedReply->deleteLater();
+}
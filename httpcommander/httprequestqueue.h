@@ -0,0 +1,125 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HTTPREQUESTQUEUE_H
+#define HTTPREQUESTQUEUE_H
+
+#include <QObject>
+#include <QUrl>
+#include <QList>
+#include <QHash>
+#include <QTimer>
+#include <QNetworkReply>
+
+class NetworkAccessManager;
+
+// Result of a queued request. Identical GET requests waiting in the queue share one HttpQueuedReply,
+// it emits finished() once and deletes itself afterwards.
+class HttpQueuedReply : public QObject
+{
+    Q_OBJECT
+    friend class HttpRequestQueue;
+
+public:
+    QByteArray method() const;
+    QUrl url() const;
+    QByteArray body() const;
+
+    int statusCode() const;
+    QByteArray data() const;
+    QNetworkReply::NetworkError error() const;
+    QString errorString() const;
+    bool timedOut() const;
+
+signals:
+    void finished();
+
+private:
+    explicit HttpQueuedReply(const QByteArray &method, const QUrl &url, const QByteArray &body, QObject *parent);
+
+    QByteArray m_method;
+    QUrl m_url;
+    QByteArray m_body;
+
+    int m_statusCode = 0;
+    QByteArray m_data;
+    QNetworkReply::NetworkError m_error = QNetworkReply::NoError;
+    QString m_errorString;
+    bool m_timedOut = false;
+};
+
+// Request queue for one target. At most maxRequests requests are sent at the same time, further
+// requests wait in order. All requests share the network access manager, which keeps the
+// connections to the target alive and reuses them for the next request.
+class HttpRequestQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HttpRequestQueue(NetworkAccessManager *networkManager, QObject *parent = nullptr);
+    ~HttpRequestQueue() override;
+
+    int maxRequests() const;
+    void setMaxRequests(int maxRequests);
+
+    // Milliseconds until a sent request gets aborted
+    int timeout() const;
+    void setTimeout(int timeout);
+
+    int maxQueueLength() const;
+    void setMaxQueueLength(int maxQueueLength);
+
+    static bool isSupportedMethod(const QByteArray &method);
+
+    // Returns nullptr if the method is not supported or the queue is full. An identical GET request
+    // which has not been sent yet is reused instead of queueing the request a second time.
+    HttpQueuedReply *enqueue(const QByteArray &method, const QUrl &url, const QByteArray &body = QByteArray());
+
+    int pendingCount() const;
+    int runningCount() const;
+
+signals:
+    // Emitted once per sent request, before the reply emits finished()
+    void requestFinished(HttpQueuedReply *reply);
+
+private:
+    NetworkAccessManager *m_networkManager = nullptr;
+    int m_maxRequests = 1;
+    int m_timeout = 10000;
+    int m_maxQueueLength = 64;
+
+    QList<HttpQueuedReply *> m_pending;
+    QHash<QNetworkReply *, HttpQueuedReply *> m_running;
+
+    void sendNext();
+    void onReplyFinished(QNetworkReply *reply, QTimer *timer);
+};
+
+#endif // HTTPREQUESTQUEUE_H
@@ -37,9 +37,15 @@
 #include <QDebug>
 #include <QDateTime>
 #include <QUrlQuery>
-#include <QRegExp>
 #include <QStringList>
 
+// Persistent connections are closed after this time without a request
+static const int idleTimeout = 30000;
+
+// Limits per request, the connection buffer never holds more than one request head
+static const int maxHeaderSize = 16384;
+static const int maxBodySize = 1048576;
+
 HttpSimpleServer::HttpSimpleServer(quint16 port, QObject *parent):
     QTcpServer(parent)
 {
@@ -49,6 +55,7 @@ HttpSimpleServer::HttpSimpleServer(quint16 port, QObject *parent):
 HttpSimpleServer::~HttpSimpleServer()
 {
     close();
+    qDeleteAll(m_connections);
 }
 
 void HttpSimpleServer::incomingConnection(qintptr socket)
@@ -62,34 +69,65 @@ void HttpSimpleServer::incomingConnection(qintptr socket)
     connect(tcpSocket, SIGNAL(disconnected()), this, SLOT(discardClient()));
     tcpSocket->setSocketDescriptor(socket);
 
+    Connection *connection = new Connection();
+    connection->parser = HttpRequestParser(maxHeaderSize, maxBodySize);
+    connection->idleTimer = new QTimer(tcpSocket);
+    connection->idleTimer->setSingleShot(true);
+    connection->idleTimer->setInterval(idleTimeout);
+    connect(connection->idleTimer, &QTimer::timeout, tcpSocket, [tcpSocket](){
+        qCDebug(dcHttpCommander()) << "Closing idle connection from" << tcpSocket->peerAddress().toString();
+        tcpSocket->disconnectFromHost();
+    });
+    connection->idleTimer->start();
+    m_connections.insert(tcpSocket, connection);
 }
 
 void HttpSimpleServer::readClient()
 {
-    // This slot is called when the client sent data to the server. The
-    // server looks if it was a get request and sends a very simple HTML
-    // document back.
+    // This slot is called when the client sent data to the server. The data
+    // is parsed incrementally, a request may arrive in several segments and
+    // several pipelined requests may arrive in one segment.
     QTcpSocket* tcpSocket = static_cast<QTcpSocket*>(sender());
-    if (tcpSocket->canReadLine()) {
+    Connection *connection = m_connections.value(tcpSocket);
+    if (!connection)
+        return;
 
-        QByteArray data = tcpSocket->readAll();
-        QStringList tokens = QString(data).split(QRegExp("[ \r\n][ \r\n]*"));
-        qCDebug(dcHttpCommander()) << "Http Request, type" << tokens[0] << "path" << tokens[1] << "body" << tokens.last();
+    if (connection->closing) {
+        tcpSocket->readAll();
+        return;
+    }
 
-        if ((tokens[0] == "GET")      ||
-                (tokens[0] == "PUT")  ||
-                (tokens[0] == "POST") ||
-                (tokens[0] == "DELETE")) {
+    connection->idleTimer->start();
 
-            QTextStream os(tcpSocket);
-            os.setAutoDetectUnicode(true);
-            os << generateHeader();
-            tcpSocket->close();
+    while (tcpSocket->bytesAvailable() > 0) {
+        // The parser consumes the body while reading, so only an incomplete request head can remain buffered
+        connection->buffer.append(tcpSocket->read(maxHeaderSize + maxBodySize - connection->buffer.size()));
 
-            if (tcpSocket->state() == QTcpSocket::UnconnectedState)
-                delete tcpSocket;
+        forever {
+            HttpRequestParser::Result result = connection->parser.parse(&connection->buffer);
+            if (result == HttpRequestParser::ResultError) {
+                int statusCode = connection->parser.errorStatusCode();
+                qCWarning(dcHttpCommander()) << "Invalid HTTP request from" << tcpSocket->peerAddress().toString() << statusCode;
+                tcpSocket->write(generateHeader(statusCode, false));
+                closeConnection(tcpSocket, connection);
+                return;
+            }
 
-            emit requestReceived(tokens[0], tokens[1], tokens.last());
+            if (result == HttpRequestParser::ResultNeedMoreData)
+                break;
+
+            bool keepAlive = processRequest(tcpSocket, connection->parser.request());
+            connection->parser.reset();
+            connection->continueSent = false;
+            if (!keepAlive) {
+                closeConnection(tcpSocket, connection);
+                return;
+            }
+        }
+
+        if (connection->parser.expectsContinue() && !connection->continueSent) {
+            tcpSocket->write("HTTP/1.1 100 Continue\r\n\r\n");
+            connection->continueSent = true;
         }
     }
 }
@@ -97,15 +135,67 @@ void HttpSimpleServer::readClient()
 void HttpSimpleServer::discardClient()
 {
     QTcpSocket* socket = static_cast<QTcpSocket*>(sender());
+    delete m_connections.take(socket);
     socket->deleteLater();
 }
 
-QString HttpSimpleServer::generateHeader()
+void HttpSimpleServer::closeConnection(QTcpSocket *socket, Connection *connection)
+{
+    // Drop anything buffered or still arriving, it must not be parsed again
+    connection->closing = true;
+    connection->buffer.clear();
+    connection->parser.reset();
+    socket->readAll();
+    socket->disconnectFromHost();
+}
+
+bool HttpSimpleServer::processRequest(QTcpSocket *socket, const HttpRequestParser::Request &request)
 {
-    QString contentHeader(
-                "HTTP/1.0 200 Ok\r\n"
-                "Content-Type: text/html; charset=\"utf-8\"\r\n"
-                "\r\n"
-                );
+    QString type = QString::fromUtf8(request.method);
+    QString path = QString::fromUtf8(request.target);
+    QString body = QString::fromUtf8(request.body);
+    qCDebug(dcHttpCommander()) << "Http Request, type" << type << "path" << path << "body" << body;
+
+    bool keepAlive = request.keepAlive();
+    if (type != "GET" && type != "PUT" && type != "POST" && type != "DELETE") {
+        socket->write(generateHeader(405, keepAlive));
+        return keepAlive;
+    }
+
+    socket->write(generateHeader(200, keepAlive));
+    emit requestReceived(type, path, body);
+    return keepAlive;
+}
+
+QByteArray HttpSimpleServer::generateHeader(int statusCode, bool keepAlive)
+{
+    QByteArray reasonPhrase;
+    switch (statusCode) {
+    case 200:
+        reasonPhrase = "OK";
+        break;
+    case 400:
+        reasonPhrase = "Bad Request";
+        break;
+    case 405:
+        reasonPhrase = "Method Not Allowed";
+        break;
+    case 413:
+        reasonPhrase = "Payload Too Large";
+        break;
+    case 431:
+        reasonPhrase = "Request Header Fields Too Large";
+        break;
+    default:
+        reasonPhrase = "Error";
+        break;
+    }
+
+    QByteArray contentHeader =
+            "HTTP/1.1 " + QByteArray::number(statusCode) + " " + reasonPhrase + "\r\n"
+            "Content-Type: text/html; charset=\"utf-8\"\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n"
+            "\r\n";
     return contentHeader;
 }
@@ -32,8 +32,12 @@
 #define HTTPSIMPLESERVER1_H
 
 #include "typeutils.h"
+#include "httprequestparser.h"
 
 #include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QHash>
 #include <QUuid>
 #include <QDateTime>
 #include <QUrl>
@@ -62,7 +66,19 @@ private slots:
     void discardClient();
 
 private:
-    QString generateHeader();
+    struct Connection {
+        HttpRequestParser parser;
+        QByteArray buffer;
+        QTimer *idleTimer = nullptr;
+        bool continueSent = false;
+        bool closing = false; // The last response was sent, further data is discarded
+    };
+
+    QHash<QTcpSocket *, Connection *> m_connections;
+
+    bool processRequest(QTcpSocket *socket, const HttpRequestParser::Request &request);
+    QByteArray generateHeader(int statusCode, bool keepAlive);
+    void closeConnection(QTcpSocket *socket, Connection *connection);
 
 };
 
@@ -32,6 +32,10 @@
 #include "network/networkaccessmanager.h"
 #include "plugininfo.h"
 #include <QNetworkInterface>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRegularExpression>
 
 IntegrationPluginHttpCommander::IntegrationPluginHttpCommander()
 {
@@ -51,6 +55,43 @@ void IntegrationPluginHttpCommander::setupThing(ThingSetupInfo *info)
             //: Error setting up thing
             return info->finish(Thing::ThingErrorInvalidParameter, QT_TR_NOOP("The given url is not valid."));
         }
+
+        HttpRequestQueue *requestQueue = new HttpRequestQueue(hardwareManager()->networkManager(), this);
+        requestQueue->setMaxRequests(thing->setting(httpRequestSettingsMaxRequestsParamTypeId).toInt());
+        requestQueue->setTimeout(thing->setting(httpRequestSettingsTimeoutParamTypeId).toInt() * 1000);
+        m_requestQueues.insert(thing, requestQueue);
+
+        connect(requestQueue, &HttpRequestQueue::requestFinished, thing, [this, thing](HttpQueuedReply *reply){
+            qCDebug(dcHttpCommander()) << reply->method() << "reply finished" << reply->statusCode();
+            thing->setStateValue(httpRequestResponseStateTypeId, reply->data());
+            thing->setStateValue(httpRequestStatusStateTypeId, reply->statusCode());
+
+            // Check HTTP status code
+            if (reply->statusCode() != 200 || reply->error() != QNetworkReply::NoError) {
+                qCWarning(dcHttpCommander()) << "Request error:" << reply->statusCode() << reply->errorString();
+                return;
+            }
+
+            QString expression = thing->setting(httpRequestSettingsExtractionParamTypeId).toString();
+            if (!expression.isEmpty()) {
+                QString value = extractValue(reply->data(), expression);
+                if (!value.isNull()) {
+                    thing->setStateValue(httpRequestValueStateTypeId, value);
+                }
+            }
+        });
+
+        connect(thing, &Thing::settingChanged, requestQueue, [this, thing, requestQueue](const ParamTypeId &paramTypeId, const QVariant &value){
+            if (paramTypeId == httpRequestSettingsMaxRequestsParamTypeId) {
+                requestQueue->setMaxRequests(value.toInt());
+            } else if (paramTypeId == httpRequestSettingsTimeoutParamTypeId) {
+                requestQueue->setTimeout(value.toInt() * 1000);
+            } else if (paramTypeId == httpRequestSettingsPollIntervalParamTypeId) {
+                updatePollTimer(thing);
+            }
+        });
+
+        updatePollTimer(thing);
         return info->finish(Thing::ThingErrorNoError);
     }
 
@@ -73,42 +114,31 @@ void IntegrationPluginHttpCommander::executeAction(ThingActionInfo *info)
     if (thing->thingClassId() == httpRequestThingClassId) {
 
         if (action.actionTypeId() == httpRequestRequestActionTypeId) {
-            QUrl url = thing->paramValue(httpRequestThingUrlParamTypeId).toUrl();
-            url.setPort(thing->paramValue(httpRequestThingPortParamTypeId).toInt());
-            QString method = action.param(httpRequestRequestActionMethodParamTypeId).value().toString();
+            QByteArray method = action.param(httpRequestRequestActionMethodParamTypeId).value().toByteArray();
             QByteArray payload = action.param(httpRequestRequestActionBodyParamTypeId).value().toByteArray();
-
-            QNetworkReply *reply = nullptr;
-            if (method == "GET") {
-                reply = hardwareManager()->networkManager()->get(QNetworkRequest(url));
-            } else if (method == "POST") {
-                reply = hardwareManager()->networkManager()->post(QNetworkRequest(url), payload);
-            } else if (method == "PUT") {
-                reply = hardwareManager()->networkManager()->put(QNetworkRequest(url), payload);
-            } else if (method == "DELETE") {
-                reply = hardwareManager()->networkManager()->deleteResource(QNetworkRequest(url));
-            } else {
+            if (!HttpRequestQueue::isSupportedMethod(method)) {
                 qCWarning(dcHttpCommander()) << "Unsupported HTTP method" << method;
-                info->finish(Thing::ThingErrorInvalidParameter);
+                //: Error executing action
+                info->finish(Thing::ThingErrorInvalidParameter, QT_TR_NOOP("Unsupported HTTP method."));
                 return;
             }
-            connect(reply, &QNetworkReply::finished, this, [thing, reply, this](){
-
-                qDebug(dcHttpCommander()) << "POST reply finished";
-                QByteArray data = reply->readAll();
-                int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
-                thing->setStateValue(httpRequestResponseStateTypeId, data);
-                thing->setStateValue(httpRequestStatusStateTypeId, status);
+            HttpQueuedReply *reply = sendRequest(thing, method, payload);
+            if (!reply) {
+                //: Error executing action
+                info->finish(Thing::ThingErrorHardwareNotAvailable, QT_TR_NOOP("Too many requests are pending."));
+                return;
+            }
 
-                // Check HTTP status code
-                if (status != 200 || reply->error() != QNetworkReply::NoError) {
-                    qCWarning(dcHttpCommander()) << "Request error:" << status << reply->errorString();
+            // Requests are sent in order, the action finishes as soon as its request got an answer
+            connect(reply, &HttpQueuedReply::finished, info, [info, reply](){
+                if (reply->timedOut() || reply->statusCode() == 0) {
+                    info->finish(Thing::ThingErrorHardwareNotAvailable, reply->errorString());
+                    return;
                 }
-                reply->deleteLater();
+                info->finish(Thing::ThingErrorNoError);
             });
-
-            return info->finish(Thing::ThingErrorNoError);
+            return;
         }
         return info->finish(Thing::ThingErrorActionTypeNotFound);
     }
@@ -132,8 +162,105 @@ void IntegrationPluginHttpCommander::onHttpSimpleServerRequestReceived(const QSt
 
 void IntegrationPluginHttpCommander::thingRemoved(Thing *thing)
 {
+    if (thing->thingClassId() == httpRequestThingClassId) {
+        delete m_pollTimers.take(thing);
+        HttpRequestQueue *requestQueue = m_requestQueues.take(thing);
+        if (requestQueue)
+            requestQueue->deleteLater();
+    }
+
     if (thing->thingClassId() == httpServerThingClassId) {
         HttpSimpleServer* httpSimpleServer= m_httpSimpleServer.take(thing);
         httpSimpleServer->deleteLater();
     }
 }
+
+QUrl IntegrationPluginHttpCommander::requestUrl(Thing *thing) const
+{
+    QUrl url = thing->paramValue(httpRequestThingUrlParamTypeId).toUrl();
+    url.setPort(thing->paramValue(httpRequestThingPortParamTypeId).toInt());
+    return url;
+}
+
+HttpQueuedReply *IntegrationPluginHttpCommander::sendRequest(Thing *thing, const QByteArray &method, const QByteArray &body)
+{
+    HttpRequestQueue *requestQueue = m_requestQueues.value(thing);
+    if (!requestQueue)
+        return nullptr;
+
+    return requestQueue->enqueue(method, requestUrl(thing), body);
+}
+
+void IntegrationPluginHttpCommander::updatePollTimer(Thing *thing)
+{
+    uint interval = thing->setting(httpRequestSettingsPollIntervalParamTypeId).toUInt();
+    if (interval == 0) {
+        delete m_pollTimers.take(thing);
+        return;
+    }
+
+    QTimer *timer = m_pollTimers.value(thing);
+    if (!timer) {
+        timer = new QTimer(this);
+        connect(timer, &QTimer::timeout, thing, [this, thing](){
+            // A poll still waiting in the queue gets coalesced with this one
+            sendRequest(thing, "GET", QByteArray());
+        });
+        m_pollTimers.insert(thing, timer);
+    }
+    qCDebug(dcHttpCommander()) << "Polling" << requestUrl(thing).toString() << "every" << interval << "seconds";
+    timer->start(interval * 1000);
+}
+
+QString IntegrationPluginHttpCommander::extractValue(const QByteArray &data, const QString &expression) const
+{
+    // JSON pointer (RFC 6901), e.g. "/sensors/0/temperature"
+    if (expression.startsWith('/')) {
+        QJsonParseError error;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(data, &error);
+        if (error.error != QJsonParseError::NoError) {
+            qCWarning(dcHttpCommander()) << "Response is not valid JSON:" << error.errorString();
+            return QString();
+        }
+
+        QJsonValue value = jsonDoc.isArray() ? QJsonValue(jsonDoc.array()) : QJsonValue(jsonDoc.object());
+        foreach (QString token, expression.mid(1).split('/')) {
+            token.replace("~1", "/").replace("~0", "~");
+            if (value.isObject() && value.toObject().contains(token)) {
+                value = value.toObject().value(token);
+            } else if (value.isArray()) {
+                bool ok = false;
+                int index = token.toInt(&ok);
+                if (!ok || index < 0 || index >= value.toArray().count()) {
+                    qCDebug(dcHttpCommander()) << "JSON pointer" << expression << "does not match the response";
+                    return QString();
+                }
+                value = value.toArray().at(index);
+            } else {
+                qCDebug(dcHttpCommander()) << "JSON pointer" << expression << "does not match the response";
+                return QString();
+            }
+        }
+
+        if (value.isObject())
+            return QString::fromUtf8(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+        if (value.isArray())
+            return QString::fromUtf8(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+        if (value.isNull())
+            return QString("");
+        return value.toVariant().toString();
+    }
+
+    // Regular expression, the first capture group or the whole match is the value
+    QRegularExpression regExp(expression);
+    if (!regExp.isValid()) {
+        qCWarning(dcHttpCommander()) << "Invalid regular expression" << expression << regExp.errorString();
+        return QString();
+    }
+    QRegularExpressionMatch match = regExp.match(QString::fromUtf8(data));
+    if (!match.hasMatch()) {
+        qCDebug(dcHttpCommander()) << "Regular expression" << expression << "does not match the response";
+        return QString();
+    }
+    return match.captured(regExp.captureCount() > 0 ? 1 : 0);
+}
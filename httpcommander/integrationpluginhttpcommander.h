@@ -34,6 +34,7 @@
 #include "integrations/integrationplugin.h"
 #include "plugintimer.h"
 #include "httpsimpleserver.h"
+#include "httprequestqueue.h"
 
 #include <QNetworkReply>
 #include <QHostInfo>
@@ -55,6 +56,13 @@ public:
 
 private:
     QHash<Thing *, HttpSimpleServer *> m_httpSimpleServer;
+    QHash<Thing *, HttpRequestQueue *> m_requestQueues;
+    QHash<Thing *, QTimer *> m_pollTimers;
+
+    QUrl requestUrl(Thing *thing) const;
+    HttpQueuedReply *sendRequest(Thing *thing, const QByteArray &method, const QByteArray &body);
+    void updatePollTimer(Thing *thing);
+    QString extractValue(const QByteArray &data, const QString &expression) const;
 
 private slots:
     void onHttpSimpleServerRequestReceived(const QString &type, const QString &path, const QString &body);
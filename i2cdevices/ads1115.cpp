@@ -0,0 +1,185 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#include "ads1115.h"
+#include "extern-plugininfo.h"
+
+#include <QDataStream>
+#include <QVector>
+
+#include <unistd.h>
+
+#define REGISTER_CONVERSION 0x00
+#define REGISTER_CONFIG     0x01
+
+// Config register, high byte
+#define OPERATIONAL_STATUS_START  0x80
+#define MULTIPLEXER_SINGLE_ENDED  0x40
+#define DEVICE_MODE_SINGLE_SHOT   0x01
+
+// Config register, low byte
+#define COMPARATOR_DISABLED       0x03
+
+static const QList<uint> dataRates = {8, 16, 32, 64, 128, 250, 475, 860};
+
+ADS1115::ADS1115(const QString &portName, int address, Gain gain, QObject *parent):
+    I2CDevice(portName, address, parent),
+    m_gain(gain)
+{
+
+}
+
+void ADS1115::setDataRate(uint dataRate)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!dataRates.contains(dataRate)) {
+        qCWarning(dcI2cDevices()) << "ADS1115: unsupported data rate" << dataRate;
+        return;
+    }
+    m_dataRate = dataRate;
+}
+
+void ADS1115::setOversampling(uint oversampling)
+{
+    QMutexLocker locker(&m_mutex);
+    m_oversampling = qMax(1u, oversampling);
+}
+
+void ADS1115::setChannelCount(int channelCount)
+{
+    QMutexLocker locker(&m_mutex);
+    m_channelCount = qBound(1, channelCount, 4);
+}
+
+QByteArray ADS1115::readData(int fd)
+{
+    m_mutex.lock();
+    quint8 dataRateCode = static_cast<quint8>(dataRates.indexOf(m_dataRate));
+    uint oversampling = m_oversampling;
+    int channelCount = m_channelCount;
+    m_mutex.unlock();
+
+    // The internal oscillator may be up to 10% slow, plus some time for the wake up from power down
+    uint conversionTime = 1100000 / dataRates.at(dataRateCode) + 100;
+
+    QVector<qint64> sums(channelCount, 0);
+    QVector<bool> overvoltage(channelCount, false);
+
+    // Interleave the channels so the averaged samples spread over the whole scan
+    for (uint sample = 0; sample < oversampling; sample++) {
+        for (int channel = 0; channel < channelCount; channel++) {
+            qint16 value = 0;
+            if (!convert(fd, channel, dataRateCode, conversionTime, &value))
+                return QByteArray();
+
+            sums[channel] += value;
+            if (value == 0x7FFF)
+                overvoltage[channel] = true;
+        }
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << static_cast<quint8>(channelCount);
+    for (int channel = 0; channel < channelCount; channel++) {
+        double average = static_cast<double>(sums.at(channel)) / oversampling;
+        stream << static_cast<quint8>(channel) << average / 32768 << overvoltage.at(channel);
+    }
+    return data;
+}
+
+QList<ADS1115::ChannelReading> ADS1115::parseReading(const QByteArray &data)
+{
+    QList<ChannelReading> readings;
+    QDataStream stream(data);
+    quint8 channelCount = 0;
+    stream >> channelCount;
+    for (int i = 0; i < channelCount && stream.status() == QDataStream::Ok; i++) {
+        quint8 channel = 0;
+        ChannelReading reading;
+        stream >> channel >> reading.value >> reading.overvoltage;
+        reading.channel = channel;
+        readings.append(reading);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+        return QList<ChannelReading>();
+
+    return readings;
+}
+
+bool ADS1115::convert(int fd, int channel, quint8 dataRateCode, uint conversionTime, qint16 *value)
+{
+    // Start a single shot conversion on the selected input
+    unsigned char writeBuf[3] = {0};
+    writeBuf[0] = REGISTER_CONFIG;
+    writeBuf[1] = OPERATIONAL_STATUS_START | MULTIPLEXER_SINGLE_ENDED | static_cast<unsigned char>(channel << 4) | static_cast<unsigned char>(m_gain << 1) | DEVICE_MODE_SINGLE_SHOT;
+    writeBuf[2] = static_cast<unsigned char>(dataRateCode << 5) | COMPARATOR_DISABLED;
+    if (write(fd, writeBuf, 3) != 3) {
+        qCWarning(dcI2cDevices()) << "ADS1115: could not write config register";
+        return false;
+    }
+
+    usleep(conversionTime);
+
+    // The pointer still selects the config register, so verify the conversion finished. This
+    // only loops if the oscillator is even slower than specified.
+    unsigned char readBuf[2] = {0};
+    for (int retry = 0; ; retry++) {
+        if (read(fd, readBuf, 2) != 2) {
+            qCWarning(dcI2cDevices()) << "ADS1115: could not read config register";
+            return false;
+        }
+
+        if (readBuf[0] & OPERATIONAL_STATUS_START)
+            break;
+
+        if (retry >= 4) {
+            qCWarning(dcI2cDevices()) << "ADS1115: conversion did not finish in time";
+            return false;
+        }
+        usleep(conversionTime / 4);
+    }
+
+    writeBuf[0] = REGISTER_CONVERSION;
+    if (write(fd, writeBuf, 1) != 1) {
+        qCWarning(dcI2cDevices()) << "ADS1115: could not write select register";
+        return false;
+    }
+
+    if (read(fd, readBuf, 2) != 2) {
+        qCWarning(dcI2cDevices()) << "ADS1115: could not read ADC data";
+        return false;
+    }
+
+    *value = static_cast<qint16>((readBuf[0] << 8) | readBuf[1]);
+    return true;
+}
@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef ADS1115_H
+#define ADS1115_H
+
+#include <QMutex>
+#include <QList>
+
+#include <hardware/i2c/i2cdevice.h>
+
+// Scans the single ended inputs of one ADS1113/ADS1114/ADS1115 chip. All channels are sequenced
+// through the input multiplexer within one readData() call, waiting for the conversion time
+// derived from the data rate instead of polling the busy bit.
+class ADS1115: public I2CDevice
+{
+    Q_OBJECT
+public:
+
+    enum Gain {
+        Gain_6_144 = 0,
+        Gain_4_096 = 1,
+        Gain_2_048 = 2,
+        Gain_1_024 = 3,
+        Gain_0_512 = 4,
+        Gain_0_256 = 5
+    };
+
+    struct ChannelReading {
+        int channel = 0;
+        double value = 0;           // Normalized to the full scale of the gain
+        bool overvoltage = false;
+    };
+
+    explicit ADS1115(const QString &portName, int address, Gain gain, QObject *parent = nullptr);
+
+    // Samples per second, one of 8, 16, 32, 64, 128, 250, 475 and 860
+    void setDataRate(uint dataRate);
+
+    // Conversions averaged per channel and reading
+    void setOversampling(uint oversampling);
+
+    // Number of inputs scanned, starting with AIN0
+    void setChannelCount(int channelCount);
+
+    QByteArray readData(int fd) override;
+
+    static QList<ChannelReading> parseReading(const QByteArray &data);
+
+private:
+    bool convert(int fd, int channel, quint8 dataRateCode, uint conversionTime, qint16 *value);
+
+    Gain m_gain = Gain_4_096;
+
+    QMutex m_mutex;
+    uint m_dataRate = 128;
+    uint m_oversampling = 1;
+    int m_channelCount = 4;
+
+};
+
+#endif // ADS1115_H
@@ -3,12 +3,12 @@ include(../plugins.pri)
 HEADERS += \
     ina219.h \
     integrationplugini2cdevices.h \
-    ads1115channel.h \
+    ads1115.h \
     pi16adcchannel.h
 
 
 SOURCES += \
     ina219.cpp \
     integrationplugini2cdevices.cpp \
-    ads1115channel.cpp \
+    ads1115.cpp \
     pi16adcchannel.cpp
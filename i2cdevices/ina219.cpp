@@ -1,10 +1,14 @@
 #include "ina219.h"
 
 #include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
 #include <QtDebug>
 #include <QThread>
 #include <QDebug>
-#include <QJsonDocument>
 
 #include "extern-plugininfo.h"
 
@@ -28,6 +32,7 @@
 #define CURRENT_LSB_FACTOR 32800
 
 #define OVERFLOW_VALUE 1
+#define CONVERSION_READY_VALUE 2
 
 #define INA219_CONFIG_BIT_RST   15
 #define INA219_CONFIG_BIT_BRNG  13
@@ -54,6 +59,11 @@ Ina219::Ina219(const QString &portName, int address, double shuntOhms, VoltageRa
 
 }
 
+void Ina219::setAveraging(uint samples)
+{
+    m_averaging = qBound(1u, samples, 128u);
+}
+
 bool Ina219::writeData(int fileDescriptor, const QByteArray &data)
 {
     Q_UNUSED(data)
@@ -95,8 +105,8 @@ bool Ina219::writeData(int fileDescriptor, const QByteArray &data)
     // Configuration
     quint16 configuration = m_voltageRange << INA219_CONFIG_BIT_BRNG;
     configuration |= m_gainVolts << INA219_CONFIG_BIT_PG0;
-    configuration |= m_busADC << INA219_CONFIG_BIT_BADC1;
-    configuration |= m_shuntADC << INA219_CONFIG_BIT_SADC1;
+    configuration |= adcSetting(m_busADC) << INA219_CONFIG_BIT_BADC1;
+    configuration |= adcSetting(m_shuntADC) << INA219_CONFIG_BIT_SADC1;
     configuration |= m_operationMode;
     buf[0] = INA219_REGISTER_CONFIGURATION;
     buf[1] = configuration >> 8;
@@ -113,75 +123,127 @@ bool Ina219::writeData(int fileDescriptor, const QByteArray &data)
 
 QByteArray Ina219::readData(int fileDescriptor)
 {
-    char buf[2] = {0};
-
-    buf[0] = INA219_REGISTER_SHUNT_VOLTAGE;
-    int ret = write(fileDescriptor, buf, 1);
-    if (ret != 1) {
-        qCWarning(dcI2cDevices()) << "Failed to select shunt voltage register on INA219";
-        return QByteArray();
+    // The power register is read last, which clears the conversion ready flag for the next cycle
+    const quint8 registers[4] = {INA219_REGISTER_SHUNT_VOLTAGE, INA219_REGISTER_BUS_VOLTAGE, INA219_REGISTER_CURRENT, INA219_REGISTER_POWER};
+    quint16 values[4] = {0};
+
+    // If the conversion is not finished yet, wait for a fraction of the conversion time and try again
+    uint waitTime = conversionTime() / 4;
+    for (int retry = 0; ; retry++) {
+        if (!readRegisters(fileDescriptor, registers, values, 4))
+            return QByteArray();
+
+        if (values[1] & CONVERSION_READY_VALUE)
+            break;
+
+        if (retry >= 8) {
+            qCDebug(dcI2cDevices()) << "INA219 no new conversion available, using the previous one";
+            break;
+        }
+        usleep(waitTime);
     }
-    ret = read(fileDescriptor, buf, 2);
-    if (ret != 2) {
-        qCWarning(dcI2cDevices()) << "Failed to read shunt voltage register on INA219";
-        return QByteArray();
-    }
-    int shuntVoltageRaw = ((buf[0] << 8) | buf[1]);
-    double shuntVoltage = shuntVoltageRaw * SHUNT_MILLIVOLTS_LSB / 1000;
 
+    Measurement measurement;
+    measurement.shuntVoltage = static_cast<qint16>(values[0]) * SHUNT_MILLIVOLTS_LSB / 1000;
+    measurement.overflow = (values[1] & OVERFLOW_VALUE) == 1;
+    measurement.busVoltage = 1.0 * (values[1] >> 3) * BUS_MILLIVOLTS_LSB / 1000; // Registers are not right_aligned
+    measurement.current = 1.0 * static_cast<qint16>(values[2]) * m_currentLSB;
+    measurement.power = values[3] * m_currentLSB * 20;
 
-    buf[0] = INA219_REGISTER_BUS_VOLTAGE;
-    ret = write(fileDescriptor, buf, 1);
-    if (ret != 1) {
-        qCWarning(dcI2cDevices()) << "Failed to select bus voltage register on INA219";
-        return QByteArray();
-    }
-    ret = read(fileDescriptor, buf, 2);
-    if (ret != 2) {
-        qCWarning(dcI2cDevices()) << "Failed to read bus voltage register on INA219";
-        return QByteArray();
-    }
-    int busVoltageRaw = ((buf[0] << 8) | buf[1]);
-    bool overflow = (busVoltageRaw & OVERFLOW_VALUE) == 1;
-    busVoltageRaw = busVoltageRaw >> 3; // Registers are not right_aligned
-    double busVoltage = 1.0 * busVoltageRaw * BUS_MILLIVOLTS_LSB / 1000;
-
-    buf[0] = INA219_REGISTER_POWER;
-    ret = write(fileDescriptor, buf, 1);
-    if (ret != 1) {
-        qCWarning(dcI2cDevices()) << "Failed to select power register on INA219";
-        return QByteArray();
-    }
-    ret = read(fileDescriptor, buf, 2);
-    if (ret != 2) {
-        qCWarning(dcI2cDevices()) << "Failed to read power register on INA219";
-        return QByteArray();
-    }
-    int powerRaw = ((buf[0] << 8) | buf[1]);
-    double powerLSB = m_currentLSB * 20;
-    double power = powerRaw * powerLSB;
-
-    buf[0] = INA219_REGISTER_CURRENT;
-    ret = write(fileDescriptor, buf, 1);
-    if (ret != 1) {
-        qCWarning(dcI2cDevices()) << "Failed to select current register on INA219";
-        return QByteArray();
+    qCDebug(dcI2cDevices()).nospace().noquote() << "INA219 Shunt voltage: " << measurement.shuntVoltage << "V, Bus voltage: " << measurement.busVoltage << "V, Power: " << measurement.power << "W, Current: " << measurement.current << "A, Overflow: " << measurement.overflow;
+
+    return QByteArray(reinterpret_cast<const char *>(&measurement), sizeof(Measurement));
+}
+
+bool Ina219::parseMeasurement(const QByteArray &data, Measurement *measurement)
+{
+    if (data.size() != sizeof(Measurement))
+        return false;
+
+    memcpy(measurement, data.constData(), sizeof(Measurement));
+    return true;
+}
+
+quint8 Ina219::adcSetting(ADCBits bits) const
+{
+    // Averaging modes are 0b1001 (2 samples) to 0b1111 (128 samples), always at 12 bit
+    if (m_averaging <= 1)
+        return bits;
+
+    quint8 setting = 0x08;
+    for (uint samples = m_averaging; samples > 1; samples >>= 1)
+        setting++;
+
+    return qMin<quint8>(setting, 0x0F);
+}
+
+uint Ina219::conversionTime() const
+{
+    // Microseconds per conversion for 9, 10, 11 and 12 bit, averaging multiplies the 12 bit time
+    static const uint resolutionTimes[4] = {84, 148, 276, 532};
+
+    uint busTime = m_averaging > 1 ? 532 * m_averaging : resolutionTimes[m_busADC];
+    uint shuntTime = m_averaging > 1 ? 532 * m_averaging : resolutionTimes[m_shuntADC];
+    return busTime + shuntTime;
+}
+
+bool Ina219::readRegisters(int fileDescriptor, const quint8 *registers, quint16 *values, int count)
+{
+    unsigned char buffers[4][2];
+    quint8 pointers[4];
+    count = qMin(count, 4);
+
+    // Select and read each register in one transfer with a repeated start. Controllers like
+    // i2c-bcm2835 accept only a single read message at the end of a transfer, so the registers
+    // can't be combined into one transfer.
+    if (m_combinedTransfers) {
+        int i = 0;
+        for (; i < count; i++) {
+            pointers[i] = registers[i];
+
+            struct i2c_msg messages[2];
+            messages[0].addr = static_cast<__u16>(address());
+            messages[0].flags = 0;
+            messages[0].len = 1;
+            messages[0].buf = &pointers[i];
+            messages[1].addr = static_cast<__u16>(address());
+            messages[1].flags = I2C_M_RD;
+            messages[1].len = 2;
+            messages[1].buf = buffers[i];
+
+            struct i2c_rdwr_ioctl_data transfer;
+            transfer.msgs = messages;
+            transfer.nmsgs = 2;
+            if (ioctl(fileDescriptor, I2C_RDWR, &transfer) < 0)
+                break;
+
+            values[i] = static_cast<quint16>((buffers[i][0] << 8) | buffers[i][1]);
+        }
+
+        if (i == count)
+            return true;
+
+        if (i > 0 || errno != EOPNOTSUPP) {
+            qCWarning(dcI2cDevices()) << "Failed to read register" << registers[i] << "on INA219" << strerror(errno);
+            return false;
+        }
+
+        // SMBus only adapters don't support plain I2C transfers, remember it and don't try again
+        qCDebug(dcI2cDevices()) << "INA219 combined transfers not supported, reading registers with separate write and read" << strerror(errno);
+        m_combinedTransfers = false;
     }
-    ret = read(fileDescriptor, buf, 2);
-    if (ret != 2) {
-        qCWarning(dcI2cDevices()) << "Failed to read current register on INA219";
-        return QByteArray();
+
+    for (int i = 0; i < count; i++) {
+        pointers[i] = registers[i];
+        if (write(fileDescriptor, &pointers[i], 1) != 1) {
+            qCWarning(dcI2cDevices()) << "Failed to select register" << registers[i] << "on INA219";
+            return false;
+        }
+        if (read(fileDescriptor, buffers[i], 2) != 2) {
+            qCWarning(dcI2cDevices()) << "Failed to read register" << registers[i] << "on INA219";
+            return false;
+        }
+        values[i] = static_cast<quint16>((buffers[i][0] << 8) | buffers[i][1]);
     }
-    int currentRaw = ((buf[0] << 8) | buf[1]);
-    double current = 1.0 * currentRaw * m_currentLSB;
-
-    qCDebug(dcI2cDevices()).nospace().noquote() << "INA219 Shunt voltage: " << shuntVoltage << "mV, Bus voltage: " << busVoltage << "V, Power: " << power << "W, Current: " << current << "A, Overflow: " << overflow;
-
-    QVariantMap readings;
-    readings.insert("shuntVoltage", shuntVoltage);
-    readings.insert("busVoltage", busVoltage);
-    readings.insert("power", power);
-    readings.insert("current", current);
-    readings.insert("overflow", overflow);
-    return QJsonDocument::fromVariant(readings).toJson(QJsonDocument::Compact);
+    return true;
 }
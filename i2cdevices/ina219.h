@@ -42,11 +42,25 @@ public:
     };
     Q_ENUM(OperationMode)
 
+    // Fixed layout reading, passed through readingAvailable() as raw bytes
+    struct Measurement {
+        double shuntVoltage = 0; // V
+        double busVoltage = 0;   // V
+        double current = 0;      // A
+        double power = 0;        // W
+        bool overflow = false;
+    };
+
     explicit Ina219(const QString &portName, int address, double shuntOhms, VoltageRange voltageRange, QObject *parent = nullptr);
 
+    // Number of samples averaged by the ADC per conversion, 1 to 128. Applied on the next writeData().
+    void setAveraging(uint samples);
+
     bool writeData(int fileDescriptor, const QByteArray &data) override;
     QByteArray readData(int fileDescriptor) override;
 
+    static bool parseMeasurement(const QByteArray &data, Measurement *measurement);
+
 signals:
     void measurementAvailable();
 
@@ -57,8 +71,14 @@ private:
     ADCBits m_busADC = ADCBits12;
     ADCBits m_shuntADC = ADCBits12;
     OperationMode m_operationMode = OperationModeShuntAndBusContinuous;
+    uint m_averaging = 1;
 
     double m_currentLSB = 0;
+    bool m_combinedTransfers = true;
+
+    quint8 adcSetting(ADCBits bits) const;
+    uint conversionTime() const;
+    bool readRegisters(int fileDescriptor, const quint8 *registers, quint16 *values, int count);
 };
 
 #endif // INA219_H
@@ -32,13 +32,13 @@
 #include "plugininfo.h"
 
 #include "pi16adcchannel.h"
-#include "ads1115channel.h"
+#include "ads1115.h"
 #include "ina219.h"
 
 #include <hardware/i2c/i2cmanager.h>
 
 #include <QDebug>
-#include <QJsonDocument>
+#include <QDateTime>
 
 IntegrationPluginI2CDevices::IntegrationPluginI2CDevices(): IntegrationPlugin()
 {
@@ -174,44 +174,46 @@ void IntegrationPluginI2CDevices::setupThing(ThingSetupInfo *info)
         QString i2cPortName = info->thing()->paramValue(ads1115ThingI2cPortParamTypeId).toString();
         int i2cAddress = info->thing()->paramValue(ads1115ThingI2cAddressParamTypeId).toInt();
         double gainParam = info->thing()->paramValue(ads1115ThingInputGainParamTypeId).toDouble();
-        ADS1115Channel::Gain inputGain = ADS1115Channel::Gain_4_096;
+        ADS1115::Gain inputGain = ADS1115::Gain_4_096;
         if (qFuzzyCompare(gainParam, 6.144)) {
-            inputGain = ADS1115Channel::Gain_6_144;
+            inputGain = ADS1115::Gain_6_144;
         } else if (qFuzzyCompare(gainParam, 4.096)) {
-            inputGain = ADS1115Channel::Gain_4_096;
+            inputGain = ADS1115::Gain_4_096;
         } else if (qFuzzyCompare(gainParam, 2.048)) {
-            inputGain = ADS1115Channel::Gain_2_048;
+            inputGain = ADS1115::Gain_2_048;
         } else if (qFuzzyCompare(gainParam, 1.024)) {
-            inputGain = ADS1115Channel::Gain_1_024;
+            inputGain = ADS1115::Gain_1_024;
         } else if (qFuzzyCompare(gainParam, 0.512)) {
-            inputGain = ADS1115Channel::Gain_0_512;
+            inputGain = ADS1115::Gain_0_512;
         } else if (qFuzzyCompare(gainParam, 0.256)) {
-            inputGain = ADS1115Channel::Gain_0_256;
+            inputGain = ADS1115::Gain_0_256;
         }
 
-        for (int i = 0; i < 4; i++) {
-            ADS1115Channel *ads1115 = new ADS1115Channel(i2cPortName, i2cAddress, i, inputGain, this);
-            if (!hardwareManager()->i2cManager()->open(ads1115)) {
-                delete ads1115;
-                info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Failed to open I2C port."));
+        // One device scans all channels of the chip in a single bus cycle
+        ADS1115 *ads1115 = new ADS1115(i2cPortName, i2cAddress, inputGain, this);
+        ads1115->setDataRate(info->thing()->paramValue(ads1115ThingDataRateParamTypeId).toUInt());
+        ads1115->setOversampling(info->thing()->paramValue(ads1115ThingOversamplingParamTypeId).toUInt());
+        ads1115->setChannelCount(info->thing()->paramValue(ads1115ThingChannelCountParamTypeId).toInt());
+        if (!hardwareManager()->i2cManager()->open(ads1115)) {
+            delete ads1115;
+            info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Failed to open I2C port."));
+            return;
+        }
+
+        Thing *thing = info->thing();
+        connect(ads1115, &ADS1115::readingAvailable, thing, [this, thing](const QByteArray &data){
+            QList<ADS1115::ChannelReading> readings = ADS1115::parseReading(data);
+            if (readings.isEmpty()) {
+                qCWarning(dcI2cDevices()) << "Error reading from" << thing;
                 return;
             }
-
-            Thing *thing = info->thing();
-            connect(ads1115, &ADS1115Channel::readingAvailable, thing, [this, thing, i](const QByteArray &data){
-                if (data.length() != 2) {
-                    qCWarning(dcI2cDevices()) << "Error reading from" << thing;
-                    return;
-                }
-                const int max = 32768;
-                int value = static_cast<qint16>(data[0]) * 256 + static_cast<qint16>(data[1]);
-                double transformedValue = qMin(1.0 * value / max, 1.0);
-                thing->setStateValue(m_ads1115ChannelMap.value(i), transformedValue);
-                thing->setStateValue(m_ads1115OvervoltageMap.value(i), value > 32768);
-            });
-            hardwareManager()->i2cManager()->startReading(ads1115, 5000);
-            m_i2cDevices.insert(ads1115, thing);
-        }
+            foreach (const ADS1115::ChannelReading &reading, readings) {
+                thing->setStateValue(m_ads1115ChannelMap.value(reading.channel), qBound(0.0, reading.value, 1.0));
+                thing->setStateValue(m_ads1115OvervoltageMap.value(reading.channel), reading.overvoltage);
+            }
+        });
+        hardwareManager()->i2cManager()->startReading(ads1115, info->thing()->paramValue(ads1115ThingSampleIntervalParamTypeId).toInt());
+        m_i2cDevices.insert(ads1115, thing);
         info->finish(Thing::ThingErrorNoError);
     }
 
@@ -222,6 +224,7 @@ void IntegrationPluginI2CDevices::setupThing(ThingSetupInfo *info)
         Ina219::VoltageRange voltageRange = info->thing()->paramValue(ina219ThingVoltageRangeParamTypeId).toUInt() == 16 ? Ina219::VoltageRange16 : Ina219::VoltageRange32;
 
         Ina219 *ina219 = new Ina219(i2cPortName, i2cAddress, shuntOhms, voltageRange, this);
+        ina219->setAveraging(info->thing()->paramValue(ina219ThingAveragingParamTypeId).toUInt());
         if (!hardwareManager()->i2cManager()->open(ina219)) {
             delete ina219;
             info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Failed to open I2C port."));
@@ -230,37 +233,38 @@ void IntegrationPluginI2CDevices::setupThing(ThingSetupInfo *info)
 
         Thing *thing = info->thing();
         connect(ina219, &Ina219::readingAvailable, thing, [thing](const QByteArray &data){
-            QJsonParseError error;
-            QVariantMap values = QJsonDocument::fromJson(data, &error).toVariant().toMap();
-            if (error.error != QJsonParseError::NoError) {
+            Ina219::Measurement measurement;
+            if (!Ina219::parseMeasurement(data, &measurement)) {
                 qCWarning(dcI2cDevices()) << thing->name() << "Failed to read data from INA219";
                 return;
             }
-            double currentPower = values.value("power").toDouble();
-            thing->setStateValue(ina219CurrentPowerStateTypeId, currentPower);
-            thing->setStateValue(ina219VoltagePhaseAStateTypeId, values.value("busVoltage").toDouble());
-            thing->setStateValue(ina219CurrentPhaseAStateTypeId, values.value("current").toDouble());
-            thing->setStateValue(ina219OverflowStateTypeId, values.value("overflow").toBool());
+            thing->setStateValue(ina219CurrentPowerStateTypeId, measurement.power);
+            thing->setStateValue(ina219VoltagePhaseAStateTypeId, measurement.busVoltage);
+            thing->setStateValue(ina219CurrentPhaseAStateTypeId, measurement.current);
+            thing->setStateValue(ina219OverflowStateTypeId, measurement.overflow);
 
             // Calculate an estimate of totalEnergyConsumed
+            QDateTime now = QDateTime::currentDateTime();
             QDateTime lastUpdate = thing->property("lastUpdate").toDateTime();
+            thing->setProperty("lastUpdate", now);
             if (lastUpdate.isNull()) {
-                lastUpdate = QDateTime::currentDateTime();
+                return;
             }
-            double hoursPassed = lastUpdate.msecsTo(QDateTime::currentDateTime()) / 1000 / 60 / 60;
-            if (currentPower >= 0) {
+            double hoursPassed = lastUpdate.msecsTo(now) / 1000.0 / 60 / 60;
+            if (measurement.power >= 0) {
                 double totalEnergyConsumed = thing->stateValue(ina219TotalEnergyConsumedStateTypeId).toDouble();
-                totalEnergyConsumed += currentPower / 1000 * hoursPassed;
+                totalEnergyConsumed += measurement.power / 1000 * hoursPassed;
                 thing->setStateValue(ina219TotalEnergyConsumedStateTypeId, totalEnergyConsumed);
             } else {
                 double totalEnergyReturned = thing->stateValue(ina219TotalEnergyProducedStateTypeId).toDouble();
-                totalEnergyReturned += -currentPower / 1000 * hoursPassed;
+                totalEnergyReturned += -measurement.power / 1000 * hoursPassed;
                 thing->setStateValue(ina219TotalEnergyProducedStateTypeId, totalEnergyReturned);
             }
         });
 
         hardwareManager()->i2cManager()->writeData(ina219, "init");
-        hardwareManager()->i2cManager()->startReading(ina219, 5000);
+        hardwareManager()->i2cManager()->startReading(ina219, info->thing()->paramValue(ina219ThingSampleIntervalParamTypeId).toInt());
+        m_i2cDevices.insert(ina219, thing);
 
         info->finish(Thing::ThingErrorNoError);
     }
@@ -36,6 +36,7 @@
 #include "network/zeroconf/zeroconfservicebrowser.h"
 #include "network/zeroconf/zeroconfserviceentry.h"
 #include "network/networkaccessmanager.h"
+#include "nymeasettings.h"
 
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -59,6 +60,37 @@ void IntegrationPluginKodi::init()
 
     m_pluginTimer = hardwareManager()->pluginTimerManager()->registerTimer(10);
     connect(m_pluginTimer, &PluginTimer::timeout, this, &IntegrationPluginKodi::onPluginTimer);
+
+    connect(this, &IntegrationPluginKodi::configValueChanged, this, &IntegrationPluginKodi::updateThumbnailCache);
+    updateThumbnailCache();
+}
+
+void IntegrationPluginKodi::updateThumbnailCache()
+{
+    if (!configValue(kodiPluginThumbnailCacheParamTypeId).toBool()) {
+        if (m_thumbnailCache) {
+            qCDebug(dcKodi()) << "Disabling thumbnail cache";
+            m_thumbnailCache->deleteLater();
+            m_thumbnailCache = nullptr;
+        }
+    } else {
+        quint16 port = static_cast<quint16>(configValue(kodiPluginThumbnailCachePortParamTypeId).toUInt());
+        int maxResolution = configValue(kodiPluginThumbnailMaxResolutionParamTypeId).toInt();
+        if (m_thumbnailCache && (!m_thumbnailCache->isAvailable() || m_thumbnailCache->port() != port)) {
+            qCDebug(dcKodi()) << "Restarting thumbnail cache on port" << port;
+            delete m_thumbnailCache;
+            m_thumbnailCache = nullptr;
+        }
+        if (!m_thumbnailCache) {
+            m_thumbnailCache = new KodiThumbnailCache(hardwareManager()->networkManager(), NymeaSettings::cachePath() + "/kodi-thumbnails", port, maxResolution, this);
+        }
+        m_thumbnailCache->setMaxCacheSize(configValue(kodiPluginThumbnailCacheSizeParamTypeId).toLongLong() * 1024 * 1024);
+        m_thumbnailCache->setMaxResolution(maxResolution);
+    }
+
+    foreach (Kodi *kodi, m_kodis.keys()) {
+        kodi->setThumbnailCache(m_thumbnailCache);
+    }
 }
 
 void IntegrationPluginKodi::setupThing(ThingSetupInfo *info)
@@ -127,6 +159,7 @@ void IntegrationPluginKodi::setupThing(ThingSetupInfo *info)
 
     qCDebug(dcKodi()).nospace().noquote() << "Connecting to kodi on " << ipString << ":" << port << " (HTTP Port " << httpPort << ")";
     Kodi *kodi= new Kodi(QHostAddress(ipString), port, httpPort, this);
+    kodi->setThumbnailCache(m_thumbnailCache);
 
     connect(kodi, &Kodi::connectionStatusChanged, this, &IntegrationPluginKodi::onConnectionChanged);
     connect(kodi, &Kodi::stateChanged, this, &IntegrationPluginKodi::onStateChanged);
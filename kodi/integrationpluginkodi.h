@@ -66,6 +66,7 @@ private:
     PluginTimer *m_pluginTimer;
     QHash<Kodi*, Thing*> m_kodis;
     QHash<Kodi*, ThingSetupInfo*> m_asyncSetups;
+    KodiThumbnailCache *m_thumbnailCache = nullptr;
     ZeroConfServiceBrowser *m_serviceBrowser = nullptr;
     ZeroConfServiceBrowser *m_httpServiceBrowser = nullptr;
 
@@ -74,6 +75,7 @@ private:
     QHash<int, BrowserItemActionInfo*> m_pendingBrowserItemActions;
 
 private slots:
+    void updateThumbnailCache();
     void onPluginTimer();
     void onConnectionChanged(bool connected);
     void onStateChanged();
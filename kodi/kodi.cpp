@@ -34,6 +34,8 @@
 #include <QUrl>
 #include <QTime>
 
+static const int browsePageSize = 500;
+
 Kodi::Kodi(const QHostAddress &hostAddress, int port, int httpPort, QObject *parent) :
     QObject(parent),
     m_httpPort(httpPort),
@@ -158,6 +160,7 @@ Kodi::Kodi(const QHostAddress &hostAddress, int port, int httpPort, QObject *par
     item.setIcon(BrowserItem::BrowserIconFolder);
     VirtualFsNode *videoAddons = new VirtualFsNode(item);
     videoAddons->getMethod = "Files.GetDirectory";
+    videoAddons->cacheable = false;
     videoAddons->getParams.insert("directory", "addons://sources/video");
     videoAddons->getParams.insert("sort", sort);
     videoAddons->getParams.insert("properties", properties);
@@ -168,6 +171,7 @@ Kodi::Kodi(const QHostAddress &hostAddress, int port, int httpPort, QObject *par
     item.setIcon(BrowserItem::BrowserIconFolder);
     VirtualFsNode *musicAddons = new VirtualFsNode(item);
     musicAddons->getMethod = "Files.GetDirectory";
+    musicAddons->cacheable = false;
     musicAddons->getParams.insert("directory", "addons://sources/audio");
     musicAddons->getParams.insert("sort", sort);
     musicAddons->getParams.insert("properties", properties);
@@ -314,9 +318,18 @@ void Kodi::disconnectKodi()
     m_connection->disconnectKodi();
 }
 
+void Kodi::setThumbnailCache(KodiThumbnailCache *thumbnailCache)
+{
+    if (m_thumbnailCache == thumbnailCache)
+        return;
+
+    // Cached browse results contain thumbnail URLs pointing to the old location
+    m_thumbnailCache = thumbnailCache;
+    m_browseCache.clear();
+}
+
 void Kodi::browse(BrowseResult *result)
 {
-//    m_jsonHandler->sendData()
     VirtualFsNode *node = m_virtualFs->findNode(result->itemId());
 
     if (node) {
@@ -328,9 +341,7 @@ void Kodi::browse(BrowseResult *result)
             return;
         }
 
-        qCDebug(dcKodi()) << "Sending:" << node->getMethod << node->getParams;
-        int id = m_jsonHandler->sendData(node->getMethod, node->getParams);
-        m_pendingBrowseRequests.insert(id, result);
+        sendBrowseRequest(result, node->getMethod, node->getParams, node->cacheable);
         return;
     }
 
@@ -351,8 +362,7 @@ void Kodi::browse(BrowseResult *result)
         albumProperties.append("artist");
         albumProperties.append("year");
         params.insert("properties", albumProperties);
-        int id = m_jsonHandler->sendData("AudioLibrary.GetAlbums", params);
-        m_pendingBrowseRequests.insert(id, result);
+        sendBrowseRequest(result, "AudioLibrary.GetAlbums", params, true);
         return;
     }
 
@@ -369,8 +379,7 @@ void Kodi::browse(BrowseResult *result)
         songProperties.append("album");
         songProperties.append("year");
         params.insert("properties", songProperties);
-        int id = m_jsonHandler->sendData("AudioLibrary.GetSongs", params);
-        m_pendingBrowseRequests.insert(id, result);
+        sendBrowseRequest(result, "AudioLibrary.GetSongs", params, true);
         return;
     }
 
@@ -385,8 +394,7 @@ void Kodi::browse(BrowseResult *result)
         properties.append("thumbnail");
         properties.append("showtitle");
         params.insert("properties", properties);
-        int id = m_jsonHandler->sendData("VideoLibrary.GetSeasons", params);
-        m_pendingBrowseRequests.insert(id, result);
+        sendBrowseRequest(result, "VideoLibrary.GetSeasons", params, true);
         return;
     }
 
@@ -405,8 +413,7 @@ void Kodi::browse(BrowseResult *result)
         properties.append("season");
         params.insert("properties", properties);
         qCDebug(dcKodi()) << "getting episodes:" << params;
-        int id = m_jsonHandler->sendData("VideoLibrary.GetEpisodes", params);
-        m_pendingBrowseRequests.insert(id, result);
+        sendBrowseRequest(result, "VideoLibrary.GetEpisodes", params, true);
         return;
     }
 
@@ -420,8 +427,7 @@ void Kodi::browse(BrowseResult *result)
 //        properties.append("season");
 //        params.insert("properties", properties);
         qCDebug(dcKodi()) << "Sending" << params;
-        int id = m_jsonHandler->sendData("Files.GetDirectory", params);
-        m_pendingBrowseRequests.insert(id, result);
+        sendBrowseRequest(result, "Files.GetDirectory", params, false);
         return;
     }
 
@@ -432,8 +438,7 @@ void Kodi::browse(BrowseResult *result)
         params.insert("directory", idString);
         params.insert("properties", properties);
         qCDebug(dcKodi()) << "Sending" << params;
-        int id = m_jsonHandler->sendData("Files.GetDirectory", params);
-        m_pendingBrowseRequests.insert(id, result);
+        sendBrowseRequest(result, "Files.GetDirectory", params, false);
         return;
     }
 
@@ -550,6 +555,8 @@ void Kodi::onConnectionStatusChanged()
     if (m_connection->connected()) {
         checkVersion();
     } else {
+        // The library may change while we're not listening for notifications
+        m_browseCache.clear();
         emit connectionStatusChanged(false);
     }
 }
@@ -668,6 +675,10 @@ void Kodi::processNotification(const QString &method, const QVariantMap &params)
             method == "Player.OnAVChange") {
         update();
     }
+
+    if (method.startsWith("VideoLibrary.") || method.startsWith("AudioLibrary.")) {
+        invalidateBrowseCache(method, params.value("data").toMap());
+    }
 }
 
 void Kodi::processResponse(int id, const QString &method, const QVariantMap &response)
@@ -679,6 +690,11 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
         qCWarning(dcKodi) << "got error response for request " << method << ":" << response.value("error").toMap().value("message").toString();
     }
 
+    if (m_pendingBrowseRequests.contains(id)) {
+        processBrowseResponse(id, method, response);
+        return;
+    }
+
     if (method == "JSONRPC.Version") {
         qCDebug(dcKodi) << "got version response" << method;
         QVariantMap data = response.value("result").toMap();
@@ -731,9 +747,191 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
         return;
     }
 
+    if (method == "AudioLibrary.GetSongDetails") {
+        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
+        BrowserItem item("song:" + response.value("result").toMap().value("songdetails").toMap().value("songid").toString());
+        item.setDisplayName(response.value("result").toMap().value("songdetails").toMap().value("label").toString());
+        qCDebug(dcKodi()) << "Song details:" << item.displayName();
+        result->finish(item);
+        return;
+    }
+
+    if (method == "VideoLibrary.GetMovieDetails") {
+        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
+        BrowserItem item("movie:" + response.value("result").toMap().value("moviedetails").toMap().value("movieid").toString());
+        item.setDisplayName(response.value("result").toMap().value("moviedetails").toMap().value("label").toString());
+        qCDebug(dcKodi()) << "Movie details:" << item.displayName();
+        result->finish(item);
+        return;
+    }
+
+    if (method == "VideoLibrary.GetEpisodeDetails") {
+        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
+        BrowserItem item("movie:" + response.value("result").toMap().value("episodedetails").toMap().value("episodeid").toString());
+        item.setDisplayName(response.value("result").toMap().value("episodedetails").toMap().value("label").toString());
+        qCDebug(dcKodi()) << "Episode details:" << item.displayName();
+        result->finish(item);
+        return;
+    }
+
+    if (method == "VideoLibrary.GetMusicVideoDetails") {
+        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
+        BrowserItem item("movie:" + response.value("result").toMap().value("musicvideodetails").toMap().value("musicvideoid").toString());
+        item.setDisplayName(response.value("result").toMap().value("musicvideodetails").toMap().value("label").toString());
+        qCDebug(dcKodi()) << "Episode details:" << item.displayName();
+        result->finish(item);
+        return;
+    }
+
+    if (method == "VideoLibrary.Scan" || method == "VideoLibrary.Clean" || method == "AudioLibrary.Scan" || method == "AudioLibrary.Clean") {
+        emit browserItemActionExecuted(id, !response.contains("error"));
+        return;
+    }
+
+    if (method == "Player.Open") {
+        emit browserItemExecuted(id, !response.contains("error"));
+        return;
+    }
+
+    // Default
+    emit actionExecuted(id, !response.contains("error"));
+}
+
+void Kodi::sendBrowseRequest(BrowseResult *result, const QString &method, const QVariantMap &params, bool cacheable)
+{
+    QList<BrowserItem> cachedItems;
+    if (cacheable && m_browseCache.lookup(result->itemId(), &cachedItems)) {
+        foreach (const BrowserItem &item, cachedItems) {
+            result->addItem(item);
+        }
+        qCDebug(dcKodi()) << "Browsing" << result->itemId() << "from cache. Hits:" << m_browseCache.hits() << "misses:" << m_browseCache.misses();
+        result->finish(Thing::ThingErrorNoError);
+        return;
+    }
+
+    BrowseRequest request;
+    request.result = result;
+    request.itemId = result->itemId();
+    request.method = method;
+    request.params = params;
+    request.cacheable = cacheable;
+    sendBrowsePage(request);
+}
+
+void Kodi::sendBrowsePage(const BrowseRequest &request)
+{
+    // Large libraries are fetched in pages to keep the single replies small
+    QVariantMap limits;
+    limits.insert("start", request.items.count());
+    limits.insert("end", request.items.count() + browsePageSize);
+    QVariantMap params = request.params;
+    params.insert("limits", limits);
+
+    qCDebug(dcKodi()) << "Sending:" << request.method << params;
+    int id = m_jsonHandler->sendData(request.method, params);
+    m_pendingBrowseRequests.insert(id, request);
+}
+
+void Kodi::processBrowseResponse(int id, const QString &method, const QVariantMap &response)
+{
+    BrowseRequest request = m_pendingBrowseRequests.take(id);
+    if (response.contains("error")) {
+        if (request.result) {
+            request.result->finish(Thing::ThingErrorHardwareFailure);
+        }
+        return;
+    }
+
+    QVariantMap result = response.value("result").toMap();
+    int offset = request.items.count();
+    request.items.append(browserItemsFromResponse(method, result, offset));
+
+    // Remember which media items this list shows for invalidating it on library changes
+    static const QHash<QString, QPair<QString, QString>> mediaLists = {
+        {"AudioLibrary.GetArtists", {"artists", "artist"}},
+        {"AudioLibrary.GetAlbums", {"albums", "album"}},
+        {"AudioLibrary.GetSongs", {"songs", "song"}},
+        {"VideoLibrary.GetMovies", {"movies", "movie"}},
+        {"VideoLibrary.GetTVShows", {"tvshows", "tvshow"}},
+        {"VideoLibrary.GetSeasons", {"seasons", "season"}},
+        {"VideoLibrary.GetEpisodes", {"episodes", "episode"}},
+        {"VideoLibrary.GetMusicVideos", {"musicvideos", "musicvideo"}}
+    };
+    if (request.cacheable && mediaLists.contains(method)) {
+        QString type = mediaLists.value(method).second;
+        foreach (const QVariant &entry, result.value(mediaLists.value(method).first).toList()) {
+            request.mediaIds.append(type + ":" + entry.toMap().value(type + "id").toString());
+        }
+    }
+
+    QVariantMap limits = result.value("limits").toMap();
+    int end = limits.value("end").toInt();
+    if (end > offset && end < limits.value("total").toInt()) {
+        // Keep filling the cache even if the client went away in the meantime
+        if (request.result || request.cacheable) {
+            sendBrowsePage(request);
+        }
+        return;
+    }
+
+    if (request.cacheable) {
+        m_browseCache.insert(request.itemId, request.items, request.mediaIds);
+    }
+
+    if (request.result) {
+        foreach (const BrowserItem &item, request.items) {
+            request.result->addItem(item);
+        }
+        request.result->finish(Thing::ThingErrorNoError);
+    }
+}
+
+void Kodi::invalidateBrowseCache(const QString &method, const QVariantMap &data)
+{
+    if (!method.endsWith(".OnUpdate") && !method.endsWith(".OnRemove")) {
+        return;
+    }
+
+    // VideoLibrary notifications wrap the item in "item", AudioLibrary ones don't
+    QVariantMap item = data.contains("item") ? data.value("item").toMap() : data;
+    QString type = item.value("type").toString();
+    QString mediaId = type + ":" + item.value("id").toString();
+
+    // Drop all lists showing the item. If none does, it may be a new one, so drop the
+    // lists it would show up in.
+    if (m_browseCache.invalidateMedia(mediaId) || method.endsWith(".OnRemove")) {
+        qCDebug(dcKodi()) << "Browse cache: invalidated lists containing" << mediaId;
+        return;
+    }
+
+    if (type == "movie") {
+        m_browseCache.invalidate("movies");
+    } else if (type == "tvshow") {
+        m_browseCache.invalidate("tvshows");
+    } else if (type == "season") {
+        m_browseCache.invalidatePrefix("tvshow:");
+    } else if (type == "episode") {
+        m_browseCache.invalidatePrefix("season:");
+    } else if (type == "musicvideo") {
+        m_browseCache.invalidate("musicvideos");
+    } else if (type == "artist") {
+        m_browseCache.invalidate("artists");
+    } else if (type == "album") {
+        m_browseCache.invalidate("albums");
+        m_browseCache.invalidatePrefix("artist:");
+    } else if (type == "song") {
+        m_browseCache.invalidate("songs");
+        m_browseCache.invalidatePrefix("album:");
+    }
+    qCDebug(dcKodi()) << "Browse cache: invalidated lists for new" << mediaId;
+}
+
+QList<BrowserItem> Kodi::browserItemsFromResponse(const QString &method, const QVariantMap &result, int offset)
+{
+    QList<BrowserItem> items;
+
     if (method == "AudioLibrary.GetArtists") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &artistVariant, response.value("result").toMap().value("artists").toList()) {
+        foreach (const QVariant &artistVariant, result.value("artists").toList()) {
             QVariantMap artist = artistVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << artist;
             BrowserItem item("artist:" + artist.value("artistid").toString(), artist.value("label").toString());
@@ -749,15 +947,13 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
             }
             item.setDescription(description.join(" - "));
             qCDebug(dcKodi()) << "Thumbnail" << item.thumbnail();
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "AudioLibrary.GetAlbums") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &albumVariant, response.value("result").toMap().value("albums").toList()) {
+        foreach (const QVariant &albumVariant, result.value("albums").toList()) {
             QVariantMap album = albumVariant.toMap();
             BrowserItem item("album:" + album.value("albumid").toString(), album.value("label").toString());
             item.setBrowsable(true);
@@ -771,16 +967,14 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
                 description.append(album.value("year").toString());
             }
             item.setDescription(description.join(" - "));
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "AudioLibrary.GetSongs") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        int i = 0;
-        foreach (const QVariant &songVariant, response.value("result").toMap().value("songs").toList()) {
+        int i = offset;
+        foreach (const QVariant &songVariant, result.value("songs").toList()) {
             QVariantMap song = songVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << song;
             QString newId = "song:";
@@ -804,17 +998,15 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
                 description.append(song.value("year").toString());
             }
             item.setDescription(description.join(" - "));
-            result->addItem(item);
+            items.append(item);
             i++;
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
 
     if (method == "VideoLibrary.GetMovies") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &movieVariant, response.value("result").toMap().value("movies").toList()) {
+        foreach (const QVariant &movieVariant, result.value("movies").toList()) {
             QVariantMap movie = movieVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << movie;
             BrowserItem item("movie:" + movie.value("movieid").toString(), movie.value("label").toString());
@@ -836,15 +1028,13 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
             QString duration;
             duration = QString("%1:%2").arg(hours).arg(minutes, 2, 10, QChar('0'));
             item.setDescription(movie.value("year").toString() + " - " + duration + " - " + rating);
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "VideoLibrary.GetTVShows") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &tvShowVariant, response.value("result").toMap().value("tvshows").toList()) {
+        foreach (const QVariant &tvShowVariant, result.value("tvshows").toList()) {
             QVariantMap tvShow = tvShowVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << tvShow;
             BrowserItem item("tvshow:" + tvShow.value("tvshowid").toString(), tvShow.value("label").toString());
@@ -860,15 +1050,13 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
                 }
             }
             item.setDescription(tvShow.value("year").toString() + " - " + tr("%1 seasons").arg(tvShow.value("season").toInt()) + " - " + rating);
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "VideoLibrary.GetSeasons") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &seasonVariant, response.value("result").toMap().value("seasons").toList()) {
+        foreach (const QVariant &seasonVariant, result.value("seasons").toList()) {
             QVariantMap season = seasonVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << season;
             BrowserItem item("season:" + season.value("season").toString() + ",tvshow:" + season.value("tvshowid").toString(), season.value("label").toString());
@@ -876,15 +1064,13 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
             item.setIcon(BrowserItem::BrowserIconFolder);
             item.setThumbnail(prepareThumbnail(season.value("thumbnail").toString()));
             item.setDescription(season.value("showtitle").toString());
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "VideoLibrary.GetEpisodes") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &episodeVariant, response.value("result").toMap().value("episodes").toList()) {
+        foreach (const QVariant &episodeVariant, result.value("episodes").toList()) {
             QVariantMap episode = episodeVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << episode;
             BrowserItem item("episode:" + episode.value("episodeid").toString(), episode.value("label").toString());
@@ -896,45 +1082,39 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
             } else {
                 item.setDescription(episode.value("showtitle").toString());
             }
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "VideoLibrary.GetMusicVideos") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &musicVideoVariant, response.value("result").toMap().value("musicvideos").toList()) {
+        foreach (const QVariant &musicVideoVariant, result.value("musicvideos").toList()) {
             QVariantMap musicVideo = musicVideoVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << musicVideo;
             BrowserItem item("musicvideo:" + musicVideo.value("musicvideoid").toString(), musicVideo.value("label").toString());
             item.setExecutable(true);
             item.setIcon(BrowserItem::BrowserIconVideo);
             item.setThumbnail(prepareThumbnail(musicVideo.value("thumbnail").toString()));
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "Addons.GetAddons") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &addonVariant, response.value("result").toMap().value("addons").toList()) {
+        foreach (const QVariant &addonVariant, result.value("addons").toList()) {
             QVariantMap addon = addonVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << addon;
             BrowserItem item("addon:" + addon.value("addonid").toString(), addon.value("name").toString());
             item.setBrowsable(true);
             item.setIcon(BrowserItem::BrowserIconApplication);
             item.setThumbnail(prepareThumbnail(addon.value("thumbnail").toString()));
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
+        return items;
     }
 
     if (method == "Files.GetDirectory") {
-        BrowseResult *result = m_pendingBrowseRequests.take(id);
-        foreach (const QVariant &fileVariant, response.value("result").toMap().value("files").toList()) {
+        foreach (const QVariant &fileVariant, result.value("files").toList()) {
             QVariantMap file = fileVariant.toMap();
             qCDebug(dcKodi()) << "Entry:" << file;
             BrowserItem item("file:" + file.value("file").toString(), file.value("label").toString());
@@ -949,60 +1129,13 @@ void Kodi::processResponse(int id, const QString &method, const QVariantMap &res
                 item.setIcon(BrowserItem::BrowserIconMusic);
             }
             item.setThumbnail(prepareThumbnail(file.value("thumbnail").toString()));
-            result->addItem(item);
+            items.append(item);
         }
-        result->finish(Thing::ThingErrorNoError);
-        return;
-    }
-
-    if (method == "AudioLibrary.GetSongDetails") {
-        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
-        BrowserItem item("song:" + response.value("result").toMap().value("songdetails").toMap().value("songid").toString());
-        item.setDisplayName(response.value("result").toMap().value("songdetails").toMap().value("label").toString());
-        qCDebug(dcKodi()) << "Song details:" << item.displayName();
-        result->finish(item);
-        return;
-    }
-
-    if (method == "VideoLibrary.GetMovieDetails") {
-        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
-        BrowserItem item("movie:" + response.value("result").toMap().value("moviedetails").toMap().value("movieid").toString());
-        item.setDisplayName(response.value("result").toMap().value("moviedetails").toMap().value("label").toString());
-        qCDebug(dcKodi()) << "Movie details:" << item.displayName();
-        result->finish(item);
-        return;
-    }
-
-    if (method == "VideoLibrary.GetEpisodeDetails") {
-        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
-        BrowserItem item("movie:" + response.value("result").toMap().value("episodedetails").toMap().value("episodeid").toString());
-        item.setDisplayName(response.value("result").toMap().value("episodedetails").toMap().value("label").toString());
-        qCDebug(dcKodi()) << "Episode details:" << item.displayName();
-        result->finish(item);
-        return;
+        return items;
     }
 
-    if (method == "VideoLibrary.GetMusicVideoDetails") {
-        BrowserItemResult *result = m_pendingBrowserItemRequests.take(id);
-        BrowserItem item("movie:" + response.value("result").toMap().value("musicvideodetails").toMap().value("musicvideoid").toString());
-        item.setDisplayName(response.value("result").toMap().value("musicvideodetails").toMap().value("label").toString());
-        qCDebug(dcKodi()) << "Episode details:" << item.displayName();
-        result->finish(item);
-        return;
-    }
-
-    if (method == "VideoLibrary.Scan" || method == "VideoLibrary.Clean" || method == "AudioLibrary.Scan" || method == "AudioLibrary.Clean") {
-        emit browserItemActionExecuted(id, !response.contains("error"));
-        return;
-    }
-
-    if (method == "Player.Open") {
-        emit browserItemExecuted(id, !response.contains("error"));
-        return;
-    }
-
-    // Default
-    emit actionExecuted(id, !response.contains("error"));
+    qCWarning(dcKodi()) << "Unhandled browse response" << method;
+    return items;
 }
 
 void Kodi::updatePlayerProperties()
@@ -1035,8 +1168,13 @@ QString Kodi::prepareThumbnail(const QString &thumbnail)
     if (m_connection->hostAddress().protocol() == QAbstractSocket::IPv6Protocol) {
         addr = '[' + addr + ']';
     }
-    return QString("http://%1:%2/image/%3")
+    QString url = QString("http://%1:%2/image/%3")
                 .arg(addr)
                 .arg(m_httpPort)
                 .arg(QString(thumbnail.toUtf8().toPercentEncoding()));
+
+    if (m_thumbnailCache && m_thumbnailCache->isAvailable()) {
+        return m_thumbnailCache->thumbnailUrl(thumbnail, url, m_connection->localAddress());
+    }
+    return url;
 }
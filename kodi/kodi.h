@@ -33,9 +33,12 @@
 
 #include <QObject>
 #include <QHostAddress>
+#include <QPointer>
 
 #include "kodiconnection.h"
 #include "kodijsonhandler.h"
+#include "kodibrowsecache.h"
+#include "kodithumbnailcache.h"
 
 #include "types/browseritem.h"
 #include "types/browseritemaction.h"
@@ -77,6 +80,8 @@ public:
     void connectKodi();
     void disconnectKodi();
 
+    void setThumbnailCache(KodiThumbnailCache *thumbnailCache);
+
     void browse(BrowseResult *result);
     void browserItem(BrowserItemResult *result);
     int launchBrowserItem(const QString &itemId);
@@ -113,6 +118,23 @@ private slots:
 private:
     QString prepareThumbnail(const QString &thumbnail);
 
+    class BrowseRequest {
+    public:
+        QPointer<BrowseResult> result;
+        QString itemId;
+        QString method;
+        QVariantMap params;
+        bool cacheable = false;
+        QList<BrowserItem> items;
+        QStringList mediaIds;
+    };
+
+    void sendBrowseRequest(BrowseResult *result, const QString &method, const QVariantMap &params, bool cacheable);
+    void sendBrowsePage(const BrowseRequest &request);
+    void processBrowseResponse(int id, const QString &method, const QVariantMap &response);
+    QList<BrowserItem> browserItemsFromResponse(const QString &method, const QVariantMap &result, int offset);
+    void invalidateBrowseCache(const QString &method, const QVariantMap &data);
+
 private:
     KodiConnection *m_connection;
     int m_httpPort;
@@ -130,6 +152,8 @@ private:
         QList<VirtualFsNode*> childs;
         QString getMethod;
         QVariantMap getParams;
+        // Lists which change without a library notification, e.g. installed add-ons, are always fetched
+        bool cacheable = true;
         void addChild(VirtualFsNode* child) {childs.append(child); }
         VirtualFsNode *findNode(const QString &id) {
             if (item.id() == id) return this;
@@ -142,7 +166,9 @@ private:
     };
     VirtualFsNode* m_virtualFs = nullptr;
 
-    QHash<int, BrowseResult*> m_pendingBrowseRequests;
+    QHash<int, BrowseRequest> m_pendingBrowseRequests;
+    KodiBrowseCache m_browseCache;
+    QPointer<KodiThumbnailCache> m_thumbnailCache;
     QHash<int, BrowserItemResult*> m_pendingBrowserItemRequests;
 
 };
@@ -9,12 +9,16 @@ SOURCES += \
     kodiconnection.cpp \
     kodijsonhandler.cpp \
     kodi.cpp \
-    kodireply.cpp
+    kodireply.cpp \
+    kodibrowsecache.cpp \
+    kodithumbnailcache.cpp
 
 HEADERS += \
     integrationpluginkodi.h \
     kodiconnection.h \
     kodijsonhandler.h \
     kodi.h \
-    kodireply.h
+    kodireply.h \
+    kodibrowsecache.h \
+    kodithumbnailcache.h
 
@@ -0,0 +1,128 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "kodibrowsecache.h"
+
+KodiBrowseCache::KodiBrowseCache(int maxItems) :
+    m_maxItems(maxItems)
+{
+
+}
+
+bool KodiBrowseCache::lookup(const QString &key, QList<BrowserItem> *items)
+{
+    QHash<QString, Entry>::iterator entry = m_entries.find(key);
+    if (entry == m_entries.end()) {
+        m_misses++;
+        return false;
+    }
+
+    m_hits++;
+    m_lru.splice(m_lru.end(), m_lru, entry->lruPosition);
+    *items = entry->items;
+    return true;
+}
+
+void KodiBrowseCache::insert(const QString &key, const QList<BrowserItem> &items, const QStringList &mediaIds)
+{
+    invalidate(key);
+
+    Entry entry;
+    entry.items = items;
+    entry.mediaIds = mediaIds;
+    entry.lruPosition = m_lru.insert(m_lru.end(), key);
+    m_entries.insert(key, entry);
+    m_itemCount += items.count();
+    foreach (const QString &mediaId, mediaIds) {
+        m_mediaIndex[mediaId].insert(key);
+    }
+
+    // Evict the least recently used lists, but never the one just added
+    while (m_itemCount > m_maxItems && m_lru.size() > 1) {
+        // Copy, invalidate() erases the list node holding the key
+        QString oldest = m_lru.front();
+        invalidate(oldest);
+    }
+}
+
+void KodiBrowseCache::invalidate(const QString &key)
+{
+    if (!m_entries.contains(key))
+        return;
+
+    Entry entry = m_entries.take(key);
+    m_lru.erase(entry.lruPosition);
+    m_itemCount -= entry.items.count();
+    foreach (const QString &mediaId, entry.mediaIds) {
+        QSet<QString> &keys = m_mediaIndex[mediaId];
+        keys.remove(key);
+        if (keys.isEmpty()) {
+            m_mediaIndex.remove(mediaId);
+        }
+    }
+}
+
+void KodiBrowseCache::invalidatePrefix(const QString &prefix)
+{
+    foreach (const QString &key, m_entries.keys()) {
+        if (key.startsWith(prefix)) {
+            invalidate(key);
+        }
+    }
+}
+
+bool KodiBrowseCache::invalidateMedia(const QString &mediaId)
+{
+    if (!m_mediaIndex.contains(mediaId))
+        return false;
+
+    foreach (const QString &key, m_mediaIndex.value(mediaId)) {
+        invalidate(key);
+    }
+    return true;
+}
+
+void KodiBrowseCache::clear()
+{
+    m_entries.clear();
+    m_lru.clear();
+    m_mediaIndex.clear();
+    m_itemCount = 0;
+}
+
+int KodiBrowseCache::hits() const
+{
+    return m_hits;
+}
+
+int KodiBrowseCache::misses() const
+{
+    return m_misses;
+}
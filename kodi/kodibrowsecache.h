@@ -0,0 +1,79 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef KODIBROWSECACHE_H
+#define KODIBROWSECACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+#include <list>
+
+#include "types/browseritem.h"
+
+// LRU cache for browse results, keyed by the browser item id of the listed folder.
+// Remembers which media items (e.g. "movie:12") each cached list contains so a
+// library notification only drops the lists actually showing the changed item.
+class KodiBrowseCache
+{
+public:
+    explicit KodiBrowseCache(int maxItems = 20000);
+
+    // Counts a hit or miss and marks the list as recently used
+    bool lookup(const QString &key, QList<BrowserItem> *items);
+    void insert(const QString &key, const QList<BrowserItem> &items, const QStringList &mediaIds);
+
+    void invalidate(const QString &key);
+    void invalidatePrefix(const QString &prefix);
+    // Returns false if no cached list contains the given media item
+    bool invalidateMedia(const QString &mediaId);
+    void clear();
+
+    int hits() const;
+    int misses() const;
+
+private:
+    struct Entry {
+        QList<BrowserItem> items;
+        QStringList mediaIds;
+        std::list<QString>::iterator lruPosition;
+    };
+
+    QHash<QString, Entry> m_entries;
+    std::list<QString> m_lru; // least recently used first, entries point to their position
+    QHash<QString, QSet<QString>> m_mediaIndex; // media id -> cache keys
+    int m_itemCount = 0;
+    int m_maxItems;
+    int m_hits = 0;
+    int m_misses = 0;
+};
+
+#endif // KODIBROWSECACHE_H
@@ -66,6 +66,11 @@ QHostAddress KodiConnection::hostAddress() const
     return m_hostAddress;
 }
 
+QHostAddress KodiConnection::localAddress() const
+{
+    return m_socket->localAddress();
+}
+
 int KodiConnection::port() const
 {
     return m_port;
@@ -79,6 +84,7 @@ bool KodiConnection::connected()
 void KodiConnection::onConnected()
 {
     qCDebug(dcKodi) << "connected successfully to" << hostAddress().toString() << port();
+    resetFraming();
     m_connected = true;
     emit connectionStatusChanged();
 }
@@ -99,22 +105,76 @@ void KodiConnection::onError(QAbstractSocket::SocketError socketError)
 
 void KodiConnection::readData()
 {
-    QByteArray data = m_socket->readAll();
-
-    QStringList commandList = QString(data).split("}{");
-    for(int i = 0; i < commandList.count(); ++i) {
-        QString command = commandList.at(i);
-        if(command.isEmpty()) {
+    // Kodi sends JSON messages back to back without any delimiter. Find the message
+    // boundaries by tracking the nesting depth, ignoring brackets inside of strings.
+    // Only the newly received bytes are scanned, so large replies arriving in many
+    // segments are framed in linear time.
+    m_buffer.append(m_socket->readAll());
+
+    const char *data = m_buffer.constData();
+    int size = m_buffer.size();
+    for (int i = m_scanPosition; i < size; i++) {
+        char c = data[i];
+        if (m_inString) {
+            if (m_escape) {
+                m_escape = false;
+            } else if (c == '\\') {
+                m_escape = true;
+            } else if (c == '"') {
+                m_inString = false;
+            }
             continue;
         }
-        if(i < commandList.count() - 1) {
-            command.append("}");
-        }
-        if(i > 0) {
-            command.prepend("{");
+
+        switch (c) {
+        case '"':
+            if (m_depth > 0) {
+                m_inString = true;
+            }
+            break;
+        case '{':
+        case '[':
+            if (m_depth == 0) {
+                m_messageStart = i;
+            }
+            m_depth++;
+            break;
+        case '}':
+        case ']':
+            if (m_depth == 0) {
+                qCWarning(dcKodi) << "Unexpected" << c << "outside of a message. Ignoring.";
+                break;
+            }
+            m_depth--;
+            if (m_depth == 0) {
+                emit dataReady(m_buffer.mid(m_messageStart, i - m_messageStart + 1));
+            }
+            break;
+        default:
+            break;
         }
-        emit dataReady(command.toUtf8());
     }
+
+    if (m_depth == 0) {
+        // Everything consumed, only whitespace may be left
+        m_buffer.clear();
+        m_scanPosition = 0;
+    } else {
+        // Keep the incomplete message only
+        m_buffer.remove(0, m_messageStart);
+        m_scanPosition = m_buffer.size();
+        m_messageStart = 0;
+    }
+}
+
+void KodiConnection::resetFraming()
+{
+    m_buffer.clear();
+    m_scanPosition = 0;
+    m_messageStart = 0;
+    m_depth = 0;
+    m_inString = false;
+    m_escape = false;
 }
 
 void KodiConnection::sendData(const QByteArray &message)
@@ -46,6 +46,7 @@ public:
     void disconnectKodi();
 
     QHostAddress hostAddress() const;
+    QHostAddress localAddress() const;
     int port() const;
     int httpPort() const;
 
@@ -58,6 +59,16 @@ private:
     int m_port;
     bool m_connected;
 
+    // Incremental JSON framing state, kept across reads
+    QByteArray m_buffer;
+    int m_scanPosition = 0;
+    int m_messageStart = 0;
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escape = false;
+
+    void resetFraming();
+
 private slots:
     void onConnected();
     void onDisconnected();
@@ -0,0 +1,324 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "kodithumbnailcache.h"
+#include "extern-plugininfo.h"
+
+#include <QCryptographicHash>
+#include <QNetworkReply>
+#include <QImage>
+#include <QFile>
+#include <QTimer>
+
+// Connections without any progress for this time are closed
+static const int idleTimeout = 10000;
+static const int maxRequestLineSize = 8192;
+
+// Stores the resolution the cached images were scaled to, hidden files are not part of the cache
+static const char *resolutionFileName = ".resolution";
+
+KodiThumbnailCache::KodiThumbnailCache(NetworkAccessManager *networkManager, const QString &cachePath, quint16 port, int maxResolution, QObject *parent) :
+    QObject(parent),
+    m_networkManager(networkManager),
+    m_cacheDir(cachePath),
+    m_maxResolution(maxResolution)
+{
+    if (!m_cacheDir.exists() && !m_cacheDir.mkpath(".")) {
+        qCWarning(dcKodi()) << "Unable to create thumbnail cache directory" << cachePath;
+    }
+    loadCache();
+
+    m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection, this, &KodiThumbnailCache::onNewConnection);
+    // A fixed port keeps the thumbnail URLs handed out to clients valid across restarts
+    if (!m_server->listen(QHostAddress::Any, port)) {
+        qCWarning(dcKodi()) << "Unable to start thumbnail cache server on port" << port << m_server->errorString();
+        return;
+    }
+    qCDebug(dcKodi()) << "Thumbnail cache serving" << m_fileSizes.count() << "cached images on port" << m_server->serverPort();
+}
+
+bool KodiThumbnailCache::isAvailable() const
+{
+    return m_server->isListening();
+}
+
+quint16 KodiThumbnailCache::port() const
+{
+    return m_server->serverPort();
+}
+
+void KodiThumbnailCache::setMaxCacheSize(qint64 maxCacheSize)
+{
+    m_maxCacheSize = maxCacheSize;
+    evict();
+}
+
+void KodiThumbnailCache::setMaxResolution(int maxResolution)
+{
+    if (m_maxResolution == maxResolution)
+        return;
+
+    // Images already cached were scaled for a different resolution
+    m_maxResolution = maxResolution;
+    clearCache();
+    writeResolution();
+}
+
+QString KodiThumbnailCache::thumbnailUrl(const QString &imageUri, const QString &sourceUrl, const QHostAddress &localAddress)
+{
+    QString key = keyForImage(imageUri);
+    m_sources.insert(key, sourceUrl);
+
+    QString addr = localAddress.toString();
+    if (localAddress.protocol() == QAbstractSocket::IPv6Protocol) {
+        addr = '[' + addr + ']';
+    }
+    return QString("http://%1:%2/thumbnails/%3").arg(addr).arg(m_server->serverPort()).arg(key);
+}
+
+int KodiThumbnailCache::hits() const
+{
+    return m_hits;
+}
+
+int KodiThumbnailCache::misses() const
+{
+    return m_misses;
+}
+
+void KodiThumbnailCache::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket](){
+            processRequest(socket);
+        });
+
+        // Every response closes the connection, clients which don't send a request or don't
+        // read the response must not keep the socket and its buffers around
+        QTimer *timer = new QTimer(socket);
+        timer->setSingleShot(true);
+        timer->setInterval(idleTimeout);
+        connect(timer, &QTimer::timeout, socket, [socket](){
+            qCDebug(dcKodi()) << "Closing idle thumbnail cache connection from" << socket->peerAddress().toString();
+            socket->abort();
+        });
+        connect(socket, &QTcpSocket::bytesWritten, timer, [timer](){
+            timer->start();
+        });
+        timer->start();
+    }
+}
+
+void KodiThumbnailCache::loadCache()
+{
+    QFile resolutionFile(m_cacheDir.filePath(resolutionFileName));
+    int cachedResolution = 0;
+    if (resolutionFile.open(QFile::ReadOnly)) {
+        cachedResolution = resolutionFile.readAll().trimmed().toInt();
+        resolutionFile.close();
+    }
+
+    // Oldest first, so the LRU order survives restarts at least by modification time
+    foreach (const QFileInfo &fileInfo, m_cacheDir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed)) {
+        m_lru.append(fileInfo.fileName());
+        m_fileSizes.insert(fileInfo.fileName(), fileInfo.size());
+        m_cacheSize += fileInfo.size();
+    }
+
+    if (cachedResolution != m_maxResolution) {
+        if (!m_lru.isEmpty()) {
+            qCDebug(dcKodi()) << "Thumbnail resolution changed from" << cachedResolution << "to" << m_maxResolution << "clearing the cache";
+        }
+        clearCache();
+        writeResolution();
+    }
+    evict();
+}
+
+void KodiThumbnailCache::clearCache()
+{
+    foreach (const QString &key, m_lru) {
+        m_cacheDir.remove(key);
+    }
+    m_lru.clear();
+    m_fileSizes.clear();
+    m_cacheSize = 0;
+}
+
+void KodiThumbnailCache::writeResolution()
+{
+    QFile resolutionFile(m_cacheDir.filePath(resolutionFileName));
+    if (!resolutionFile.open(QFile::WriteOnly | QFile::Truncate) || resolutionFile.write(QByteArray::number(m_maxResolution)) < 0) {
+        qCWarning(dcKodi()) << "Unable to write" << resolutionFile.fileName();
+    }
+}
+
+void KodiThumbnailCache::processRequest(QTcpSocket *socket)
+{
+    // Only the request line matters, the connection is closed after each response
+    if (socket->property("handled").toBool()) {
+        socket->readAll();
+        return;
+    }
+
+    if (!socket->canReadLine()) {
+        if (socket->bytesAvailable() > maxRequestLineSize) {
+            socket->setProperty("handled", true);
+            socket->readAll();
+            sendError(socket, 414, "URI Too Long");
+        }
+        return;
+    }
+
+    socket->setProperty("handled", true);
+    QList<QByteArray> requestLine = socket->readLine().trimmed().split(' ');
+    socket->readAll();
+
+    if (requestLine.count() < 2 || requestLine.at(0) != "GET" || !requestLine.at(1).startsWith("/thumbnails/")) {
+        sendError(socket, 404, "Not Found");
+        return;
+    }
+
+    QString key = QString::fromUtf8(requestLine.at(1).mid(12));
+    if (m_fileSizes.contains(key)) {
+        m_hits++;
+        sendFile(socket, key);
+        return;
+    }
+
+    if (!m_sources.contains(key)) {
+        sendError(socket, 404, "Not Found");
+        return;
+    }
+
+    bool fetching = m_pendingClients.contains(key);
+    m_pendingClients[key].append(socket);
+    if (!fetching) {
+        m_misses++;
+        fetch(key);
+    }
+}
+
+void KodiThumbnailCache::fetch(const QString &key)
+{
+    QNetworkReply *reply = m_networkManager->get(QNetworkRequest(QUrl(m_sources.value(key))));
+    connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key](){
+        QList<QPointer<QTcpSocket>> clients = m_pendingClients.take(key);
+
+        if (reply->error() != QNetworkReply::NoError) {
+            qCWarning(dcKodi()) << "Unable to fetch thumbnail" << reply->url().toString() << reply->errorString();
+        } else {
+            store(key, reply->readAll());
+        }
+
+        foreach (QTcpSocket *socket, clients) {
+            if (!socket) {
+                continue;
+            }
+            if (m_fileSizes.contains(key)) {
+                sendFile(socket, key);
+            } else {
+                sendError(socket, 502, "Bad Gateway");
+            }
+        }
+        qCDebug(dcKodi()) << "Thumbnail cache hits:" << m_hits << "misses:" << m_misses << "size:" << m_cacheSize / 1024 << "kB";
+    });
+}
+
+void KodiThumbnailCache::store(const QString &key, const QByteArray &imageData)
+{
+    QImage image;
+    if (!image.loadFromData(imageData)) {
+        qCWarning(dcKodi()) << "Unable to decode thumbnail" << m_sources.value(key);
+        return;
+    }
+
+    if (image.width() > m_maxResolution || image.height() > m_maxResolution) {
+        image = image.scaled(m_maxResolution, m_maxResolution, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QFile file(m_cacheDir.filePath(key));
+    if (!file.open(QFile::WriteOnly) || !image.save(&file, image.hasAlphaChannel() ? "PNG" : "JPG", 85)) {
+        qCWarning(dcKodi()) << "Unable to write thumbnail to cache" << file.fileName();
+        file.remove();
+        return;
+    }
+
+    m_lru.append(key);
+    m_fileSizes.insert(key, file.size());
+    m_cacheSize += file.size();
+    evict();
+}
+
+void KodiThumbnailCache::evict()
+{
+    // Never evict the most recent entry, it might be sent out right now
+    while (m_cacheSize > m_maxCacheSize && m_lru.count() > 1) {
+        QString key = m_lru.takeFirst();
+        m_cacheSize -= m_fileSizes.take(key);
+        m_cacheDir.remove(key);
+    }
+}
+
+void KodiThumbnailCache::sendFile(QTcpSocket *socket, const QString &key)
+{
+    QFile file(m_cacheDir.filePath(key));
+    if (!file.open(QFile::ReadOnly)) {
+        sendError(socket, 404, "Not Found");
+        return;
+    }
+    QByteArray data = file.readAll();
+
+    m_lru.removeOne(key);
+    m_lru.append(key);
+
+    QByteArray header = "HTTP/1.1 200 OK\r\n";
+    header += "Content-Type: " + QByteArray(data.startsWith("\x89PNG") ? "image/png" : "image/jpeg") + "\r\n";
+    header += "Content-Length: " + QByteArray::number(data.size()) + "\r\n";
+    header += "Cache-Control: max-age=86400\r\n";
+    header += "Connection: close\r\n\r\n";
+    socket->write(header + data);
+    socket->disconnectFromHost();
+}
+
+void KodiThumbnailCache::sendError(QTcpSocket *socket, int status, const QByteArray &reason)
+{
+    socket->write("HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    socket->disconnectFromHost();
+}
+
+QString KodiThumbnailCache::keyForImage(const QString &imageUri)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(imageUri.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
@@ -0,0 +1,97 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef KODITHUMBNAILCACHE_H
+#define KODITHUMBNAILCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QDir>
+#include <QTcpServer>
+#include <QHostAddress>
+#include <QPointer>
+#include <QTcpSocket>
+
+#include "network/networkaccessmanager.h"
+
+
+// Fetches Kodi artwork once, stores a downscaled copy in a size bounded LRU on disk
+// and serves it to clients via a minimal HTTP server. Clients get the URL of the
+// cached copy from thumbnailUrl(), the image is fetched from Kodi on first request.
+class KodiThumbnailCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit KodiThumbnailCache(NetworkAccessManager *networkManager, const QString &cachePath, quint16 port, int maxResolution, QObject *parent = nullptr);
+
+    bool isAvailable() const;
+    quint16 port() const;
+
+    void setMaxCacheSize(qint64 maxCacheSize);
+    void setMaxResolution(int maxResolution);
+
+    // Returns the URL of the cached copy of the Kodi image URI, reachable via the given local address.
+    // sourceUrl is where the image can be fetched from Kodi if it isn't cached yet.
+    QString thumbnailUrl(const QString &imageUri, const QString &sourceUrl, const QHostAddress &localAddress);
+
+    int hits() const;
+    int misses() const;
+
+private slots:
+    void onNewConnection();
+
+private:
+    NetworkAccessManager *m_networkManager = nullptr;
+    QTcpServer *m_server = nullptr;
+    QDir m_cacheDir;
+    qint64 m_maxCacheSize = 100 * 1024 * 1024;
+    int m_maxResolution = 512;
+
+    QHash<QString, QString> m_sources; // key -> Kodi image URL
+    QHash<QString, qint64> m_fileSizes; // key -> size of the cached file
+    QStringList m_lru; // least recently used first
+    qint64 m_cacheSize = 0;
+    QHash<QString, QList<QPointer<QTcpSocket>>> m_pendingClients;
+    int m_hits = 0;
+    int m_misses = 0;
+
+    void loadCache();
+    void clearCache();
+    void writeResolution();
+    void processRequest(QTcpSocket *socket);
+    void fetch(const QString &key);
+    void store(const QString &key, const QByteArray &imageData);
+    void evict();
+    void sendFile(QTcpSocket *socket, const QString &key);
+    void sendError(QTcpSocket *socket, int status, const QByteArray &reason);
+    static QString keyForImage(const QString &imageUri);
+};
+
+#endif // KODITHUMBNAILCACHE_H
@@ -37,6 +37,11 @@
 
 IntegrationPluginOneWire::IntegrationPluginOneWire()
 {
+    m_owfsAddressParamTypeIds.insert(temperatureSensorThingClassId, temperatureSensorThingAddressParamTypeId);
+    m_owfsAddressParamTypeIds.insert(temperatureHumiditySensorThingClassId, temperatureHumiditySensorThingAddressParamTypeId);
+    m_owfsAddressParamTypeIds.insert(singleChannelSwitchThingClassId, singleChannelSwitchThingAddressParamTypeId);
+    m_owfsAddressParamTypeIds.insert(dualChannelSwitchThingClassId, dualChannelSwitchThingAddressParamTypeId);
+    m_owfsAddressParamTypeIds.insert(eightChannelSwitchThingClassId, eightChannelSwitchThingAddressParamTypeId);
 }
 
 void IntegrationPluginOneWire::discoverThings(ThingDiscoveryInfo *info)
@@ -52,6 +57,7 @@ void IntegrationPluginOneWire::discoverThings(ThingDiscoveryInfo *info)
         if (myThings().filterByThingClassId(oneWireInterfaceThingClassId).isEmpty()) {
             if (!m_w1Interface) {
                 m_w1Interface = new W1(this);
+                connect(m_w1Interface, &W1::temperaturesRead, this, &IntegrationPluginOneWire::onW1TemperaturesRead);
             }
 
             if (!m_w1Interface->interfaceIsAvailable()) {
@@ -129,6 +135,7 @@ void IntegrationPluginOneWire::setupThing(ThingSetupInfo *info)
             return info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Error initializing one wire interface."));
         }
         connect(m_owfsInterface, &Owfs::devicesDiscovered, this, &IntegrationPluginOneWire::onOneWireDevicesDiscovered);
+        connect(m_owfsInterface, &Owfs::devicesPolled, this, &IntegrationPluginOneWire::onOwfsDevicesPolled);
         return info->finish(Thing::ThingErrorNoError);
 
     } else if (thing->thingClassId() == temperatureSensorThingClassId) {
@@ -152,11 +159,13 @@ void IntegrationPluginOneWire::setupThing(ThingSetupInfo *info)
         } else {
             if (!m_w1Interface) {
                 m_w1Interface = new W1(this);
+                connect(m_w1Interface, &W1::temperaturesRead, this, &IntegrationPluginOneWire::onW1TemperaturesRead);
             }
             if (m_w1Interface->interfaceIsAvailable()) {
                 QString address = thing->paramValue(temperatureSensorThingAddressParamTypeId).toString();
                 thing->setStateValue(temperatureSensorConnectedStateTypeId,  m_w1Interface->deviceAvailable(address));
-                thing->setStateValue(temperatureSensorTemperatureStateTypeId, m_w1Interface->getTemperature(address));
+                // The first temperature value arrives asynchronously
+                m_w1Interface->readTemperatures(QStringList() << address);
                 return info->finish(Thing::ThingErrorNoError);
             } else {
                 qCWarning(dcOneWire()) << "W1 interface is not available";
@@ -183,73 +192,17 @@ void IntegrationPluginOneWire::setupThing(ThingSetupInfo *info)
 
     } else if (thing->thingClassId() == singleChannelSwitchThingClassId) {
         qCDebug(dcOneWire) << "Setup one wire switch" << thing->params();
-        if (m_owfsInterface) {
-            QByteArray address = thing->paramValue(singleChannelSwitchThingAddressParamTypeId).toByteArray();
-            thing->setStateValue(singleChannelSwitchConnectedStateTypeId, m_owfsInterface->isConnected(address));
-            bool ok;
-            bool output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_A, &ok);
-            if (ok) {
-                thing->setStateValue(singleChannelSwitchDigitalOutputStateTypeId, output);
-            }
-        }
+        // The states are read with the next poll of the OWFS bus
         return info->finish(Thing::ThingErrorNoError);
 
     } else if (thing->thingClassId() == dualChannelSwitchThingClassId) {
         qCDebug(dcOneWire) << "Setup one wire dual switch" << thing->params();
-        if (m_owfsInterface) {
-            QByteArray address = thing->paramValue(dualChannelSwitchThingAddressParamTypeId).toByteArray();
-            thing->setStateValue(dualChannelSwitchConnectedStateTypeId, m_owfsInterface->isConnected(address));
-            bool ok;
-            bool output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_A, &ok);
-            if (ok) {
-                thing->setStateValue(dualChannelSwitchDigitalOutput1StateTypeId, output);
-            }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_B, &ok);
-            if (ok) {
-                thing->setStateValue(dualChannelSwitchDigitalOutput2StateTypeId, output);
-            }
-        }
+        // The states are read with the next poll of the OWFS bus
         return info->finish(Thing::ThingErrorNoError);
 
     } else if (thing->thingClassId() == eightChannelSwitchThingClassId) {
         qCDebug(dcOneWire) << "Setup one wire eight channel switch" << thing->params();
-        if (m_owfsInterface) {
-            QByteArray address = thing->paramValue(eightChannelSwitchThingAddressParamTypeId).toByteArray();
-            thing->setStateValue(eightChannelSwitchConnectedStateTypeId, m_owfsInterface->isConnected(address));
-            bool ok;
-            bool output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_A, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput1StateTypeId, output);
-            }
-            output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_B, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput2StateTypeId, output);
-            }
-            output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_C, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput3StateTypeId, output);
-            }
-            output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_D, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput4StateTypeId, output);
-            }
-            output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_E, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput5StateTypeId, output);
-            }
-            output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_F, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput6StateTypeId, output);
-            }
-            output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_G, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput7StateTypeId, output);
-            }
-            output =  m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_H, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput8StateTypeId, output);
-            }
-        }
+        // The states are read with the next poll of the OWFS bus
         return info->finish(Thing::ThingErrorNoError);
     } else {
         return info->finish(Thing::ThingErrorThingNotFound);
@@ -258,12 +211,14 @@ void IntegrationPluginOneWire::setupThing(ThingSetupInfo *info)
 
 void IntegrationPluginOneWire::postSetupThing(Thing *thing)
 {
-    Q_UNUSED(thing);
-
     if(!m_pluginTimer) {
         m_pluginTimer = hardwareManager()->pluginTimerManager()->registerTimer(10);
         connect(m_pluginTimer, &PluginTimer::timeout, this, &IntegrationPluginOneWire::onPluginTimer);
     }
+
+    if (!thing->parentId().isNull() && m_owfsAddressParamTypeIds.contains(thing->thingClassId())) {
+        pollOwfsDevices();
+    }
 }
 
 void IntegrationPluginOneWire::executeAction(ThingActionInfo *info)
@@ -355,15 +310,8 @@ void IntegrationPluginOneWire::thingRemoved(Thing *thing)
 
 void IntegrationPluginOneWire::setupOwfsTemperatureSensor(ThingSetupInfo *info)
 {
-    Thing *thing = info->thing();
-    QByteArray address = thing->paramValue(temperatureSensorThingAddressParamTypeId).toByteArray();
     if (m_owfsInterface) {
-        thing->setStateValue(temperatureSensorConnectedStateTypeId,  m_owfsInterface->isConnected(address));
-        bool ok;
-        double temp = m_owfsInterface->getTemperature(address, &ok);
-        if (ok) {
-            thing->setStateValue(temperatureSensorTemperatureStateTypeId, temp);
-        }
+        // The states are read with the next poll of the OWFS bus
         return info->finish(Thing::ThingErrorNoError);
     } else {
         qCWarning(dcOneWire()) << "OWFS interface is not available";
@@ -373,19 +321,8 @@ void IntegrationPluginOneWire::setupOwfsTemperatureSensor(ThingSetupInfo *info)
 
 void IntegrationPluginOneWire::setupOwfsTemperatureHumiditySensor(ThingSetupInfo *info)
 {
-    Thing *thing = info->thing();
-    QByteArray address = thing->paramValue(temperatureHumiditySensorThingAddressParamTypeId).toByteArray();
     if (m_owfsInterface) {
-        thing->setStateValue(temperatureHumiditySensorConnectedStateTypeId,  m_owfsInterface->isConnected(address));
-        bool ok;
-        double temp = m_owfsInterface->getTemperature(address, &ok);
-        if (ok) {
-            thing->setStateValue(temperatureHumiditySensorTemperatureStateTypeId, temp);
-        }
-        double humidity = m_owfsInterface->getHumidity(address, &ok);
-        if (ok) {
-            thing->setStateValue(temperatureHumiditySensorHumidityStateTypeId, humidity);
-        }
+        // The states are read with the next poll of the OWFS bus
         return info->finish(Thing::ThingErrorNoError);
     } else {
         qCWarning(dcOneWire()) << "OWFS interface is not available";
@@ -395,110 +332,118 @@ void IntegrationPluginOneWire::setupOwfsTemperatureHumiditySensor(ThingSetupInfo
 
 void IntegrationPluginOneWire::onPluginTimer()
 {
+    // All w1 sensors are read in one go by the worker thread, the results come in through onW1TemperaturesRead()
+    if (m_w1Interface) {
+        QStringList addresses;
+        foreach (Thing *thing, myThings().filterByThingClassId(temperatureSensorThingClassId)) {
+            if (thing->parentId().isNull()) {
+                addresses.append(thing->paramValue(temperatureSensorThingAddressParamTypeId).toString());
+            }
+        }
+        if (!addresses.isEmpty()) {
+            m_w1Interface->readTemperatures(addresses);
+        }
+    }
+
+    foreach (Thing *thing, myThings().filterByThingClassId(oneWireInterfaceThingClassId)) {
+        thing->setStateValue(oneWireInterfaceConnectedStateTypeId, m_owfsInterface && m_owfsInterface->interfaceIsAvailable());
+    }
+
+    pollOwfsDevices();
+}
+
+void IntegrationPluginOneWire::pollOwfsDevices()
+{
+    if (!m_owfsInterface) {
+        return;
+    }
+
+    QList<Owfs::OwfsDevice> devices;
     foreach (Thing *thing, myThings()) {
-        if (thing->thingClassId() == oneWireInterfaceThingClassId) {
-            thing->setStateValue(oneWireInterfaceConnectedStateTypeId, m_owfsInterface->interfaceIsAvailable());
+        if (thing->parentId().isNull() || !m_owfsAddressParamTypeIds.contains(thing->thingClassId())) {
+            continue;
+        }
+        Owfs::OwfsDevice device;
+        device.address = thing->paramValue(m_owfsAddressParamTypeIds.value(thing->thingClassId())).toByteArray();
+        device.family = device.address.split('.').first().toInt(nullptr, 16);
+        devices.append(device);
+    }
+    if (!devices.isEmpty()) {
+        m_owfsInterface->poll(devices);
+    }
+}
 
-        } else if (thing->thingClassId() == temperatureSensorThingClassId) {
-            QByteArray address = thing->paramValue(temperatureSensorThingAddressParamTypeId).toByteArray();
-            bool ok = true;
-            double temperature = 0;
-            bool connected = false;
+void IntegrationPluginOneWire::onOwfsDevicesPolled(const QList<Owfs::DeviceState> &states)
+{
+    QHash<QByteArray, Owfs::DeviceState> stateHash;
+    foreach (const Owfs::DeviceState &state, states) {
+        stateHash.insert(state.address, state);
+    }
 
-            if (!thing->parentId().isNull()) {
-                if (m_owfsInterface) {
-                    connected = m_owfsInterface->isConnected(address);
-                    bool ok;
-                    temperature = m_owfsInterface->getTemperature(address, &ok);
-                } else {
-                    qCWarning(dcOneWire()) << "onPlugInTimer: OWFS interface not setup for thing" << thing->name();
-                }
+    foreach (Thing *thing, myThings()) {
+        if (thing->parentId().isNull() || !m_owfsAddressParamTypeIds.contains(thing->thingClassId())) {
+            continue;
+        }
+        QByteArray address = thing->paramValue(m_owfsAddressParamTypeIds.value(thing->thingClassId())).toByteArray();
+        if (!stateHash.contains(address)) {
+            continue;
+        }
+        Owfs::DeviceState state = stateHash.value(address);
 
-            } else {
-                temperature = m_w1Interface->getTemperature(address);
-                connected = m_w1Interface->deviceAvailable(address);
+        if (thing->thingClassId() == temperatureSensorThingClassId) {
+            if (state.temperatureValid) {
+                thing->setStateValue(temperatureSensorTemperatureStateTypeId, state.temperature);
             }
+            thing->setStateValue(temperatureSensorConnectedStateTypeId, state.connected);
 
-            if (ok) {
-                thing->setStateValue(temperatureSensorTemperatureStateTypeId, temperature);
-            }
-            thing->setStateValue(temperatureSensorConnectedStateTypeId, connected);
         } else if (thing->thingClassId() == temperatureHumiditySensorThingClassId)  {
-            if (!m_owfsInterface)
-                continue;
-            QByteArray address = thing->paramValue(temperatureHumiditySensorThingAddressParamTypeId).toByteArray();
-            bool ok;
-            double temp = m_owfsInterface->getTemperature(address, &ok);
-            if (ok) {
-                thing->setStateValue(temperatureHumiditySensorTemperatureStateTypeId, temp);
+            if (state.temperatureValid) {
+                thing->setStateValue(temperatureHumiditySensorTemperatureStateTypeId, state.temperature);
             }
-            double humidity = m_owfsInterface->getHumidity(address, &ok);
-            if (ok) {
-                thing->setStateValue(temperatureHumiditySensorHumidityStateTypeId, humidity);
+            if (state.humidityValid) {
+                thing->setStateValue(temperatureHumiditySensorHumidityStateTypeId, state.humidity);
             }
-            thing->setStateValue(temperatureHumiditySensorConnectedStateTypeId, m_owfsInterface->isConnected(address));
+            thing->setStateValue(temperatureHumiditySensorConnectedStateTypeId, state.connected);
+
         } else if (thing->thingClassId() == singleChannelSwitchThingClassId) {
-            if (!m_owfsInterface)
-                continue;
-            QByteArray address = thing->paramValue(singleChannelSwitchThingAddressParamTypeId).toByteArray();
-            bool ok;
-            bool output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_A, &ok);
-            if (ok) {
-                thing->setStateValue(singleChannelSwitchDigitalOutputStateTypeId, output);
+            if (state.switchOutputs.count() >= 1) {
+                thing->setStateValue(singleChannelSwitchDigitalOutputStateTypeId, state.switchOutputs.at(0));
             }
-            thing->setStateValue(singleChannelSwitchConnectedStateTypeId, m_owfsInterface->isConnected(address));
+            thing->setStateValue(singleChannelSwitchConnectedStateTypeId, state.connected);
+
         } else if (thing->thingClassId() == dualChannelSwitchThingClassId) {
-            if (!m_owfsInterface)
-                continue;
-            QByteArray address = thing->paramValue(dualChannelSwitchThingAddressParamTypeId).toByteArray();
-            bool ok;
-            bool output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_A, &ok);
-            if (ok) {
-                thing->setStateValue(dualChannelSwitchDigitalOutput1StateTypeId, output);
+            if (state.switchOutputs.count() >= 2) {
+                thing->setStateValue(dualChannelSwitchDigitalOutput1StateTypeId, state.switchOutputs.at(0));
+                thing->setStateValue(dualChannelSwitchDigitalOutput2StateTypeId, state.switchOutputs.at(1));
             }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_B, &ok);
-            if (ok) {
-                thing->setStateValue(dualChannelSwitchDigitalOutput2StateTypeId, output);
-            }
-            thing->setStateValue(dualChannelSwitchConnectedStateTypeId, m_owfsInterface->isConnected(address));
+            thing->setStateValue(dualChannelSwitchConnectedStateTypeId, state.connected);
+
         } else if (thing->thingClassId() == eightChannelSwitchThingClassId) {
-            if (!m_owfsInterface)
+            static const QList<StateTypeId> outputStateTypeIds = {
+                eightChannelSwitchDigitalOutput1StateTypeId, eightChannelSwitchDigitalOutput2StateTypeId,
+                eightChannelSwitchDigitalOutput3StateTypeId, eightChannelSwitchDigitalOutput4StateTypeId,
+                eightChannelSwitchDigitalOutput5StateTypeId, eightChannelSwitchDigitalOutput6StateTypeId,
+                eightChannelSwitchDigitalOutput7StateTypeId, eightChannelSwitchDigitalOutput8StateTypeId
+            };
+            for (int i = 0; i < qMin(state.switchOutputs.count(), outputStateTypeIds.count()); i++) {
+                thing->setStateValue(outputStateTypeIds.at(i), state.switchOutputs.at(i));
+            }
+            thing->setStateValue(eightChannelSwitchConnectedStateTypeId, state.connected);
+        }
+    }
+}
+
+void IntegrationPluginOneWire::onW1TemperaturesRead(const QList<W1::TemperatureReading> &readings)
+{
+    foreach (const W1::TemperatureReading &reading, readings) {
+        foreach (Thing *thing, myThings().filterByParam(temperatureSensorThingAddressParamTypeId, reading.address)) {
+            if (!thing->parentId().isNull()) {
                 continue;
-            QByteArray address = thing->paramValue(eightChannelSwitchThingAddressParamTypeId).toByteArray();
-            bool ok;
-            bool output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_A, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput1StateTypeId, output);
-            }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_B, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput2StateTypeId, output);
-            }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_C, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput3StateTypeId, output);
-            }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_D, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput4StateTypeId, output);
-            }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_E, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput5StateTypeId, output);
-            }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_F, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput6StateTypeId, output);
-            }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_G, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput7StateTypeId, output);
             }
-            output = m_owfsInterface->getSwitchOutput(address, Owfs::SwitchChannel::PIO_H, &ok);
-            if (ok) {
-                thing->setStateValue(eightChannelSwitchDigitalOutput8StateTypeId, output);
+            if (reading.valid) {
+                thing->setStateValue(temperatureSensorTemperatureStateTypeId, reading.temperature);
             }
-            thing->setStateValue(eightChannelSwitchConnectedStateTypeId, m_owfsInterface->isConnected(address));
+            thing->setStateValue(temperatureSensorConnectedStateTypeId, reading.connected);
         }
     }
 }
@@ -61,12 +61,16 @@ private:
     W1 *m_w1Interface = nullptr;
 
     QHash<Thing*, ThingDiscoveryInfo*> m_runningDiscoveries;
+    QHash<ThingClassId, ParamTypeId> m_owfsAddressParamTypeIds;
 
     void setupOwfsTemperatureSensor(ThingSetupInfo *info);
     void setupOwfsTemperatureHumiditySensor(ThingSetupInfo *info);
+    void pollOwfsDevices();
 
 private slots:
     void onPluginTimer();
+    void onW1TemperaturesRead(const QList<W1::TemperatureReading> &readings);
+    void onOwfsDevicesPolled(const QList<Owfs::DeviceState> &states);
     void onOneWireDevicesDiscovered(QList<Owfs::OwfsDevice> devices);
 };
 
@@ -9,10 +9,14 @@ LIBS +=      \
 SOURCES += \
     integrationpluginonewire.cpp \
     owfs.cpp \
+    owfsworker.cpp \
     w1.cpp \
+    w1worker.cpp \
 
 HEADERS += \
     integrationpluginonewire.h \
     owfs.h \
+    owfsworker.h \
     w1.h \
+    w1worker.h \
 
@@ -29,6 +29,7 @@
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include "owfs.h"
+#include "owfsworker.h"
 #include "extern-plugininfo.h"
 
 Owfs::Owfs(QObject *parent) :
@@ -39,6 +40,10 @@ Owfs::Owfs(QObject *parent) :
 
 Owfs::~Owfs()
 {
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+    }
     OW_finish();
 }
 
@@ -60,6 +65,38 @@ bool Owfs::init(const QByteArray &owfsInitArguments)
         return false;
     }
     m_path = "/";
+
+    // Bus transactions block for the duration of the conversions, run the polling in a separate thread
+    qRegisterMetaType<QList<Owfs::OwfsDevice> >();
+    qRegisterMetaType<QList<Owfs::DeviceState> >();
+    m_thread = new QThread(this);
+    m_worker = new OwfsWorker(m_path);
+    m_worker->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &OwfsWorker::devicesPolled, this, &Owfs::devicesPolled);
+    connect(m_worker, &OwfsWorker::finished, this, [this](){
+        m_polling = false;
+    });
+    m_thread->start();
+    return true;
+}
+
+bool Owfs::isTemperatureSensorFamily(int family)
+{
+    return family == 0x10 || family == 0x22 || family == 0x28 || family == 0x3b;
+}
+
+bool Owfs::poll(const QList<OwfsDevice> &devices)
+{
+    if (!m_worker) {
+        return false;
+    }
+    if (m_polling) {
+        qCDebug(dcOneWire()) << "Previous poll still in progress, skipping this cycle";
+        return false;
+    }
+    m_polling = true;
+    QMetaObject::invokeMethod(m_worker, "poll", Qt::QueuedConnection, Q_ARG(QList<Owfs::OwfsDevice>, devices));
     return true;
 }
 
@@ -267,35 +304,6 @@ bool Owfs::getSwitchInput(const QByteArray &address, SwitchChannel channel, bool
 
 void Owfs::setSwitchOutput(const QByteArray &address, SwitchChannel channel, bool state)
 {
-    QByteArray c;
-    c.append("PIO.");
-    switch (channel) {
-    case PIO_A:
-        c.append('A');
-        break;
-    case PIO_B:
-        c.append('B');
-        break;
-    case PIO_C:
-        c.append('C');
-        break;
-    case PIO_D:
-        c.append('D');
-        break;
-    case PIO_E:
-        c.append('E');
-        break;
-    case PIO_F:
-        c.append('F');
-        break;
-    case PIO_G:
-        c.append('G');
-        break;
-    case PIO_H:
-        c.append('H');
-        break;
-    }
-    setValue(address, c, QVariant(state).toByteArray());
+    // Queued behind a running poll so writes never interleave with a bus sweep
+    QMetaObject::invokeMethod(m_worker, "writeSwitchOutput", Qt::QueuedConnection, Q_ARG(QByteArray, address), Q_ARG(int, static_cast<int>(channel)), Q_ARG(bool, state));
 }
-
-
@@ -34,6 +34,9 @@
 #include "owcapi.h"
 
 #include <QObject>
+#include <QThread>
+
+class OwfsWorker;
 
 class Owfs : public QObject
 {
@@ -66,10 +69,26 @@ public:
         QByteArray type;
     };
 
+    struct DeviceState {
+        QByteArray address;
+        bool connected = false;
+        bool temperatureValid = false;
+        double temperature = 0;
+        bool humidityValid = false;
+        double humidity = 0;
+        QList<bool> switchOutputs;
+    };
+
     explicit Owfs(QObject *parent = nullptr);
     ~Owfs();
     bool init(const QByteArray &owfsInitArguments);
 
+    static bool isTemperatureSensorFamily(int family);
+
+    // Reads all given devices in one bus sweep in the worker thread, the result is
+    // delivered through devicesPolled(). Returns false if the previous poll is still running.
+    bool poll(const QList<OwfsDevice> &devices);
+
     QByteArray getPath();
     bool discoverDevices();
     bool interfaceIsAvailable();
@@ -87,8 +106,16 @@ private:
     QByteArray getValue(const QByteArray &address, const QByteArray &deviceType);
     void setValue(const QByteArray &address, const QByteArray &deviceType, const QByteArray &value);
 
+    QThread *m_thread = nullptr;
+    OwfsWorker *m_worker = nullptr;
+    bool m_polling = false;
+
 signals:
     void devicesDiscovered(QList<OwfsDevice> devices);
+    void devicesPolled(const QList<Owfs::DeviceState> &states);
 };
 
+Q_DECLARE_METATYPE(Owfs::OwfsDevice)
+Q_DECLARE_METATYPE(Owfs::DeviceState)
+
 #endif // OWFS_H
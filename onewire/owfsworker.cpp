@@ -0,0 +1,194 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "owfsworker.h"
+#include "extern-plugininfo.h"
+
+#include <QElapsedTimer>
+
+#include <cerrno>
+#include <cstring>
+
+#include "owcapi.h"
+
+OwfsWorker::OwfsWorker(const QByteArray &path, QObject *parent) :
+    QObject(parent),
+    m_path(path)
+{
+
+}
+
+void OwfsWorker::poll(const QList<Owfs::OwfsDevice> &devices)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // A single uncached directory listing is one search over the bus and tells us about all devices at once
+    bool listed = false;
+    QSet<QByteArray> present = presentDevices(&listed);
+
+    // Start the conversion on all temperature sensors of the bus at once. owfs keeps track of
+    // the conversion time, "latesttemp" then returns the result without converting again.
+    bool simultaneous = false;
+    foreach (const Owfs::OwfsDevice &device, devices) {
+        if (Owfs::isTemperatureSensorFamily(device.family) && present.contains(device.address)) {
+            simultaneous = putValue(devicePath("simultaneous", "temperature", false), "1");
+            break;
+        }
+    }
+
+    QList<Owfs::DeviceState> states;
+    foreach (const Owfs::OwfsDevice &device, devices) {
+        Owfs::DeviceState state;
+        state.address = device.address;
+        state.connected = listed ? present.contains(device.address) : false;
+        if (!state.connected) {
+            states.append(state);
+            continue;
+        }
+
+        QByteArray value;
+        switch (device.family) {
+        case 0x10:
+        case 0x22:
+        case 0x28:
+        case 0x3b:
+            if (getValue(device.address, simultaneous ? "latesttemp" : "temperature", true, &value)) {
+                state.temperature = value.trimmed().replace(',', '.').toDouble(&state.temperatureValid);
+            }
+            break;
+        case 0x26:
+            // Temperature and humidity of the DS2438 change slowly, the owfs cache is good enough
+            if (getValue(device.address, "temperature", false, &value)) {
+                state.temperature = value.trimmed().replace(',', '.').toDouble(&state.temperatureValid);
+            }
+            if (getValue(device.address, "humidity", false, &value)) {
+                state.humidity = value.trimmed().replace(',', '.').toDouble(&state.humidityValid);
+            }
+            break;
+        case 0x05:
+            if (getValue(device.address, "PIO", false, &value)) {
+                state.switchOutputs.append(value.trimmed().toInt() != 0);
+            }
+            break;
+        case 0x12:
+        case 0x3a:
+        case 0x29:
+            // All channels in one access, "PIO.ALL" returns a comma separated list
+            if (getValue(device.address, "PIO.ALL", false, &value)) {
+                foreach (const QByteArray &channel, value.split(',')) {
+                    state.switchOutputs.append(channel.trimmed().toInt() != 0);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+        states.append(state);
+    }
+
+    qCDebug(dcOneWire()) << "Polled" << devices.count() << "OWFS devices in" << timer.elapsed() << "ms";
+    emit devicesPolled(states);
+    emit finished();
+}
+
+void OwfsWorker::writeSwitchOutput(const QByteArray &address, int channel, bool state)
+{
+    // The DS2405 (family 0x05) has a single "PIO", the multi channel switches have "PIO.A", "PIO.B", ...
+    int family = address.split('.').first().toInt(nullptr, 16);
+    QByteArray property = "PIO";
+    if (family != 0x05) {
+        property.append('.');
+        property.append(static_cast<char>('A' + channel));
+    }
+    putValue(devicePath(address, property, false), state ? "1" : "0");
+}
+
+QSet<QByteArray> OwfsWorker::presentDevices(bool *ok)
+{
+    QSet<QByteArray> devices;
+    char *buffer = nullptr;
+    size_t length = 0;
+    QByteArray path = m_path + "uncached";
+    if (OW_get(path.constData(), &buffer, &length) < 0) {
+        qCWarning(dcOneWire()) << "Could not list devices" << strerror(errno);
+        *ok = false;
+        return devices;
+    }
+
+    // "10.67C6697351FF/,05.4AEC29CDBAAB/,bus.0/,settings/,..."
+    foreach (QByteArray member, QByteArray(buffer, static_cast<int>(length)).split(',')) {
+        if (member.endsWith('/')) {
+            member.chop(1);
+        }
+        devices.insert(member);
+    }
+    free(buffer);
+    *ok = true;
+    return devices;
+}
+
+bool OwfsWorker::getValue(const QByteArray &address, const QByteArray &property, bool uncached, QByteArray *value)
+{
+    char *buffer = nullptr;
+    size_t length = 0;
+    QByteArray path = devicePath(address, property, uncached);
+    if (OW_get(path.constData(), &buffer, &length) < 0) {
+        qCWarning(dcOneWire()) << "ERROR reading" << path << strerror(errno);
+        return false;
+    }
+    *value = QByteArray(buffer, static_cast<int>(length));
+    free(buffer);
+    return true;
+}
+
+bool OwfsWorker::putValue(const QByteArray &path, const QByteArray &value)
+{
+    if (OW_put(path.constData(), value.constData(), static_cast<size_t>(value.length())) < 0) {
+        qCWarning(dcOneWire()) << "ERROR writing" << path << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+QByteArray OwfsWorker::devicePath(const QByteArray &address, const QByteArray &property, bool uncached) const
+{
+    QByteArray path = m_path;
+    if (!path.endsWith('/')) {
+        path.append('/');
+    }
+    if (uncached) {
+        path.append("uncached/");
+    }
+    path.append(address);
+    path.append('/');
+    path.append(property);
+    return path;
+}
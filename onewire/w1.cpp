@@ -29,12 +29,31 @@
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include "w1.h"
+#include "w1worker.h"
 #include "extern-plugininfo.h"
 
 W1::W1(QObject *parent) :
     QObject(parent)
 {
+    qRegisterMetaType<QList<W1::TemperatureReading> >();
 
+    // Temperature conversions take up to 750 ms per sensor, keep them away from the main thread
+    m_thread = new QThread(this);
+    m_worker = new W1Worker();
+    m_worker->moveToThread(m_thread);
+    connect(m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &W1Worker::temperaturesRead, this, &W1::temperaturesRead);
+    connect(m_worker, &W1Worker::finished, this, [this](){
+        m_busy = false;
+    });
+    m_thread->start();
+}
+
+W1::~W1()
+{
+    m_worker->abort();
+    m_thread->quit();
+    m_thread->wait();
 }
 
 QStringList W1::discoverDevices()
@@ -72,21 +91,13 @@ bool W1::deviceAvailable(const QString &address)
    return temperatureSensor.exists();
 }
 
-double W1::getTemperature(const QString &address)
+bool W1::readTemperatures(const QStringList &addresses)
 {
-    QDir temperatureSensor("/sys/bus/w1/devices/"+address);
-    if (temperatureSensor.exists()) {
-        QFile temperature(temperatureSensor.path() +"/temperature");
-        if (!temperature.exists()) {
-            qCWarning(dcOneWire()) << "Directory doesn't exist" << temperature.fileName();
-        }
-        if (!temperature.open(QIODevice::ReadOnly | QIODevice::Text)){
-            qCWarning(dcOneWire()) << "Could not open file" << temperature.fileName();
-            return 0;
-        }
-        return temperature.readLine().toInt()/1000.00;
-    } else {
-        qCWarning(dcOneWire()) << "Could not find device" << temperatureSensor.currentPath();
+    if (m_busy) {
+        qCDebug(dcOneWire()) << "Previous temperature read still in progress, skipping this cycle";
+        return false;
     }
-    return 0;
+    m_busy = true;
+    QMetaObject::invokeMethod(m_worker, "readTemperatures", Qt::QueuedConnection, Q_ARG(QStringList, addresses));
+    return true;
 }
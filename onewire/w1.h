@@ -34,20 +34,43 @@
 #include <QObject>
 #include <QDir>
 #include <QFile>
+#include <QThread>
+
+class W1Worker;
 
 class W1 : public QObject
 {
     Q_OBJECT
 public:
+    struct TemperatureReading {
+        QString address;
+        bool connected = false;
+        bool valid = false;
+        double temperature = 0;
+    };
 
     explicit W1(QObject *parent = nullptr);
+    ~W1() override;
 
     QStringList discoverDevices();
     bool interfaceIsAvailable();
     bool deviceAvailable(const QString &address);
-    double getTemperature(const QString &address);
+
+    // Reads the given sensors in the worker thread. Results are delivered bus by bus
+    // through temperaturesRead(). Returns false if the previous request is still running.
+    bool readTemperatures(const QStringList &addresses);
+
+signals:
+    void temperaturesRead(const QList<W1::TemperatureReading> &readings);
 
 private:
     QList<QDir> m_w1BusMasters;
+
+    QThread *m_thread = nullptr;
+    W1Worker *m_worker = nullptr;
+    bool m_busy = false;
 };
+
+Q_DECLARE_METATYPE(W1::TemperatureReading)
+
 #endif // W1_H
@@ -0,0 +1,149 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "w1worker.h"
+#include "extern-plugininfo.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QThread>
+#include <QElapsedTimer>
+
+// A 12 bit conversion takes 750 ms, allow some headroom before giving up on a bulk conversion
+static const int bulkConversionTimeout = 1500;
+
+W1Worker::W1Worker(QObject *parent) :
+    QObject(parent)
+{
+
+}
+
+void W1Worker::abort()
+{
+    m_abort.storeRelease(1);
+}
+
+void W1Worker::readTemperatures(const QStringList &addresses)
+{
+    // Group the sensors by their bus master, each bus converts all of its sensors at once
+    QList<W1::TemperatureReading> missing;
+    QMap<QString, QStringList> buses;
+    foreach (const QString &address, addresses) {
+        QFileInfo deviceInfo("/sys/bus/w1/devices/" + address);
+        if (!deviceInfo.exists()) {
+            W1::TemperatureReading reading;
+            reading.address = address;
+            missing.append(reading);
+            continue;
+        }
+        buses[QFileInfo(deviceInfo.canonicalFilePath()).path()].append(address);
+    }
+    if (!missing.isEmpty()) {
+        emit temperaturesRead(missing);
+    }
+
+    foreach (const QString &busMaster, buses.keys()) {
+        if (m_abort.loadAcquire()) {
+            break;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        bool bulk = triggerBulkConversion(busMaster);
+
+        QList<W1::TemperatureReading> readings;
+        foreach (const QString &address, buses.value(busMaster)) {
+            if (m_abort.loadAcquire()) {
+                break;
+            }
+            readings.append(readTemperature(address));
+        }
+        qCDebug(dcOneWire()) << "Read" << readings.count() << "sensors on" << busMaster << (bulk ? "with" : "without") << "bulk conversion in" << timer.elapsed() << "ms";
+        emit temperaturesRead(readings);
+    }
+    emit finished();
+}
+
+bool W1Worker::triggerBulkConversion(const QString &busMaster)
+{
+    // Available since Linux 5.10. Triggers a simultaneous conversion on all sensors of the bus,
+    // the following reads of the temperature files return the converted values right away.
+    QFile bulkRead(busMaster + "/therm_bulk_read");
+    if (!bulkRead.exists() || !bulkRead.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    bool triggered = bulkRead.write("trigger\n") > 0;
+    bulkRead.close();
+    if (!triggered) {
+        qCWarning(dcOneWire()) << "Could not trigger bulk conversion on" << busMaster;
+        return false;
+    }
+
+    // Reading returns -1 while a conversion is still in progress
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < bulkConversionTimeout && !m_abort.loadAcquire()) {
+        if (!bulkRead.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            return false;
+        }
+        int state = bulkRead.readLine().trimmed().toInt();
+        bulkRead.close();
+        if (state != -1) {
+            return true;
+        }
+        QThread::msleep(50);
+    }
+    qCWarning(dcOneWire()) << "Bulk conversion on" << busMaster << "did not finish in time";
+    return false;
+}
+
+W1::TemperatureReading W1Worker::readTemperature(const QString &address)
+{
+    W1::TemperatureReading reading;
+    reading.address = address;
+
+    QFile temperature("/sys/bus/w1/devices/" + address + "/temperature");
+    if (!temperature.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(dcOneWire()) << "Could not open file" << temperature.fileName();
+        return reading;
+    }
+    reading.connected = true;
+
+    // The read fails with an I/O error when the CRC check of the scratchpad failed
+    QByteArray data = temperature.readLine().trimmed();
+    if (data.isEmpty()) {
+        qCWarning(dcOneWire()) << "Could not read temperature of" << address;
+        return reading;
+    }
+    reading.temperature = data.toInt(&reading.valid) / 1000.00;
+    return reading;
+}
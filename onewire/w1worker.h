@@ -28,36 +28,35 @@
 *
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
-#ifndef ADS1115_H
-#define ADS1115_H
+#ifndef W1WORKER_H
+#define W1WORKER_H
 
-#include <QThread>
-#include <QMutex>
+#include <QObject>
+#include <QAtomicInt>
 
-#include <hardware/i2c/i2cdevice.h>
+#include "w1.h"
 
-class ADS1115Channel: public I2CDevice
+// Performs the blocking sysfs reads of the w1 kernel driver. Lives in the W1 worker thread.
+class W1Worker : public QObject
 {
     Q_OBJECT
 public:
+    explicit W1Worker(QObject *parent = nullptr);
 
-    enum Gain {
-        Gain_6_144 = 0,
-        Gain_4_096 = 1,
-        Gain_2_048 = 2,
-        Gain_1_024 = 3,
-        Gain_0_512 = 4,
-        Gain_0_256 = 5
-    };
+    void abort();
 
-    explicit ADS1115Channel(const QString &portName, int address, int channel, Gain gain, QObject *parent = nullptr);
+public slots:
+    void readTemperatures(const QStringList &addresses);
 
-    QByteArray readData(int fd) override;
+signals:
+    void temperaturesRead(const QList<W1::TemperatureReading> &readings);
+    void finished();
 
 private:
-    int m_channel = 0;
-    Gain m_gain = Gain_4_096;
+    bool triggerBulkConversion(const QString &busMaster);
+    W1::TemperatureReading readTemperature(const QString &address);
 
+    QAtomicInt m_abort;
 };
 
-#endif // ADS1115_H
+#endif // W1WORKER_H
@@ -30,6 +30,7 @@
 
 #include "huebridge.h"
 #include <QJsonDocument>
+#include <QVersionNumber>
 
 HueBridge::HueBridge(QObject *parent) :
     QObject(parent),
@@ -98,6 +99,11 @@ void HueBridge::setApiVersion(const QString &apiVersion)
     m_apiVersion = apiVersion;
 }
 
+bool HueBridge::supportsEventStream() const
+{
+    return QVersionNumber::fromString(m_apiVersion) >= QVersionNumber(1, 48);
+}
+
 QString HueBridge::softwareVersion() const
 {
     return m_softwareVersion;
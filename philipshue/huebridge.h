@@ -59,6 +59,9 @@ public:
     QString apiVersion() const;
     void setApiVersion(const QString &apiVersion);
 
+    // The CLIP v2 API including the event stream is available since API version 1.48
+    bool supportsEventStream() const;
+
     QString softwareVersion() const;
     void setSoftwareVersion(const QString &softwareVersion);
 
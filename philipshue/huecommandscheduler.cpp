@@ -0,0 +1,327 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "huecommandscheduler.h"
+#include "extern-plugininfo.h"
+
+#include <QJsonDocument>
+#include <QtMath>
+
+// The bridge handles about 10 light commands per second and one group command per second
+static const double bucketCapacity = 10;
+static const double tokensPerSecond = 10;
+static const double groupCommandCost = 10;
+
+// Time to wait for more commands before sending, e.g. while a rule switches several lights
+static const int coalesceDelay = 50;
+
+static const qint64 groupsMaxAge = 5 * 60 * 1000;
+
+// Attributes sharing the bridge's color mode. Setting one overrides any pending other one,
+// otherwise the bridge would pick the mode by its own priority (xy > ct > hs).
+static const QStringList colorAttributes = {"hue", "sat", "xy", "ct"};
+
+HueCommandReply::HueCommandReply(int lightId, QObject *parent) :
+    QObject(parent),
+    m_lightId(lightId)
+{
+
+}
+
+int HueCommandReply::lightId() const
+{
+    return m_lightId;
+}
+
+bool HueCommandReply::failed() const
+{
+    return m_failed;
+}
+
+QByteArray HueCommandReply::responseData() const
+{
+    return m_responseData;
+}
+
+HueCommandScheduler::HueCommandScheduler(NetworkAccessManager *networkManager, HueBridge *bridge, QObject *parent) :
+    QObject(parent),
+    m_networkManager(networkManager),
+    m_bridge(bridge),
+    m_tokens(bucketCapacity)
+{
+    m_tokenClock.start();
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &HueCommandScheduler::flush);
+}
+
+HueCommandReply *HueCommandScheduler::setLightState(int lightId, const QVariantMap &state)
+{
+    HueCommandReply *reply = new HueCommandReply(lightId, this);
+    reply->m_attributes = state.keys();
+    m_commandsQueued++;
+
+    if (m_pending.contains(lightId)) {
+        PendingCommand &command = m_pending[lightId];
+        bool setsColor = false;
+        foreach (const QString &key, state.keys()) {
+            if (colorAttributes.contains(key)) {
+                setsColor = true;
+                break;
+            }
+        }
+        foreach (const QString &key, command.state.keys()) {
+            if (state.contains(key) || (setsColor && colorAttributes.contains(key))) {
+                command.state.remove(key);
+                m_valuesDropped++;
+            }
+        }
+        foreach (const QString &key, state.keys()) {
+            command.state.insert(key, state.value(key));
+        }
+        command.replies.append(reply);
+        m_commandsMerged++;
+    } else {
+        PendingCommand command;
+        command.state = state;
+        command.replies.append(reply);
+        m_pending.insert(lightId, command);
+        m_queue.append(lightId);
+    }
+
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start(coalesceDelay);
+    }
+    return reply;
+}
+
+void HueCommandScheduler::refreshGroups()
+{
+    if (m_groupsReply || (m_groupsAge.isValid() && m_groupsAge.elapsed() < groupsMaxAge))
+        return;
+
+    QNetworkRequest request(QUrl("http://" + m_bridge->hostAddress().toString() + "/api/" + m_bridge->apiKey() + "/groups"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    m_groupsReply = m_networkManager->get(request);
+    connect(m_groupsReply, &QNetworkReply::finished, this, [this](){
+        QNetworkReply *reply = m_groupsReply;
+        m_groupsReply = nullptr;
+        reply->deleteLater();
+
+        if (reply->error() != QNetworkReply::NoError) {
+            qCWarning(dcPhilipsHue()) << "Failed to fetch groups from bridge" << m_bridge->name() << reply->errorString();
+            return;
+        }
+
+        QJsonParseError error;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(reply->readAll(), &error);
+        if (error.error != QJsonParseError::NoError || !jsonDoc.isObject()) {
+            qCWarning(dcPhilipsHue()) << "Invalid groups response from bridge" << m_bridge->name() << error.errorString();
+            return;
+        }
+
+        m_groups.clear();
+        QVariantMap groupsMap = jsonDoc.toVariant().toMap();
+        foreach (const QString &groupId, groupsMap.keys()) {
+            QList<int> lightIds;
+            foreach (const QVariant &lightId, groupsMap.value(groupId).toMap().value("lights").toList()) {
+                lightIds.append(lightId.toInt());
+            }
+            // A group of one light saves nothing
+            if (lightIds.count() > 1) {
+                m_groups.insert(groupId.toInt(), lightIds);
+            }
+        }
+        m_groupsAge.start();
+        qCDebug(dcPhilipsHue()) << "Loaded" << m_groups.count() << "groups from bridge" << m_bridge->name();
+    });
+}
+
+int HueCommandScheduler::queueDepth() const
+{
+    return m_queue.count();
+}
+
+quint64 HueCommandScheduler::commandsQueued() const
+{
+    return m_commandsQueued;
+}
+
+quint64 HueCommandScheduler::commandsMerged() const
+{
+    return m_commandsMerged;
+}
+
+quint64 HueCommandScheduler::valuesDropped() const
+{
+    return m_valuesDropped;
+}
+
+quint64 HueCommandScheduler::requestsSent() const
+{
+    return m_requestsSent;
+}
+
+quint64 HueCommandScheduler::groupRequestsSent() const
+{
+    return m_groupRequestsSent;
+}
+
+void HueCommandScheduler::flush()
+{
+    m_tokens = qMin(bucketCapacity, m_tokens + m_tokenClock.restart() * tokensPerSecond / 1000);
+
+    while (!m_queue.isEmpty()) {
+        const QVariantMap state = m_pending.value(m_queue.first()).state;
+
+        QList<int> sameState;
+        foreach (int lightId, m_queue) {
+            if (m_pending.value(lightId).state == state) {
+                sameState.append(lightId);
+            }
+        }
+
+        int groupId = findGroup(sameState);
+        double cost = groupId < 0 ? 1 : groupCommandCost;
+        if (m_tokens < cost) {
+            m_flushTimer.start(qCeil((cost - m_tokens) * 1000 / tokensPerSecond));
+            qCDebug(dcPhilipsHue()) << "Bridge" << m_bridge->name() << "command budget exhausted. Queue depth:" << m_queue.count();
+            return;
+        }
+        m_tokens -= cost;
+
+        if (groupId < 0) {
+            send(-1, {m_queue.first()});
+        } else {
+            send(groupId, m_groups.value(groupId));
+        }
+    }
+
+    qCDebug(dcPhilipsHue()) << "Bridge" << m_bridge->name() << "command queue drained. Commands:" << m_commandsQueued
+                            << "merged:" << m_commandsMerged << "dropped values:" << m_valuesDropped
+                            << "requests:" << m_requestsSent << "group requests:" << m_groupRequestsSent;
+}
+
+int HueCommandScheduler::findGroup(const QList<int> &lightIds) const
+{
+    // The largest group made up entirely of the given lights. Groups containing any other
+    // light can't be used as that one would change too.
+    int bestGroup = -1;
+    int bestSize = 1;
+    foreach (int groupId, m_groups.keys()) {
+        const QList<int> &groupLights = m_groups[groupId];
+        if (groupLights.count() <= bestSize || groupLights.count() > lightIds.count())
+            continue;
+
+        bool matches = true;
+        foreach (int lightId, groupLights) {
+            if (!lightIds.contains(lightId)) {
+                matches = false;
+                break;
+            }
+        }
+        if (matches) {
+            bestGroup = groupId;
+            bestSize = groupLights.count();
+        }
+    }
+    return bestGroup;
+}
+
+void HueCommandScheduler::send(int groupId, const QList<int> &lightIds)
+{
+    QVariantMap state = m_pending.value(lightIds.first()).state;
+    QList<HueCommandReply *> replies;
+    foreach (int lightId, lightIds) {
+        replies.append(m_pending.take(lightId).replies);
+        m_queue.removeAll(lightId);
+    }
+
+    QString path;
+    if (groupId < 0) {
+        path = "/lights/" + QString::number(lightIds.first()) + "/state";
+    } else {
+        path = "/groups/" + QString::number(groupId) + "/action";
+        m_groupRequestsSent++;
+        qCDebug(dcPhilipsHue()) << "Sending command for lights" << lightIds << "as group" << groupId;
+    }
+    m_requestsSent++;
+
+    QNetworkRequest request(QUrl("http://" + m_bridge->hostAddress().toString() + "/api/" + m_bridge->apiKey() + path));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QNetworkReply *reply = m_networkManager->put(request, QJsonDocument::fromVariant(state).toJson(QJsonDocument::Compact));
+    connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+    QStringList sentAttributes = state.keys();
+    connect(reply, &QNetworkReply::finished, this, [this, reply, replies, groupId, sentAttributes](){
+        bool failed = reply->error() != QNetworkReply::NoError;
+        if (failed) {
+            qCWarning(dcPhilipsHue()) << "Failed to send command to bridge" << m_bridge->name() << reply->errorString();
+        }
+        QByteArray data = reply->readAll();
+        foreach (HueCommandReply *commandReply, replies) {
+            commandReply->m_failed = failed;
+            // Report group results the way the bridge reports them for single lights
+            QByteArray lightData = groupId < 0 ? data : groupResponseToLightResponse(data, groupId, commandReply->lightId());
+            // Merged commands share one response, each reply only gets the results of its own attributes
+            commandReply->m_responseData = filterResponse(lightData, sentAttributes, commandReply->m_attributes);
+            emit commandReply->finished();
+            commandReply->deleteLater();
+        }
+    });
+}
+
+QByteArray HueCommandScheduler::groupResponseToLightResponse(const QByteArray &data, int groupId, int lightId)
+{
+    QByteArray lightData = data;
+    return lightData.replace("/groups/" + QByteArray::number(groupId) + "/action/", "/lights/" + QByteArray::number(lightId) + "/state/");
+}
+
+QByteArray HueCommandScheduler::filterResponse(const QByteArray &data, const QStringList &sentAttributes, const QStringList &attributes)
+{
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(data);
+    if (!jsonDoc.isArray())
+        return data;
+
+    QVariantList filtered;
+    foreach (const QVariant &resultVariant, jsonDoc.toVariant().toList()) {
+        QVariantMap result = resultVariant.toMap();
+        QString address;
+        if (result.contains("success")) {
+            address = result.value("success").toMap().keys().value(0);
+        } else if (result.contains("error")) {
+            address = result.value("error").toMap().value("address").toString();
+        }
+        // Results not belonging to a single attribute (e.g. unauthorized user) concern every reply
+        QString attribute = address.section('/', -1);
+        if (!sentAttributes.contains(attribute) || attributes.contains(attribute)) {
+            filtered.append(result);
+        }
+    }
+    return QJsonDocument::fromVariant(filtered).toJson(QJsonDocument::Compact);
+}
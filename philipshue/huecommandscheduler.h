@@ -0,0 +1,120 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HUECOMMANDSCHEDULER_H
+#define HUECOMMANDSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QNetworkReply>
+
+#include "network/networkaccessmanager.h"
+#include "huebridge.h"
+
+class HueCommandReply : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HueCommandReply(int lightId, QObject *parent = nullptr);
+
+    int lightId() const;
+
+    // Network or bridge level failure. Errors of single attributes are part of the response,
+    // which only contains the results for the attributes set through this reply.
+    bool failed() const;
+    QByteArray responseData() const;
+
+signals:
+    void finished();
+
+private:
+    friend class HueCommandScheduler;
+    int m_lightId;
+    QStringList m_attributes;
+    bool m_failed = false;
+    QByteArray m_responseData;
+};
+
+// Queues light state changes for one bridge. Changes to the same light are merged until the
+// command is sent, the same change for all lights of a Hue group is sent as one group action
+// and everything is paced by a token bucket matching the bridge's command budget.
+class HueCommandScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HueCommandScheduler(NetworkAccessManager *networkManager, HueBridge *bridge, QObject *parent = nullptr);
+
+    HueCommandReply *setLightState(int lightId, const QVariantMap &state);
+
+    // Fetches the group configuration from the bridge if it is outdated
+    void refreshGroups();
+
+    int queueDepth() const;
+    quint64 commandsQueued() const;
+    quint64 commandsMerged() const;
+    quint64 valuesDropped() const;
+    quint64 requestsSent() const;
+    quint64 groupRequestsSent() const;
+
+private:
+    struct PendingCommand {
+        QVariantMap state;
+        QList<HueCommandReply *> replies;
+    };
+
+    NetworkAccessManager *m_networkManager = nullptr;
+    HueBridge *m_bridge = nullptr;
+
+    QHash<int, PendingCommand> m_pending;
+    QList<int> m_queue;
+    QHash<int, QList<int>> m_groups;
+    QElapsedTimer m_groupsAge;
+    QNetworkReply *m_groupsReply = nullptr;
+
+    QTimer m_flushTimer;
+    QElapsedTimer m_tokenClock;
+    double m_tokens;
+
+    quint64 m_commandsQueued = 0;
+    quint64 m_commandsMerged = 0;
+    quint64 m_valuesDropped = 0;
+    quint64 m_requestsSent = 0;
+    quint64 m_groupRequestsSent = 0;
+
+    void flush();
+    int findGroup(const QList<int> &lightIds) const;
+    void send(int groupId, const QList<int> &lightIds);
+    static QByteArray groupResponseToLightResponse(const QByteArray &data, int groupId, int lightId);
+    static QByteArray filterResponse(const QByteArray &data, const QStringList &sentAttributes, const QStringList &attributes);
+};
+
+#endif // HUECOMMANDSCHEDULER_H
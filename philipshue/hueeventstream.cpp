@@ -0,0 +1,358 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "hueeventstream.h"
+#include "extern-plugininfo.h"
+
+#include <QJsonDocument>
+#include <QSslConfiguration>
+#include <QSslSocket>
+
+HueEventStream::HueEventStream(NetworkAccessManager *networkManager, HueBridge *bridge, QObject *parent) :
+    QObject(parent),
+    m_networkManager(networkManager),
+    m_bridge(bridge)
+{
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &HueEventStream::openStream);
+}
+
+HueEventStream::~HueEventStream()
+{
+    m_running = false;
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+    }
+    if (m_buttonsReply) {
+        m_buttonsReply->disconnect(this);
+        m_buttonsReply->abort();
+        m_buttonsReply->deleteLater();
+    }
+}
+
+bool HueEventStream::connected() const
+{
+    return m_connected;
+}
+
+void HueEventStream::start()
+{
+    if (m_running)
+        return;
+
+    m_running = true;
+    m_failures = 0;
+    openStream();
+}
+
+void HueEventStream::stop()
+{
+    m_running = false;
+    m_reconnectTimer.stop();
+
+    if (m_reply) {
+        QNetworkReply *reply = m_reply;
+        m_reply = nullptr;
+        reply->abort();
+    }
+    if (m_buttonsReply) {
+        m_buttonsReply->abort();
+    }
+    setConnected(false);
+}
+
+void HueEventStream::onReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply != m_reply)
+        return;
+
+    // Error responses are handled once the reply finishes
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+        return;
+
+    if (!m_connected) {
+        qCDebug(dcPhilipsHue()) << "Event stream connected to" << m_bridge->name();
+        m_failures = 0;
+        setConnected(true);
+        fetchButtons();
+    }
+
+    m_buffer.append(reply->readAll());
+    parseBuffer();
+}
+
+void HueEventStream::onFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    reply->deleteLater();
+    if (reply != m_reply)
+        return;
+
+    m_reply = nullptr;
+    if (!m_running)
+        return;
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    qCDebug(dcPhilipsHue()) << "Event stream of" << m_bridge->name() << "closed. HTTP status:" << status << reply->errorString();
+    setConnected(false);
+    scheduleReconnect();
+}
+
+QNetworkRequest HueEventStream::createRequest(const QString &path) const
+{
+    QNetworkRequest request(QUrl("https://" + m_bridge->hostAddress().toString() + path));
+    request.setRawHeader("hue-application-key", m_bridge->apiKey().toUtf8());
+
+    // The bridge uses a certificate signed by the Signify root CA which is not in the system store
+    QSslConfiguration sslConfiguration = request.sslConfiguration();
+    sslConfiguration.setPeerVerifyMode(QSslSocket::VerifyNone);
+    request.setSslConfiguration(sslConfiguration);
+    return request;
+}
+
+void HueEventStream::openStream()
+{
+    if (!m_running || m_reply)
+        return;
+
+    m_buffer.clear();
+    m_scanPosition = 0;
+    m_eventData.clear();
+
+    QNetworkRequest request = createRequest("/eventstream/clip/v2");
+    request.setRawHeader("Accept", "text/event-stream");
+    if (!m_lastEventId.isEmpty()) {
+        request.setRawHeader("Last-Event-ID", m_lastEventId);
+    }
+
+    m_reply = m_networkManager->get(request);
+    connect(m_reply, &QNetworkReply::readyRead, this, &HueEventStream::onReadyRead);
+    connect(m_reply, &QNetworkReply::finished, this, &HueEventStream::onFinished);
+}
+
+void HueEventStream::setConnected(bool connected)
+{
+    if (m_connected == connected)
+        return;
+
+    m_connected = connected;
+    emit connectedChanged(m_connected);
+}
+
+void HueEventStream::scheduleReconnect()
+{
+    int interval = qMin(m_retryInterval << qMin(m_failures, 4), 60000);
+    m_failures++;
+    qCDebug(dcPhilipsHue()) << "Reconnecting event stream in" << interval / 1000 << "seconds";
+    m_reconnectTimer.start(interval);
+}
+
+void HueEventStream::parseBuffer()
+{
+    // Lines may be terminated by "\r\n", "\n" or "\r". Only complete lines are consumed,
+    // m_scanPosition remembers how far the remainder has been searched already.
+    int lineStart = 0;
+    int position = m_scanPosition;
+    while (position < m_buffer.size()) {
+        char c = m_buffer.at(position);
+        if (c != '\n' && c != '\r') {
+            position++;
+            continue;
+        }
+        // Don't know yet whether a trailing '\r' is followed by a '\n'
+        if (c == '\r' && position + 1 == m_buffer.size())
+            break;
+
+        processLine(m_buffer.mid(lineStart, position - lineStart));
+        if (c == '\r' && m_buffer.at(position + 1) == '\n')
+            position++;
+
+        position++;
+        lineStart = position;
+    }
+
+    m_buffer.remove(0, lineStart);
+    m_scanPosition = position - lineStart;
+}
+
+void HueEventStream::processLine(const QByteArray &line)
+{
+    if (line.isEmpty()) {
+        dispatchEvent();
+        return;
+    }
+
+    // Comment, the bridge sends ": hi" right after connecting
+    if (line.startsWith(':'))
+        return;
+
+    int colon = line.indexOf(':');
+    QByteArray field = colon < 0 ? line : line.left(colon);
+    QByteArray value = colon < 0 ? QByteArray() : line.mid(colon + 1);
+    if (value.startsWith(' '))
+        value.remove(0, 1);
+
+    if (field == "data") {
+        if (!m_eventData.isEmpty())
+            m_eventData.append('\n');
+
+        m_eventData.append(value);
+    } else if (field == "id") {
+        m_lastEventId = value;
+    } else if (field == "retry") {
+        bool ok = false;
+        int retryInterval = value.toInt(&ok);
+        if (ok && retryInterval > 0) {
+            m_retryInterval = retryInterval;
+        }
+    }
+}
+
+void HueEventStream::dispatchEvent()
+{
+    if (m_eventData.isEmpty())
+        return;
+
+    QJsonParseError error;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(m_eventData, &error);
+    m_eventData.clear();
+    if (error.error != QJsonParseError::NoError) {
+        qCWarning(dcPhilipsHue()) << "Event stream json error" << error.errorString();
+        return;
+    }
+
+    foreach (const QVariant &containerVariant, jsonDoc.toVariant().toList()) {
+        QVariantMap container = containerVariant.toMap();
+        if (container.value("type").toString() != "update")
+            continue;
+
+        foreach (const QVariant &resource, container.value("data").toList()) {
+            processResource(resource.toMap());
+        }
+    }
+}
+
+void HueEventStream::processResource(const QVariantMap &resource)
+{
+    int sensorId = sensorIdFromV1Id(resource.value("id_v1").toString());
+    if (sensorId < 0)
+        return;
+
+    // Newer bridge firmware moves the values into a "*_report" object, older ones report them directly
+    auto reported = [&resource](const QString &object, const QString &report, const QString &key) {
+        QVariantMap objectMap = resource.value(object).toMap();
+        if (objectMap.contains(report))
+            return objectMap.value(report).toMap().value(key);
+
+        return objectMap.value(key);
+    };
+
+    QString type = resource.value("type").toString();
+    if (type == "motion") {
+        QVariant motion = reported("motion", "motion_report", "motion");
+        if (motion.isValid() && resource.value("motion").toMap().value("motion_valid", true).toBool()) {
+            emit motionChanged(sensorId, motion.toBool());
+        }
+    } else if (type == "temperature") {
+        QVariant temperature = reported("temperature", "temperature_report", "temperature");
+        if (temperature.isValid()) {
+            emit temperatureChanged(sensorId, temperature.toDouble());
+        }
+    } else if (type == "light_level") {
+        QVariant lightLevel = reported("light", "light_level_report", "light_level");
+        if (lightLevel.isValid()) {
+            emit lightLevelChanged(sensorId, lightLevel.toInt());
+        }
+    } else if (type == "button") {
+        QVariant event = reported("button", "button_report", "event");
+        if (!event.isValid()) {
+            event = resource.value("button").toMap().value("last_event");
+        }
+        QString buttonId = resource.value("id").toString();
+        if (!m_buttonControlIds.contains(buttonId)) {
+            qCDebug(dcPhilipsHue()) << "Button event for unknown button resource" << buttonId << "Refreshing button list.";
+            fetchButtons();
+            return;
+        }
+        emit buttonEvent(sensorId, m_buttonControlIds.value(buttonId), event.toString());
+    } else if (type == "device_power") {
+        QVariantMap powerState = resource.value("power_state").toMap();
+        if (powerState.contains("battery_level")) {
+            emit batteryLevelChanged(sensorId, powerState.value("battery_level").toInt());
+        }
+    } else if (type == "zigbee_connectivity") {
+        emit reachableChanged(sensorId, resource.value("status").toString() == "connected");
+    }
+}
+
+void HueEventStream::fetchButtons()
+{
+    if (m_buttonsReply)
+        return;
+
+    m_buttonsReply = m_networkManager->get(createRequest("/clip/v2/resource/button"));
+    connect(m_buttonsReply, &QNetworkReply::finished, this, [this](){
+        QNetworkReply *reply = m_buttonsReply;
+        m_buttonsReply = nullptr;
+        reply->deleteLater();
+
+        if (reply->error() != QNetworkReply::NoError) {
+            qCWarning(dcPhilipsHue()) << "Failed to fetch button resources from" << m_bridge->name() << reply->errorString();
+            return;
+        }
+
+        QJsonParseError error;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(reply->readAll(), &error);
+        if (error.error != QJsonParseError::NoError) {
+            qCWarning(dcPhilipsHue()) << "Button resources json error" << error.errorString();
+            return;
+        }
+
+        m_buttonControlIds.clear();
+        foreach (const QVariant &buttonVariant, jsonDoc.toVariant().toMap().value("data").toList()) {
+            QVariantMap buttonMap = buttonVariant.toMap();
+            m_buttonControlIds.insert(buttonMap.value("id").toString(), buttonMap.value("metadata").toMap().value("control_id").toInt());
+        }
+        qCDebug(dcPhilipsHue()) << "Loaded" << m_buttonControlIds.count() << "button resources from" << m_bridge->name();
+    });
+}
+
+int HueEventStream::sensorIdFromV1Id(const QString &idV1)
+{
+    if (!idV1.startsWith("/sensors/"))
+        return -1;
+
+    bool ok = false;
+    int sensorId = idV1.mid(9).toInt(&ok);
+    return ok ? sensorId : -1;
+}
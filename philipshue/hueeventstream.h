@@ -0,0 +1,105 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HUEEVENTSTREAM_H
+#define HUEEVENTSTREAM_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QNetworkReply>
+
+#include "network/networkaccessmanager.h"
+#include "huebridge.h"
+
+// Connects to the CLIP v2 server-sent event stream of a Hue bridge and translates
+// the update events into signals addressed by the v1 sensor id, which is what all
+// the existing device classes of this plugin are keyed by.
+class HueEventStream : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HueEventStream(NetworkAccessManager *networkManager, HueBridge *bridge, QObject *parent = nullptr);
+    ~HueEventStream();
+
+    bool connected() const;
+
+    void start();
+    void stop();
+
+signals:
+    void connectedChanged(bool connected);
+
+    void motionChanged(int sensorId, bool motion);
+    void temperatureChanged(int sensorId, double temperature);
+    void lightLevelChanged(int sensorId, int lightLevel);
+    void batteryLevelChanged(int sensorId, int batteryLevel);
+    void reachableChanged(int sensorId, bool reachable);
+    void buttonEvent(int sensorId, int controlId, const QString &event);
+
+private slots:
+    void onReadyRead();
+    void onFinished();
+
+private:
+    NetworkAccessManager *m_networkManager = nullptr;
+    HueBridge *m_bridge = nullptr;
+    QNetworkReply *m_reply = nullptr;
+    QNetworkReply *m_buttonsReply = nullptr;
+    QTimer m_reconnectTimer;
+    bool m_running = false;
+    bool m_connected = false;
+    int m_failures = 0;
+    int m_retryInterval = 5000;
+
+    // SSE parser state
+    QByteArray m_buffer;
+    int m_scanPosition = 0;
+    QByteArray m_eventData;
+    QByteArray m_lastEventId;
+
+    // v2 button resource id -> control id (button number on the device)
+    QHash<QString, int> m_buttonControlIds;
+
+    QNetworkRequest createRequest(const QString &path) const;
+    void openStream();
+    void setConnected(bool connected);
+    void scheduleReconnect();
+
+    void parseBuffer();
+    void processLine(const QByteArray &line);
+    void dispatchEvent();
+    void processResource(const QVariantMap &resource);
+
+    void fetchButtons();
+    static int sensorIdFromV1Id(const QString &idV1);
+};
+
+#endif // HUEEVENTSTREAM_H
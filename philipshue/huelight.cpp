@@ -133,6 +133,9 @@ void HueLight::setColorMode(const HueLight::ColorMode &colorMode)
 
 void HueLight::updateStates(const QVariantMap &statesMap)
 {
+    // States set from anywhere else than the bulk refresh make the cached raw state stale
+    m_lastState = QJsonObject();
+
     // color mode
     if (statesMap.value("colormode").toString() == "hs") {
         setColorMode(ColorModeHS);
@@ -172,8 +175,26 @@ void HueLight::updateStates(const QVariantMap &statesMap)
     emit stateChanged();
 }
 
+bool HueLight::updateStatesIfChanged(const QJsonObject &stateObject)
+{
+    if (stateObject == m_lastState)
+        return false;
+
+    updateStates(stateObject.toVariantMap());
+    m_lastState = stateObject;
+    return true;
+}
+
+void HueLight::invalidateStates()
+{
+    m_lastState = QJsonObject();
+}
+
 void HueLight::processActionResponse(const QVariantList &responseList)
 {
+    // The states now reflect the action, a refresh returning the previous raw state must be applied again
+    invalidateStates();
+
     foreach (const QVariant &resultVariant, responseList) {
         QVariantMap result = resultVariant.toMap();
         if (result.contains("success")) {
@@ -38,6 +38,7 @@
 #include <QHostAddress>
 #include <QNetworkRequest>
 #include <QJsonDocument>
+#include <QJsonObject>
 
 #include "typeutils.h"
 #include "huedevice.h"
@@ -86,6 +87,10 @@ public:
 
     // update states
     void updateStates(const QVariantMap &statesMap);
+    // Returns false without touching any state if the raw state equals the last one processed.
+    // updateStates() and processActionResponse() reset the last processed state.
+    bool updateStatesIfChanged(const QJsonObject &stateObject);
+    void invalidateStates();
     void processActionResponse(const QVariantList &responseList);
 
     // create action requests
@@ -108,6 +113,8 @@ private:
     QString m_effect;
     ColorMode m_colorMode;
 
+    QJsonObject m_lastState;
+
 signals:
     void stateChanged();
 
@@ -147,22 +147,13 @@ void HueMotionSensor::updateStates(const QVariantMap &sensorMap)
     }
 
     if (configMap.contains("battery")) {
-        int batteryLevel = configMap.value("battery", 0).toInt();
-        if (m_batteryLevel != batteryLevel) {
-            m_batteryLevel = batteryLevel;
-            emit batteryLevelChanged(m_batteryLevel);
-        }
+        setBatteryLevel(configMap.value("battery", 0).toInt());
     }
 
     // If temperature sensor
     QVariantMap stateMap = sensorMap.value("state").toMap();
     if (sensorMap.value("uniqueid").toString() == m_temperatureSensorUuid) {
-        double temperature = stateMap.value("temperature", 0).toInt() / 100.0;
-        if (m_temperature != temperature) {
-            m_temperature = temperature;
-            emit temperatureChanged(m_temperature);
-            qCDebug(dcPhilipsHue) << "Motion sensor temperature changed" << m_temperature;
-        }
+        setTemperature(stateMap.value("temperature", 0).toInt() / 100.0);
     }
 
     // If presence sensor
@@ -181,16 +172,56 @@ void HueMotionSensor::updateStates(const QVariantMap &sensorMap)
 
     // If light sensor
     if (sensorMap.value("uniqueid").toString() == m_lightSensorUuid) {
-        // Hue Light level is "10000 * log10(lux) + 1"
-        // => lux = 10^((lightLevel - 1) / 10000)
-        double lightIntensity = qPow(10, (stateMap.value("lightlevel", 0).toDouble()-1)/10000.0);
-        // Round to 2 digits
-        lightIntensity = qRound(lightIntensity * 100) / 100.0;
-        if (!qFuzzyCompare(m_lightIntensity, lightIntensity)) {
-            m_lightIntensity = lightIntensity;
-            qCDebug(dcPhilipsHue) << "Motion sensor light intensity changed" << m_lightIntensity;
-            emit lightIntensityChanged(m_lightIntensity);
+        setLightLevel(stateMap.value("lightlevel", 0).toInt());
+    }
+}
+
+void HueMotionSensor::setMotion(bool motion)
+{
+    // Unlike the polled presence flag, the event stream reports the end of a motion explicitly
+    // (about 10 seconds after the last movement). Keep presence up while motion is reported and
+    // start the timeout once it ends.
+    if (motion) {
+        m_timeout.stop();
+        if (!m_presence) {
+            m_presence = true;
+            emit presenceChanged(m_presence);
+            qCDebug(dcPhilipsHue) << "Motion sensor presence changed" << m_presence;
         }
+    } else if (m_presence) {
+        qCDebug(dcPhilipsHue) << "Motion sensor motion ended, starting timeout" << m_timeout.interval();
+        m_timeout.start();
+    }
+}
+
+void HueMotionSensor::setTemperature(double temperature)
+{
+    if (m_temperature != temperature) {
+        m_temperature = temperature;
+        emit temperatureChanged(m_temperature);
+        qCDebug(dcPhilipsHue) << "Motion sensor temperature changed" << m_temperature;
+    }
+}
+
+void HueMotionSensor::setLightLevel(int lightLevel)
+{
+    // Hue Light level is "10000 * log10(lux) + 1"
+    // => lux = 10^((lightLevel - 1) / 10000)
+    double lightIntensity = qPow(10, (lightLevel - 1) / 10000.0);
+    // Round to 2 digits
+    lightIntensity = qRound(lightIntensity * 100) / 100.0;
+    if (!qFuzzyCompare(m_lightIntensity, lightIntensity)) {
+        m_lightIntensity = lightIntensity;
+        qCDebug(dcPhilipsHue) << "Motion sensor light intensity changed" << m_lightIntensity;
+        emit lightIntensityChanged(m_lightIntensity);
+    }
+}
+
+void HueMotionSensor::setBatteryLevel(int batteryLevel)
+{
+    if (m_batteryLevel != batteryLevel) {
+        m_batteryLevel = batteryLevel;
+        emit batteryLevelChanged(m_batteryLevel);
     }
 }
 
@@ -71,6 +71,12 @@ public:
 
     void updateStates(const QVariantMap &sensorMap);
 
+    // Updates from the v2 event stream
+    void setMotion(bool motion);
+    void setTemperature(double temperature);
+    void setLightLevel(int lightLevel);
+    void setBatteryLevel(int batteryLevel);
+
     bool isValid();
     bool hasSensor(int sensorId);
     bool hasSensor(const QString &sensorUuid);
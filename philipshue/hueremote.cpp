@@ -34,6 +34,7 @@
 HueRemote::HueRemote(HueBridge *bridge, QObject *parent) :
     HueDevice(bridge, parent)
 {
+    connect(this, &HueDevice::reachableChanged, this, &HueRemote::stateChanged);
 }
 
 int HueRemote::battery() const
@@ -78,3 +79,23 @@ void HueRemote::updateStates(const QVariantMap &statesMap, const QVariantMap &co
     }
 }
 
+void HueRemote::setBatteryLevel(int batteryLevel)
+{
+    if (m_battery == batteryLevel)
+        return;
+
+    m_battery = batteryLevel;
+    emit stateChanged();
+}
+
+void HueRemote::setButtonEvent(int buttonCode)
+{
+    qCDebug(dcPhilipsHue) << "button pressed" << buttonCode;
+
+    // Forget the last polled state so a later poll (if the event stream drops) only
+    // re-seeds it instead of reporting this press a second time.
+    m_lastUpdate.clear();
+    m_lastButtonCode = -1;
+
+    emit buttonPressed(buttonCode);
+}
@@ -51,8 +51,12 @@ public:
 
     void updateStates(const QVariantMap &statesMap, const QVariantMap &configMap);
 
+    // Updates from the v2 event stream
+    void setBatteryLevel(int batteryLevel);
+    void setButtonEvent(int buttonCode);
+
 private:
-    int m_battery;
+    int m_battery = 0;
     QString m_lastUpdate;
     int m_lastButtonCode = -1;
 
@@ -61,8 +61,12 @@ void IntegrationPluginPhilipsHue::init()
 {
     m_pluginTimer1Sec = hardwareManager()->pluginTimerManager()->registerTimer(1);
     connect(m_pluginTimer1Sec, &PluginTimer::timeout, this, [this]() {
-        // refresh sensors every second
+        // refresh sensors every second, unless the bridge pushes them through the event stream
         foreach (HueBridge *bridge, m_bridges.keys()) {
+            HueEventStream *eventStream = m_eventStreams.value(bridge);
+            if (eventStream && eventStream->connected()) {
+                continue;
+            }
             refreshSensors(bridge);
         }
     });
@@ -98,7 +102,14 @@ void IntegrationPluginPhilipsHue::init()
         pluginStorage()->setValue("hostCache", entry.hostAddress().toString());
         pluginStorage()->endGroup();
         HueBridge *bridge = m_bridges.key(thing);
+        if (bridge->hostAddress() == entry.hostAddress()) {
+            return;
+        }
         bridge->setHostAddress(entry.hostAddress());
+        if (m_eventStreams.contains(bridge)) {
+            m_eventStreams.value(bridge)->stop();
+            m_eventStreams.value(bridge)->start();
+        }
     });
 }
 
@@ -369,6 +380,7 @@ void IntegrationPluginPhilipsHue::setupThing(ThingSetupInfo *info)
 
         connect(hueLight, &HueLight::stateChanged, this, &IntegrationPluginPhilipsHue::lightStateChanged);
         m_lights.insert(hueLight, thing);
+        m_lightIndex[thing->parentId()].insert(hueLight->id(), hueLight);
 
         refreshLight(thing);
 
@@ -387,6 +399,7 @@ void IntegrationPluginPhilipsHue::setupThing(ThingSetupInfo *info)
 
         connect(hueLight, &HueLight::stateChanged, this, &IntegrationPluginPhilipsHue::lightStateChanged);
         m_lights.insert(hueLight, thing);
+        m_lightIndex[thing->parentId()].insert(hueLight->id(), hueLight);
 
         refreshLight(thing);
 
@@ -431,6 +444,7 @@ void IntegrationPluginPhilipsHue::setupThing(ThingSetupInfo *info)
         connect(hueLight, &HueLight::stateChanged, this, &IntegrationPluginPhilipsHue::lightStateChanged);
 
         m_lights.insert(hueLight, thing);
+        m_lightIndex[thing->parentId()].insert(hueLight->id(), hueLight);
         refreshLight(thing);
 
         return info->finish(Thing::ThingErrorNoError);
@@ -450,6 +464,7 @@ void IntegrationPluginPhilipsHue::setupThing(ThingSetupInfo *info)
         connect(hueLight, &HueLight::stateChanged, this, &IntegrationPluginPhilipsHue::lightStateChanged);
 
         m_lights.insert(hueLight, thing);
+        m_lightIndex[thing->parentId()].insert(hueLight->id(), hueLight);
         refreshLight(thing);
 
         return info->finish(Thing::ThingErrorNoError);
@@ -653,6 +668,7 @@ void IntegrationPluginPhilipsHue::setupThing(ThingSetupInfo *info)
         });
         connect(smartPlug, &HueLight::stateChanged, this, &IntegrationPluginPhilipsHue::lightStateChanged);
         m_lights.insert(smartPlug, thing);
+        m_lightIndex[thing->parentId()].insert(smartPlug->id(), smartPlug);
         info->finish(Thing::ThingErrorNoError);
         return;
     }
@@ -675,6 +691,9 @@ void IntegrationPluginPhilipsHue::thingRemoved(Thing *thing)
         qCDebug(dcPhilipsHue()) << "Bridge removed" << thing->name();
         HueBridge *bridge = m_bridges.key(thing);
         m_bridges.remove(bridge);
+        delete m_eventStreams.take(bridge);
+        delete m_commandSchedulers.take(bridge);
+        m_lightIndex.remove(thing->id());
         bridge->deleteLater();
     }
 
@@ -685,6 +704,9 @@ void IntegrationPluginPhilipsHue::thingRemoved(Thing *thing)
             || thing->thingClassId() == smartPlugThingClassId) {
         HueLight *light = m_lights.key(thing);
         m_lights.remove(light);
+        if (m_lightIndex.value(thing->parentId()).value(light->id()) == light) {
+            m_lightIndex[thing->parentId()].remove(light->id());
+        }
         light->deleteLater();
     }
 
@@ -926,60 +948,58 @@ void IntegrationPluginPhilipsHue::executeAction(ThingActionInfo *info)
             return info->finish(Thing::ThingErrorHardwareNotAvailable);
         }
 
+        // Light commands go through the bridge's command scheduler instead of being sent directly
+        QPair<QNetworkRequest, QByteArray> lightRequest;
+
         if (action.actionTypeId() == colorLightPowerActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetPowerRequest(action.param(colorLightPowerActionPowerParamTypeId).value().toBool());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetPowerRequest(action.param(colorLightPowerActionPowerParamTypeId).value().toBool());
         } else if (action.actionTypeId() == colorLightColorActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetColorRequest(action.param(colorLightColorActionColorParamTypeId).value().value<QColor>());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetColorRequest(action.param(colorLightColorActionColorParamTypeId).value().value<QColor>());
         } else if (action.actionTypeId() == colorLightBrightnessActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetBrightnessRequest(percentageToBrightness(action.param(colorLightBrightnessActionBrightnessParamTypeId).value().toInt()));
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetBrightnessRequest(percentageToBrightness(action.param(colorLightBrightnessActionBrightnessParamTypeId).value().toInt()));
         } else if (action.actionTypeId() == colorLightEffectActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetEffectRequest(action.param(colorLightEffectActionEffectParamTypeId).value().toString());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetEffectRequest(action.param(colorLightEffectActionEffectParamTypeId).value().toString());
         } else if (action.actionTypeId() == colorLightAlertActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createFlashRequest(action.param(colorLightAlertActionAlertParamTypeId).value().toString());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createFlashRequest(action.param(colorLightAlertActionAlertParamTypeId).value().toString());
         } else if (action.actionTypeId() == colorLightColorTemperatureActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetTemperatureRequest(action.param(colorLightColorTemperatureActionColorTemperatureParamTypeId).value().toInt());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetTemperatureRequest(action.param(colorLightColorTemperatureActionColorTemperatureParamTypeId).value().toInt());
         }
         // Color temperature light
         else if (action.actionTypeId() == colorTemperatureLightPowerActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetPowerRequest(action.param(colorTemperatureLightPowerActionPowerParamTypeId).value().toBool());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetPowerRequest(action.param(colorTemperatureLightPowerActionPowerParamTypeId).value().toBool());
         } else if (action.actionTypeId() == colorTemperatureLightBrightnessActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetBrightnessRequest(percentageToBrightness(action.param(colorTemperatureLightBrightnessActionBrightnessParamTypeId).value().toInt()));
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetBrightnessRequest(percentageToBrightness(action.param(colorTemperatureLightBrightnessActionBrightnessParamTypeId).value().toInt()));
         } else if (action.actionTypeId() == colorTemperatureLightAlertActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createFlashRequest(action.param(colorTemperatureLightAlertActionAlertParamTypeId).value().toString());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createFlashRequest(action.param(colorTemperatureLightAlertActionAlertParamTypeId).value().toString());
         } else if (action.actionTypeId() == colorTemperatureLightColorTemperatureActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetTemperatureRequest(action.param(colorTemperatureLightColorTemperatureActionColorTemperatureParamTypeId).value().toInt());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetTemperatureRequest(action.param(colorTemperatureLightColorTemperatureActionColorTemperatureParamTypeId).value().toInt());
         }
         // Dimmable light
         else if (action.actionTypeId() == dimmableLightPowerActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetPowerRequest(action.param(dimmableLightPowerActionPowerParamTypeId).value().toBool());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetPowerRequest(action.param(dimmableLightPowerActionPowerParamTypeId).value().toBool());
         } else if (action.actionTypeId() == dimmableLightBrightnessActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetBrightnessRequest(percentageToBrightness(action.param(dimmableLightBrightnessActionBrightnessParamTypeId).value().toInt()));
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetBrightnessRequest(percentageToBrightness(action.param(dimmableLightBrightnessActionBrightnessParamTypeId).value().toInt()));
         } else if (action.actionTypeId() == dimmableLightAlertActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createFlashRequest(action.param(dimmableLightAlertActionAlertParamTypeId).value().toString());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createFlashRequest(action.param(dimmableLightAlertActionAlertParamTypeId).value().toString());
         }
         // On/Off light
         else if (action.actionTypeId() == onOffLightPowerActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetPowerRequest(action.param(onOffLightPowerActionPowerParamTypeId).value().toBool());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetPowerRequest(action.param(onOffLightPowerActionPowerParamTypeId).value().toBool());
         }
 
         // Hue smart plug
         else if (action.actionTypeId() == smartPlugPowerActionTypeId) {
-            QPair<QNetworkRequest, QByteArray> request = light->createSetPowerRequest(action.param(smartPlugPowerActionPowerParamTypeId).value().toBool());
-            reply = hardwareManager()->networkManager()->put(request.first, request.second);
+            lightRequest = light->createSetPowerRequest(action.param(smartPlugPowerActionPowerParamTypeId).value().toBool());
+        }
+
+        if (!lightRequest.second.isEmpty()) {
+            HueBridge *bridge = m_bridges.key(myThings().findById(thing->parentId()));
+            QVariantMap state = QJsonDocument::fromJson(lightRequest.second).toVariant().toMap();
+            HueCommandReply *commandReply = commandScheduler(bridge)->setLightState(light->id(), state);
+            connect(commandReply, &HueCommandReply::finished, info, [this, info, commandReply](){
+                finishAction(info, commandReply->failed(), commandReply->responseData());
+            });
+            return;
         }
     }
 
@@ -1015,37 +1035,41 @@ void IntegrationPluginPhilipsHue::executeAction(ThingActionInfo *info)
 
     // Handle response if info is still around
     connect(reply, &QNetworkReply::finished, info, [this, info, reply](){
-        if (reply->error() != QNetworkReply::NoError) {
-            info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Error sending command to hue bridge."));
-            return;
-        }
+        finishAction(info, reply->error() != QNetworkReply::NoError, reply->readAll());
+    });
+}
 
-        QByteArray data = reply->readAll();
-        QJsonParseError error;
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(data, &error);
+void IntegrationPluginPhilipsHue::finishAction(ThingActionInfo *info, bool failed, const QByteArray &data)
+{
+    if (failed) {
+        info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Error sending command to hue bridge."));
+        return;
+    }
 
-        if (error.error != QJsonParseError::NoError) {
-            qCWarning(dcPhilipsHue) << "Hue Bridge json error in response" << error.errorString();
-            info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Received unexpected data from hue bridge."));
-            return;
-        }
+    QJsonParseError error;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(data, &error);
 
-        if (data.contains("error")) {
-            if (!jsonDoc.toVariant().toList().isEmpty()) {
-                qCWarning(dcPhilipsHue) << "Failed to execute Hue action:" << jsonDoc.toJson(); //jsonDoc.toVariant().toList().first().toMap().value("error").toMap().value("description").toString();
-            } else {
-                qCWarning(dcPhilipsHue) << "Failed to execute Hue action: Invalid error message format";
-            }
-            info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("An unexpected error happened when sending the command to the hue bridge."));
-            return;
-        }
+    if (error.error != QJsonParseError::NoError) {
+        qCWarning(dcPhilipsHue) << "Hue Bridge json error in response" << error.errorString();
+        info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("Received unexpected data from hue bridge."));
+        return;
+    }
 
-        if (info->thing()->thingClassId() != bridgeThingClassId) {
-            m_lights.key(info->thing())->processActionResponse(jsonDoc.toVariant().toList());
+    if (data.contains("error")) {
+        if (!jsonDoc.toVariant().toList().isEmpty()) {
+            qCWarning(dcPhilipsHue) << "Failed to execute Hue action:" << jsonDoc.toJson(); //jsonDoc.toVariant().toList().first().toMap().value("error").toMap().value("description").toString();
+        } else {
+            qCWarning(dcPhilipsHue) << "Failed to execute Hue action: Invalid error message format";
         }
+        info->finish(Thing::ThingErrorHardwareFailure, QT_TR_NOOP("An unexpected error happened when sending the command to the hue bridge."));
+        return;
+    }
 
-        info->finish(Thing::ThingErrorNoError);
-    });
+    if (info->thing()->thingClassId() != bridgeThingClassId) {
+        m_lights.key(info->thing())->processActionResponse(jsonDoc.toVariant().toList());
+    }
+
+    info->finish(Thing::ThingErrorNoError);
 }
 
 void IntegrationPluginPhilipsHue::browseThing(BrowseResult *result)
@@ -1475,6 +1499,130 @@ void IntegrationPluginPhilipsHue::refreshSensors(HueBridge *bridge)
     m_sensorsRefreshRequests.insert(reply, thing);
 }
 
+void IntegrationPluginPhilipsHue::setupEventStream(HueBridge *bridge)
+{
+    qCDebug(dcPhilipsHue()) << "Bridge" << bridge->name() << "supports the event stream. Switching sensors from polling to events.";
+    HueEventStream *eventStream = new HueEventStream(hardwareManager()->networkManager(), bridge, this);
+    m_eventStreams.insert(bridge, eventStream);
+
+    connect(eventStream, &HueEventStream::connectedChanged, this, [this, bridge](bool connected){
+        // Catch up with whatever happened while we weren't listening
+        if (connected) {
+            refreshSensors(bridge);
+        }
+    });
+    connect(eventStream, &HueEventStream::motionChanged, this, [this, bridge](int sensorId, bool motion){
+        HueMotionSensor *motionSensor = findMotionSensor(m_bridges.value(bridge), sensorId);
+        if (motionSensor) {
+            motionSensor->setMotion(motion);
+        }
+    });
+    connect(eventStream, &HueEventStream::temperatureChanged, this, [this, bridge](int sensorId, double temperature){
+        HueMotionSensor *motionSensor = findMotionSensor(m_bridges.value(bridge), sensorId);
+        if (motionSensor) {
+            motionSensor->setTemperature(temperature);
+        }
+    });
+    connect(eventStream, &HueEventStream::lightLevelChanged, this, [this, bridge](int sensorId, int lightLevel){
+        HueMotionSensor *motionSensor = findMotionSensor(m_bridges.value(bridge), sensorId);
+        if (motionSensor) {
+            motionSensor->setLightLevel(lightLevel);
+        }
+    });
+    connect(eventStream, &HueEventStream::batteryLevelChanged, this, [this, bridge](int sensorId, int batteryLevel){
+        Thing *bridgeThing = m_bridges.value(bridge);
+        HueMotionSensor *motionSensor = findMotionSensor(bridgeThing, sensorId);
+        if (motionSensor) {
+            motionSensor->setBatteryLevel(batteryLevel);
+        }
+        HueRemote *remote = findRemote(bridgeThing, sensorId);
+        if (remote) {
+            remote->setBatteryLevel(batteryLevel);
+        }
+    });
+    connect(eventStream, &HueEventStream::reachableChanged, this, [this, bridge](int sensorId, bool reachable){
+        Thing *bridgeThing = m_bridges.value(bridge);
+        HueMotionSensor *motionSensor = findMotionSensor(bridgeThing, sensorId);
+        if (motionSensor) {
+            motionSensor->setReachable(reachable);
+        }
+        HueRemote *remote = findRemote(bridgeThing, sensorId);
+        if (remote) {
+            remote->setReachable(reachable);
+        }
+    });
+    connect(eventStream, &HueEventStream::buttonEvent, this, [this, bridge](int sensorId, int controlId, const QString &event){
+        HueRemote *remote = findRemote(m_bridges.value(bridge), sensorId);
+        if (!remote) {
+            return;
+        }
+        int buttonCode = buttonCodeForEvent(m_remotes.value(remote), controlId, event);
+        if (buttonCode >= 0) {
+            remote->setButtonEvent(buttonCode);
+        }
+    });
+
+    eventStream->start();
+}
+
+HueCommandScheduler *IntegrationPluginPhilipsHue::commandScheduler(HueBridge *bridge)
+{
+    if (!m_commandSchedulers.contains(bridge)) {
+        m_commandSchedulers.insert(bridge, new HueCommandScheduler(hardwareManager()->networkManager(), bridge, this));
+    }
+    return m_commandSchedulers.value(bridge);
+}
+
+HueRemote *IntegrationPluginPhilipsHue::findRemote(Thing *bridgeThing, int sensorId)
+{
+    foreach (HueRemote *remote, m_remotes.keys()) {
+        if (remote->id() == sensorId && m_remotes.value(remote)->parentId() == bridgeThing->id()) {
+            return remote;
+        }
+    }
+    return nullptr;
+}
+
+HueMotionSensor *IntegrationPluginPhilipsHue::findMotionSensor(Thing *bridgeThing, int sensorId)
+{
+    foreach (HueMotionSensor *motionSensor, m_motionSensors.keys()) {
+        if (motionSensor->hasSensor(sensorId) && m_motionSensors.value(motionSensor)->parentId() == bridgeThing->id()) {
+            return motionSensor;
+        }
+    }
+    return nullptr;
+}
+
+int IntegrationPluginPhilipsHue::buttonCodeForEvent(Thing *thing, int controlId, const QString &event)
+{
+    // The v2 API reports the button number and event separately. Translate them into the
+    // v1 "buttonevent" codes onRemoteButtonEvent() already knows how to handle.
+    if (thing->thingClassId() == tapThingClassId || thing->thingClassId() == fohThingClassId) {
+        // Green power switches only report presses
+        if (event != "initial_press") {
+            return -1;
+        }
+        static const QList<int> tapCodes = {34, 16, 17, 18};
+        static const QList<int> fohCodes = {20, 21, 23, 22};
+        const QList<int> &codes = thing->thingClassId() == tapThingClassId ? tapCodes : fohCodes;
+        return codes.value(controlId - 1, -1);
+    }
+
+    // x000 initial press, x001 hold, x002 short release, x003 long release
+    static const QHash<QString, int> eventCodes = {
+        {"initial_press", 0},
+        {"repeat", 1},
+        {"long_press", 1},
+        {"short_release", 2},
+        {"long_release", 3}
+    };
+    if (!eventCodes.contains(event)) {
+        qCDebug(dcPhilipsHue()) << "Unhandled button event" << event << "from" << thing->name();
+        return -1;
+    }
+    return controlId * 1000 + eventCodes.value(event);
+}
+
 void IntegrationPluginPhilipsHue::discoverBridgeDevices(HueBridge *bridge)
 {
     Thing *thing = m_bridges.value(bridge);
@@ -1965,6 +2113,10 @@ void IntegrationPluginPhilipsHue::processBridgeRefreshResponse(Thing *thing, con
 
     HueBridge *bridge = m_bridges.key(thing);
     bridge->setApiVersion(bridgeApiVersion);
+    if (bridge->supportsEventStream() && !m_eventStreams.contains(bridge)) {
+        setupEventStream(bridge);
+    }
+    commandScheduler(bridge)->refreshGroups();
     if (bridgeApiVersion < "1.20") {
         int updateStatus = configMap.value("swupdate").toMap().value("updatestate").toInt();
         switch (updateStatus) {
@@ -2020,15 +2172,13 @@ void IntegrationPluginPhilipsHue::processLightsRefreshResponse(Thing *thing, con
         return;
     }
 
-    // Update light states
-    QVariantMap lightsMap = jsonDoc.toVariant().toMap();
-    foreach (const QString &lightId, lightsMap.keys()) {
-        QVariantMap lightMap = lightsMap.value(lightId).toMap();
-        // get the light of this bridge
-        foreach (HueLight *light, m_lights.keys()) {
-            if (light->id() == lightId.toInt() && m_lights.value(light)->parentId() == thing->id()) {
-                light->updateStates(lightMap.value("state").toMap());
-            }
+    // Update light states, only touching lights whose state actually changed
+    const QHash<int, HueLight *> lights = m_lightIndex.value(thing->id());
+    QJsonObject lightsObject = jsonDoc.object();
+    for (QJsonObject::const_iterator it = lightsObject.constBegin(); it != lightsObject.constEnd(); ++it) {
+        HueLight *light = lights.value(it.key().toInt());
+        if (light) {
+            light->updateStatesIfChanged(it.value().toObject().value("state").toObject());
         }
     }
 }
@@ -2109,6 +2259,7 @@ void IntegrationPluginPhilipsHue::bridgeReachableChanged(Thing *thing, bool reac
             foreach (HueLight *light, m_lights.keys()) {
                 if (m_lights.value(light)->parentId() == thing->id()) {
                     light->setReachable(false);
+                    light->invalidateStates();
                     if (m_lights.value(light)->thingClassId() == colorLightThingClassId) {
                         m_lights.value(light)->setStateValue(colorLightConnectedStateTypeId, false);
                     } else if (m_lights.value(light)->thingClassId() == colorTemperatureLightThingClassId) {
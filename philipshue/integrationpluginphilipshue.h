@@ -36,6 +36,8 @@
 #include "huelight.h"
 #include "hueremote.h"
 #include "huemotionsensor.h"
+#include "hueeventstream.h"
+#include "huecommandscheduler.h"
 
 #include "plugintimer.h"
 #include "network/networkaccessmanager.h"
@@ -120,8 +122,11 @@ private:
 
     QHash<HueBridge *, Thing *> m_bridges;
     QHash<HueLight *, Thing *> m_lights;
+    QHash<ThingId, QHash<int, HueLight *>> m_lightIndex; // bridge thing id -> light id -> light
     QHash<HueRemote *, Thing *> m_remotes;
     QHash<HueMotionSensor *, Thing *> m_motionSensors;
+    QHash<HueBridge *, HueEventStream *> m_eventStreams;
+    QHash<HueBridge *, HueCommandScheduler *> m_commandSchedulers;
 
     void refreshLight(Thing *thing);
     void refreshBridge(Thing *thing);
@@ -129,6 +134,13 @@ private:
     void refreshLights(HueBridge *bridge);
     void refreshSensors(HueBridge *bridge);
 
+    void setupEventStream(HueBridge *bridge);
+    HueCommandScheduler *commandScheduler(HueBridge *bridge);
+    void finishAction(ThingActionInfo *info, bool failed, const QByteArray &data);
+    HueRemote *findRemote(Thing *bridgeThing, int sensorId);
+    HueMotionSensor *findMotionSensor(Thing *bridgeThing, int sensorId);
+    int buttonCodeForEvent(Thing *thing, int controlId, const QString &event);
+
     void discoverBridgeDevices(HueBridge *bridge);
     void searchNewDevices(HueBridge *bridge, const QString &serialNumber);
 
@@ -12,6 +12,8 @@ SOURCES += \
     huelight.cpp \
     huemotionsensor.cpp \
     hueremote.cpp \
+    hueeventstream.cpp \
+    huecommandscheduler.cpp \
     huedevice.cpp
 
 HEADERS += \
@@ -23,6 +25,8 @@ HEADERS += \
     huelight.h \
     huemotionsensor.h \
     hueremote.h \
+    hueeventstream.h \
+    huecommandscheduler.h \
     huedevice.h
 
 
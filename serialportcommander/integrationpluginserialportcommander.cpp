@@ -33,6 +33,8 @@
 
 IntegrationPluginSerialPortCommander::IntegrationPluginSerialPortCommander()
 {
+    // Shared by all ports, the data is handed to the framer of the port right away
+    m_readBuffer.resize(4096);
 }
 
 
@@ -117,6 +119,23 @@ void IntegrationPluginSerialPortCommander::setupThing(ThingSetupInfo *info)
         connect(serialPort, SIGNAL(stopBitsChanged(QSerialPort::StopBits)), this, SLOT(onStopBitsChanged(QSerialPort::StopBits)));
         connect(serialPort, SIGNAL(flowControlChanged(QSerialPort::FlowControl)), this, SLOT(onFlowControlChanged(QSerialPort::FlowControl)));
         m_serialPorts.insert(thing, serialPort);
+
+        SerialFramer *framer = new SerialFramer(this);
+        configureFramer(thing, framer);
+        connect(framer, &SerialFramer::frameReceived, thing, [this, thing](const QByteArray &frame){
+            qDebug(dcSerialPortCommander()) << "Message received" << frame;
+            Event event(serialPortCommanderTriggeredEventTypeId, thing->id());
+            ParamList parameters;
+            parameters.append(Param(serialPortCommanderTriggeredEventInputDataParamTypeId, formatData(frame, thing->setting(serialPortCommanderSettingsInputFormatParamTypeId).toString())));
+            event.setParams(parameters);
+            emitEvent(event);
+        });
+        connect(thing, &Thing::settingChanged, framer, [this, thing, framer](const ParamTypeId &paramTypeId){
+            if (paramTypeId != serialPortCommanderSettingsInputFormatParamTypeId) {
+                configureFramer(thing, framer);
+            }
+        });
+        m_serialFramers.insert(thing, framer);
         thing->setStateValue(serialPortCommanderConnectedStateTypeId, true);
     }
     return info->finish(Thing::ThingErrorNoError);
@@ -154,6 +173,11 @@ void IntegrationPluginSerialPortCommander::thingRemoved(Thing *thing)
             }
             serialPort->deleteLater();
         }
+
+        SerialFramer *framer = m_serialFramers.take(thing);
+        if (framer) {
+            framer->deleteLater();
+        }
     }
 
     if (myThings().empty()) {
@@ -167,17 +191,15 @@ void IntegrationPluginSerialPortCommander::onReadyRead()
     QSerialPort *serialPort =  static_cast<QSerialPort*>(sender());
     Thing *thing = m_serialPorts.key(serialPort);
 
-    QByteArray data;
-    while (!serialPort->atEnd()) {
-        data.append(serialPort->read(100));
-    }
-    qDebug(dcSerialPortCommander()) << "Message received" << data;
+    SerialFramer *framer = m_serialFramers.value(thing);
+    if (!framer)
+        return;
 
-    Event event(serialPortCommanderTriggeredEventTypeId, thing->id());
-    ParamList parameters;
-    parameters.append(Param(serialPortCommanderTriggeredEventInputDataParamTypeId, data));
-    event.setParams(parameters);
-    emitEvent(event);
+    // Events are emitted by the framer once per complete message, not per read
+    qint64 size = 0;
+    while ((size = serialPort->read(m_readBuffer.data(), m_readBuffer.size())) > 0) {
+        framer->processData(m_readBuffer.constData(), static_cast<int>(size));
+    }
 }
 
 void IntegrationPluginSerialPortCommander::onSerialError(QSerialPort::SerialPortError error)
@@ -189,6 +211,9 @@ void IntegrationPluginSerialPortCommander::onSerialError(QSerialPort::SerialPort
         qCCritical(dcSerialPortCommander()) << "Serial port error:" << error << serialPort->errorString();
         m_reconnectTimer->start();
         serialPort->close();
+        if (m_serialFramers.contains(thing)) {
+            m_serialFramers.value(thing)->reset();
+        }
         thing->setStateValue(serialPortCommanderConnectedStateTypeId, false);
     }
 }
@@ -246,3 +271,31 @@ void IntegrationPluginSerialPortCommander::onReconnectTimer()
     }
 }
 
+void IntegrationPluginSerialPortCommander::configureFramer(Thing *thing, SerialFramer *framer)
+{
+    framer->setMode(SerialFramer::modeFromString(thing->setting(serialPortCommanderSettingsFramingParamTypeId).toString()));
+    framer->setDelimiter(SerialFramer::unescape(thing->setting(serialPortCommanderSettingsDelimiterParamTypeId).toString()));
+    framer->setFrameLength(thing->setting(serialPortCommanderSettingsFrameLengthParamTypeId).toInt());
+    framer->setInterByteTimeout(thing->setting(serialPortCommanderSettingsInterByteTimeoutParamTypeId).toInt());
+}
+
+QString IntegrationPluginSerialPortCommander::formatData(const QByteArray &data, const QString &format) const
+{
+    if (format == "Hex") {
+        QStringList bytes;
+        foreach (char byte, data) {
+            bytes.append(QString("%1").arg(static_cast<quint8>(byte), 2, 16, QChar('0')));
+        }
+        return bytes.join(' ');
+    }
+
+    if (format == "Binary") {
+        QStringList bytes;
+        foreach (char byte, data) {
+            bytes.append(QString("%1").arg(static_cast<quint8>(byte), 8, 2, QChar('0')));
+        }
+        return bytes.join(' ');
+    }
+
+    return QString::fromUtf8(data);
+}
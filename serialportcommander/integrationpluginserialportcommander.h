@@ -32,6 +32,7 @@
 #define INTEGRATIONPLUGINSERIALPORTCOMMANDER_H
 
 #include "integrations/integrationplugin.h"
+#include "serialframer.h"
 
 #include <QTimer>
 #include <QSerialPort>
@@ -55,6 +56,11 @@ public:
 private:
     QTimer *m_reconnectTimer = nullptr;
     QHash<Thing *, QSerialPort *> m_serialPorts;
+    QHash<Thing *, SerialFramer *> m_serialFramers;
+    QByteArray m_readBuffer;
+
+    void configureFramer(Thing *thing, SerialFramer *framer);
+    QString formatData(const QByteArray &data, const QString &format) const;
 
 private slots:
     void onReadyRead();
@@ -0,0 +1,275 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "serialframer.h"
+#include "extern-plugininfo.h"
+
+#include <string.h>
+
+static const char stx = 0x02;
+static const char etx = 0x03;
+static const char dle = 0x10;
+
+SerialFramer::SerialFramer(QObject *parent) :
+    QObject(parent)
+{
+    m_frame.resize(m_maxFrameSize);
+
+    m_interByteTimer.setSingleShot(true);
+    m_interByteTimer.setInterval(20);
+    connect(&m_interByteTimer, &QTimer::timeout, this, [this](){
+        if (m_frameSize > 0) {
+            emitFrame();
+        }
+    });
+}
+
+SerialFramer::Mode SerialFramer::mode() const
+{
+    return m_mode;
+}
+
+void SerialFramer::setMode(Mode mode)
+{
+    m_mode = mode;
+    reset();
+}
+
+QByteArray SerialFramer::delimiter() const
+{
+    return m_delimiter;
+}
+
+void SerialFramer::setDelimiter(const QByteArray &delimiter)
+{
+    m_delimiter = delimiter;
+    reset();
+}
+
+int SerialFramer::frameLength() const
+{
+    return m_frameLength;
+}
+
+void SerialFramer::setFrameLength(int frameLength)
+{
+    m_frameLength = qBound(1, frameLength, m_maxFrameSize);
+    reset();
+}
+
+int SerialFramer::interByteTimeout() const
+{
+    return m_interByteTimer.interval();
+}
+
+void SerialFramer::setInterByteTimeout(int interByteTimeout)
+{
+    m_interByteTimer.setInterval(qMax(1, interByteTimeout));
+}
+
+int SerialFramer::maxFrameSize() const
+{
+    return m_maxFrameSize;
+}
+
+void SerialFramer::setMaxFrameSize(int maxFrameSize)
+{
+    m_maxFrameSize = qMax(1, maxFrameSize);
+    m_frame.resize(m_maxFrameSize);
+    m_frameLength = qMin(m_frameLength, m_maxFrameSize);
+    reset();
+}
+
+void SerialFramer::processData(const char *data, int size)
+{
+    if (size <= 0)
+        return;
+
+    if (m_mode == ModeNone || (m_mode == ModeDelimiter && m_delimiter.isEmpty())) {
+        emit frameReceived(QByteArray(data, size));
+        return;
+    }
+
+    for (int i = 0; i < size; i++) {
+        char byte = data[i];
+        switch (m_mode) {
+        case ModeDelimiter:
+            append(byte);
+            if (m_frameSize >= m_delimiter.size() && memcmp(m_frame.constData() + m_frameSize - m_delimiter.size(), m_delimiter.constData(), static_cast<size_t>(m_delimiter.size())) == 0) {
+                m_frameSize -= m_delimiter.size();
+                if (m_frameSize > 0 && !m_overflow) {
+                    emitFrame();
+                }
+                m_frameSize = 0;
+                m_overflow = false;
+            }
+            break;
+        case ModeFixedLength:
+            append(byte);
+            if (m_frameSize == m_frameLength) {
+                emitFrame();
+            }
+            break;
+        case ModeStxEtx:
+            if (m_escaped) {
+                m_escaped = false;
+                append(byte);
+            } else if (byte == stx) {
+                // A new start discards an unterminated frame
+                m_inFrame = true;
+                m_frameSize = 0;
+                m_overflow = false;
+            } else if (!m_inFrame) {
+                // Noise between frames
+            } else if (byte == dle) {
+                m_escaped = true;
+            } else if (byte == etx) {
+                if (!m_overflow) {
+                    emitFrame();
+                }
+                m_inFrame = false;
+                m_frameSize = 0;
+                m_overflow = false;
+            } else {
+                append(byte);
+            }
+            break;
+        case ModeInterByteTimeout:
+            append(byte);
+            if (m_frameSize == m_maxFrameSize) {
+                emitFrame();
+            }
+            break;
+        case ModeNone:
+            break;
+        }
+    }
+
+    if (m_mode == ModeInterByteTimeout && m_frameSize > 0) {
+        m_interByteTimer.start();
+    }
+}
+
+void SerialFramer::reset()
+{
+    m_interByteTimer.stop();
+    m_frameSize = 0;
+    m_inFrame = false;
+    m_escaped = false;
+    m_overflow = false;
+}
+
+SerialFramer::Mode SerialFramer::modeFromString(const QString &mode)
+{
+    if (mode == "Delimiter")
+        return ModeDelimiter;
+
+    if (mode == "Fixed length")
+        return ModeFixedLength;
+
+    if (mode == "STX/ETX")
+        return ModeStxEtx;
+
+    if (mode == "Inter-byte timeout")
+        return ModeInterByteTimeout;
+
+    return ModeNone;
+}
+
+QByteArray SerialFramer::unescape(const QString &text)
+{
+    QByteArray escaped = text.toUtf8();
+    QByteArray result;
+    for (int i = 0; i < escaped.size(); i++) {
+        if (escaped.at(i) != '\\' || i + 1 >= escaped.size()) {
+            result.append(escaped.at(i));
+            continue;
+        }
+
+        char c = escaped.at(++i);
+        switch (c) {
+        case 'n':
+            result.append('\n');
+            break;
+        case 'r':
+            result.append('\r');
+            break;
+        case 't':
+            result.append('\t');
+            break;
+        case '0':
+            result.append('\0');
+            break;
+        case 'x': {
+            bool ok = false;
+            char value = static_cast<char>(escaped.mid(i + 1, 2).toUInt(&ok, 16));
+            if (ok && i + 2 < escaped.size()) {
+                result.append(value);
+                i += 2;
+            } else {
+                result.append("\\x");
+            }
+            break;
+        }
+        default:
+            result.append(c);
+            break;
+        }
+    }
+    return result;
+}
+
+void SerialFramer::append(char byte)
+{
+    if (m_frameSize < m_maxFrameSize) {
+        m_frame[m_frameSize++] = byte;
+        return;
+    }
+
+    // Without a frame end the buffer is full, drop the frame until the next frame boundary
+    if (!m_overflow) {
+        qCWarning(dcSerialPortCommander()) << "Received message exceeds" << m_maxFrameSize << "bytes, discarding it";
+        m_overflow = true;
+    }
+    if (m_mode == ModeDelimiter) {
+        // Keep the bytes which could be the start of the delimiter, so the end of the message is still recognized
+        int tail = qMin(m_delimiter.size() - 1, m_frameSize);
+        memmove(m_frame.data(), m_frame.constData() + m_frameSize - tail, static_cast<size_t>(tail));
+        m_frameSize = tail;
+        m_frame[m_frameSize++] = byte;
+    }
+}
+
+void SerialFramer::emitFrame()
+{
+    m_interByteTimer.stop();
+    emit frameReceived(QByteArray(m_frame.constData(), m_frameSize));
+    m_frameSize = 0;
+}
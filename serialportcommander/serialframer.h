@@ -0,0 +1,97 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef SERIALFRAMER_H
+#define SERIALFRAMER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QByteArray>
+
+// Assembles messages from the fragments a serial port delivers. Bytes are processed one by one
+// into a preallocated frame buffer, frameReceived() is emitted once per complete message.
+class SerialFramer : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        ModeNone,               // Every read is one message
+        ModeDelimiter,          // Messages end with the delimiter, empty messages are skipped
+        ModeFixedLength,        // Messages have frameLength bytes
+        ModeStxEtx,             // Messages are enclosed in STX (0x02) and ETX (0x03), DLE (0x10) escapes the next byte
+        ModeInterByteTimeout    // Messages end when no data arrives for interByteTimeout ms
+    };
+
+    explicit SerialFramer(QObject *parent = nullptr);
+
+    Mode mode() const;
+    void setMode(Mode mode);
+
+    QByteArray delimiter() const;
+    void setDelimiter(const QByteArray &delimiter);
+
+    int frameLength() const;
+    void setFrameLength(int frameLength);
+
+    int interByteTimeout() const;
+    void setInterByteTimeout(int interByteTimeout);
+
+    int maxFrameSize() const;
+    void setMaxFrameSize(int maxFrameSize);
+
+    void processData(const char *data, int size);
+    void reset();
+
+    static Mode modeFromString(const QString &mode);
+    // Resolves escape sequences like \n, \r, \t, \\ and \xHH
+    static QByteArray unescape(const QString &text);
+
+signals:
+    void frameReceived(const QByteArray &frame);
+
+private:
+    Mode m_mode = ModeNone;
+    QByteArray m_delimiter = "\n";
+    int m_frameLength = 16;
+    int m_maxFrameSize = 4096;
+
+    QByteArray m_frame;
+    int m_frameSize = 0;
+    bool m_inFrame = false;
+    bool m_escaped = false;
+    bool m_overflow = false;
+
+    QTimer m_interByteTimer;
+
+    void append(char byte);
+    void emitFrame();
+};
+
+#endif // SERIALFRAMER_H
@@ -6,7 +6,9 @@ TARGET = $$qtLibraryTarget(nymea_integrationpluginserialportcommander)
 
 SOURCES += \
     integrationpluginserialportcommander.cpp \
+    serialframer.cpp
 
 
 HEADERS += \
     integrationpluginserialportcommander.h \
+    serialframer.h
@@ -31,13 +31,17 @@
 #include "integrationpluginshelly.h"
 #include "plugininfo.h"
 #include "shellyjsonrpcclient.h"
+#include "shellypollscheduler.h"
 
 #include <QUrlQuery>
 #include <QNetworkReply>
 #include <QHostAddress>
 #include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
 #include <QColor>
 #include <QNetworkInterface>
+#include <QDateTime>
 
 #include "hardwaremanager.h"
 #include "network/networkaccessmanager.h"
@@ -262,6 +266,37 @@ static QHash<ThingClassId, ParamTypeId> multipushTimeBetweenPushesSettingIds = {
     {shellyI3ThingClassId, shellyI3SettingsMultipushTimeBetweenPushesParamTypeId}
 };
 
+// CoIoT sensor ids handled in onMulticastMessageReceived()
+static QList<int> coiotSensorIds = {
+    1101, 1103, 1105, 1201,
+    2101, 2102, 2103, 2201, 2202, 2203, 2301, 2302, 2303,
+    3101, 3103, 3106, 3107, 3111, 3113, 3114, 3121, 3122,
+    4101, 4102, 4103, 4105, 4106, 4107, 4108, 4109, 4110,
+    4201, 4203, 4205, 4206, 4207, 4208, 4209, 4210,
+    4305, 4306, 4307, 4308, 4309, 4310,
+    5101, 5102, 5105, 5106, 5107, 5108,
+    6105, 6106, 6107, 6108, 6110
+};
+
+// CoIoT values are mostly numbers, but some firmware versions send them as strings
+static int coiotInt(const QJsonValue &value)
+{
+    return value.isString() ? value.toString().toInt() : qRound(value.toDouble());
+}
+
+static double coiotDouble(const QJsonValue &value)
+{
+    return value.isString() ? value.toString().toDouble() : value.toDouble();
+}
+
+static QString coiotString(const QJsonValue &value)
+{
+    return value.isString() ? value.toString() : QString::number(value.toDouble());
+}
+
+// In push mode, Gen2 devices are only polled if they have been silent for this long (ms)
+static const qint64 gen2StatusMaxSilence = 10 * 60 * 1000;
+
 IntegrationPluginShelly::IntegrationPluginShelly()
 {
 }
@@ -277,6 +312,10 @@ void IntegrationPluginShelly::init()
     m_coap = new Coap(this);
     connect(m_coap, &Coap::multicastMessageReceived, this, &IntegrationPluginShelly::onMulticastMessageReceived);
     joinMulticastGroup();
+
+    // Gen1 devices are polled by the scheduler, spread over the interval instead of all at once
+    m_pollScheduler = new ShellyPollScheduler(60, this);
+    connect(m_pollScheduler, &ShellyPollScheduler::pollRequested, this, &IntegrationPluginShelly::fetchStatusGen1);
 }
 
 void IntegrationPluginShelly::discoverThings(ThingDiscoveryInfo *info)
@@ -377,6 +416,7 @@ void IntegrationPluginShelly::postSetupThing(Thing *thing)
 
     if (thing->parentId().isNull()) {
         if (thing->paramValue("id").toString().contains("Plus")) {
+            fetchDeviceInfoGen2(thing);
             fetchStatusGen2(thing);
         } else {
             fetchStatusGen1(thing);
@@ -397,6 +437,21 @@ void IntegrationPluginShelly::thingRemoved(Thing *thing)
     if (m_rpcClients.contains(thing)) {
         m_rpcClients.remove(thing); // Deleted by parenting
     }
+    m_gen2StatusCache.remove(thing);
+    m_pollScheduler->removeThing(thing);
+
+    if (thing->parentId().isNull()) {
+        QMutableHashIterator<QString, Thing*> it(m_coiotThings);
+        while (it.hasNext()) {
+            if (it.next().value() == thing) {
+                it.remove();
+            }
+        }
+        m_coiotDescriptions.remove(thing);
+        m_coiotDispatchTables.remove(thing);
+    } else {
+        invalidateCoiotDispatchTable(myThings().findById(thing->parentId()));
+    }
     qCDebug(dcShelly()) << "Device removed" << thing->name();
 }
 
@@ -816,26 +871,18 @@ void IntegrationPluginShelly::onMulticastMessageReceived(const QHostAddress &sou
     }
 
     QByteArray deviceId = pdu.option(static_cast<CoapOption::Option>(3321)).data();
-    QStringList parts = QString(deviceId).split("#");
+    QList<QByteArray> parts = deviceId.split('#');
     if (parts.length() != 3) {
         qCDebug(dcShelly) << "Unexpected deviceId option format";
         return;
     }
 
-    QString shellyId = parts.at(1);
-    Thing *thing = nullptr;
-    foreach (Thing *t, myThings()) {
-        if (t->paramValue("id").toString().endsWith(shellyId)) {
-            thing = t;
-            break;
-        }
-    }
+    Thing *thing = findCoiotThing(QString::fromUtf8(parts.at(1)));
     if (!thing) {
         qCDebug(dcShelly()) << "Received a status update message for a shelly we don't know.";
         return;
     }
 
-    qCDebug(dcShelly()) << "Status update message for" << thing->name();
     QJsonParseError error;
     QJsonDocument jsonDoc = QJsonDocument::fromJson(pdu.payload(), &error);
     if (error.error != QJsonParseError::NoError) {
@@ -843,49 +890,62 @@ void IntegrationPluginShelly::onMulticastMessageReceived(const QHostAddress &sou
         return;
     }
 
+    qCDebug(dcShelly) << "CoIoT multicast message for" << thing->name() << ":" << pdu.payload();
+    m_pollScheduler->pushReceived(thing);
+
+    const CoiotDispatchTable table = coiotDispatchTable(thing);
+
     thing->setStateValue("connected", true);
-    foreach (Thing *child, myThings().filterByParentId(thing->id())) {
+    foreach (Thing *child, table.children) {
         child->setStateValue("connected", true);
     }
 
-    qCDebug(dcShelly) << "CoIoT multicast message for" << thing->name() << ":" << qUtf8Printable(jsonDoc.toJson());
-    QVariantMap map = jsonDoc.toVariant().toMap();
-
     // Some states are calculated from multiple values in the list and we'll need to keep them temporarily
     int red = 0, green = 0, blue = 0, white = 0;
     QString inputEvent1String, inputEvent2String, inputEvent3String;
     int inputEvent1Count = 0, inputEvent2Count = 0, inputEvent3Count = 0;
 
-    foreach (const QVariant &entry, map.value("G").toList()) {
-        int id = entry.toList().at(1).toInt();
-        QString value = entry.toList().at(2).toString();
-        switch (id) {
+    // Each entry in G is a [channel, sensorId, value] triple
+    const QJsonArray entries = jsonDoc.object().value("G").toArray();
+    for (int i = 0; i < entries.count(); i++) {
+        const QJsonArray entry = entries.at(i).toArray();
+        if (entry.count() < 3) {
+            continue;
+        }
+        QHash<int, CoiotSensor>::const_iterator sensor = table.sensors.constFind(entry.at(1).toInt());
+        if (sensor == table.sensors.constEnd()) {
+            continue;
+        }
+        const QJsonValue value = entry.at(2);
+        const QList<Thing*> &children = sensor->children;
+
+        switch (sensor->id) {
         case 1101: // power (on/off) for channel 1
             if (thing->hasState("power")) {
-                thing->setStateValue("power", value.toInt() == 1);
+                thing->setStateValue("power", coiotInt(value) == 1);
             } else if (thing->hasState("channel1")) {
-                thing->setStateValue("channel1", value.toInt() == 1);
+                thing->setStateValue("channel1", coiotInt(value) == 1);
             }
             break;
         case 1103: // Roller position
-            foreach (Thing *roller, myThings().filterByParentId(thing->id()).filterByInterface("extendedshutter")) {
-                roller->setStateValue(shellyRollerPercentageStateTypeId, 100 - value.toUInt());
+            foreach (Thing *roller, children) {
+                roller->setStateValue(shellyRollerPercentageStateTypeId, 100 - coiotInt(value));
             }
             break;
         case 1105:
-            thing->setStateValue("valveState", value);
+            thing->setStateValue("valveState", coiotString(value));
             break;
         case 1201: // power (on/off) for channel 2
-            thing->setStateValue("channel2", value.toInt() == 1);
+            thing->setStateValue("channel2", coiotInt(value) == 1);
             break;
-        case 2101: { // input state for channel 1
-            int channel = 1;
-            bool on = value.toInt() == 1;
+        case 2101: // input state for channel 1
+        case 2201: { // input state for channel 2
+            bool on = coiotInt(value) == 1;
             if (thing->thingClassId() == shellyI3ThingClassId) {
-                thing->setStateValue(shellyI3Input1StateTypeId, on);
+                thing->setStateValue(sensor->id == 2101 ? shellyI3Input1StateTypeId : shellyI3Input2StateTypeId, on);
                 break;
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellySwitchThingClassId).filterByParam(shellySwitchThingChannelParamTypeId, channel)) {
+            foreach (Thing *child, children) {
                 if (child->stateValue(shellySwitchPowerStateTypeId).toBool() != on) {
                     child->setStateValue(shellySwitchPowerStateTypeId, on);
                     emit emitEvent(Event(shellySwitchPressedEventTypeId, child->id()));
@@ -894,256 +954,241 @@ void IntegrationPluginShelly::onMulticastMessageReceived(const QHostAddress &sou
             break;
         }
         case 2102: // input event for channel 1
-            inputEvent1String = value;
+            inputEvent1String = coiotString(value);
             break;
         case 2103:
-            inputEvent1Count = value.toInt();
-            break;
-        case 2201: { // input state for channel 2
-            int channel = 2;
-            bool on = value.toInt() == 1;
-            if (thing->thingClassId() == shellyI3ThingClassId) {
-                thing->setStateValue(shellyI3Input2StateTypeId, on);
-                break;
-            }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellySwitchThingClassId).filterByParam(shellySwitchThingChannelParamTypeId, channel)) {
-                if (child->stateValue(shellySwitchPowerStateTypeId).toBool() != on) {
-                    child->setStateValue(shellySwitchPowerStateTypeId, on);
-                    emit emitEvent(Event(shellySwitchPressedEventTypeId, child->id()));
-                }
-            }
+            inputEvent1Count = coiotInt(value);
             break;
-        }
         case 2202: // input event for channel 2
-            inputEvent2String = value;
+            inputEvent2String = coiotString(value);
             break;
         case 2203:
-            inputEvent2Count = value.toInt();
+            inputEvent2Count = coiotInt(value);
             break;
         case 2301: // Input state for channel 3
-            thing->setStateValue(shellyI3Input1StateTypeId, value.toInt() == 1);
+            thing->setStateValue(shellyI3Input1StateTypeId, coiotInt(value) == 1);
             break;
         case 2302: // Input event for channel 3
-            inputEvent3String = value;
+            inputEvent3String = coiotString(value);
             break;
         case 2303:
-            inputEvent3Count = value.toInt();
+            inputEvent3Count = coiotInt(value);
             break;
         case 3101:
-            thing->setStateValue("temperature", value.toDouble());
+            thing->setStateValue("temperature", coiotDouble(value));
             break;
         case 3103: // This is target tempererature for the TRV, but humidity for other sensors
             if (thing->thingClassId() == shellyTrvThingClassId) {
-                thing->setStateValue("targetTemperature", value.toDouble());
+                thing->setStateValue("targetTemperature", coiotDouble(value));
             } else {
-                thing->setStateValue("humidity", value.toDouble());
+                thing->setStateValue("humidity", coiotDouble(value));
             }
             break;
         case 3106:
-            thing->setStateValue("lightIntensity", value.toInt());
+            thing->setStateValue("lightIntensity", coiotInt(value));
             break;
         case 3107:
-            thing->setStateValue("gasLevel", value.toInt());
+            thing->setStateValue("gasLevel", coiotInt(value));
             break;
         case 3111:
-            if (value.toInt() == -1) { // When connected to power surce
+            if (coiotInt(value) == -1) { // When connected to power surce
                 thing->setStateValue("batteryLevel", 100);
             } else {
-                thing->setStateValue("batteryLevel", value.toInt());
+                thing->setStateValue("batteryLevel", coiotInt(value));
             }
             thing->setStateValue("batteryCritical", thing->stateValue("batteryLevel").toUInt() < 10);
             break;
         case 3113:
-            thing->setStateValue("sensorOperation", value);
+            thing->setStateValue("sensorOperation", coiotString(value));
             break;
         case 3114:
-            thing->setStateValue("selfTest", value);
+            thing->setStateValue("selfTest", coiotString(value));
             break;
         case 3121:
-            thing->setStateValue("valvePosition", value.toUInt());
-            thing->setStateValue("heatingOn", value.toUInt() > 0);
+            thing->setStateValue("valvePosition", coiotInt(value));
+            thing->setStateValue("heatingOn", coiotInt(value) > 0);
             break;
         case 3122:
-            thing->setStateValue("boost", value.toUInt() > 0);
+            thing->setStateValue("boost", coiotInt(value) > 0);
             break;
         case 4101: // power meter for channel 1
             if (thing->hasState("currentPower")) {
-                thing->setStateValue("currentPower", value);
+                thing->setStateValue("currentPower", coiotDouble(value));
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyPowerMeterChannelThingClassId).filterByParam(shellyPowerMeterChannelThingChannelParamTypeId, 1)) {
-                child->setStateValue(shellyPowerMeterChannelCurrentPowerStateTypeId, value.toDouble());
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyPowerMeterChannelCurrentPowerStateTypeId, coiotDouble(value));
             }
             break;
         case 4201: // power meter for channel 2
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyPowerMeterChannelThingClassId).filterByParam(shellyPowerMeterChannelThingChannelParamTypeId, 2)) {
-                child->setStateValue(shellyPowerMeterChannelCurrentPowerStateTypeId, value.toDouble());
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyPowerMeterChannelCurrentPowerStateTypeId, coiotDouble(value));
             }
             break;
         case 4102: // roller current power
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyRollerThingClassId).filterByParam(shellyRollerThingChannelParamTypeId, 1)) {
-                child->setStateValue(shellyRollerCurrentPowerStateTypeId, value);
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyRollerCurrentPowerStateTypeId, coiotDouble(value));
             }
             break;
         case 4103: // totalEnergyConsumed channel 1
             if (thing->hasState("totalEnergyConsumed")) {
-                thing->setStateValue("totalEnergyConsumed", value.toDouble() / 60 / 1000);
+                thing->setStateValue("totalEnergyConsumed", coiotDouble(value) / 60 / 1000);
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyPowerMeterChannelThingClassId).filterByParam(shellyPowerMeterChannelThingChannelParamTypeId, 1)) {
-                child->setStateValue(shellyPowerMeterChannelTotalEnergyConsumedStateTypeId, value.toDouble() / 60 / 1000); // Wmin -> kWh
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyPowerMeterChannelTotalEnergyConsumedStateTypeId, coiotDouble(value) / 60 / 1000); // Wmin -> kWh
             }
             break;
         case 4203: // totalEnergyConsumed channel 2
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyPowerMeterChannelThingClassId).filterByParam(shellyPowerMeterChannelThingChannelParamTypeId, 2)) {
-                child->setStateValue(shellyPowerMeterChannelTotalEnergyConsumedStateTypeId, value.toDouble() / 60 / 1000); // Wmin -> kWh
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyPowerMeterChannelTotalEnergyConsumedStateTypeId, coiotDouble(value) / 60 / 1000); // Wmin -> kWh
             }
             break;
         case 4105:
             // 3EM has a state on its own, EM has a child thing per channel
             if (thing->hasState("currentPowerPhaseA")) {
-                thing->setStateValue("currentPowerPhaseA", value.toDouble());
+                thing->setStateValue("currentPowerPhaseA", coiotDouble(value));
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 1)) {
-                child->setStateValue(shellyEmChannelCurrentPowerStateTypeId, value.toDouble());
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelCurrentPowerStateTypeId, coiotDouble(value));
             }
             break;
         case 4205:
             if (thing->hasState("currentPowerPhaseB")) {
-                thing->setStateValue("currentPowerPhaseB", value.toDouble());
+                thing->setStateValue("currentPowerPhaseB", coiotDouble(value));
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 2)) {
-                child->setStateValue(shellyEmChannelCurrentPowerStateTypeId, value.toDouble());
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelCurrentPowerStateTypeId, coiotDouble(value));
             }
             break;
         case 4305:
             if (thing->hasState("currentPowerPhaseC")) {
-                thing->setStateValue("currentPowerPhaseC", value.toDouble());
+                thing->setStateValue("currentPowerPhaseC", coiotDouble(value));
             }
             break;
         case 4106:
             // 3EM has a state on its own, EM has a child thing per channel
             if (thing->hasState("energyConsumedPhaseA")) {
-                thing->setStateValue("energyConsumedPhaseA", value.toDouble() / 1000);
+                thing->setStateValue("energyConsumedPhaseA", coiotDouble(value) / 1000);
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 1)) {
-                child->setStateValue(shellyEmChannelTotalEnergyConsumedStateTypeId, value.toDouble() / 1000);
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelTotalEnergyConsumedStateTypeId, coiotDouble(value) / 1000);
             }
             break;
         case 4206:
             // 3EM has a state on its own, EM has a child thing per channel
             if (thing->hasState("energyConsumedPhaseB")) {
-                thing->setStateValue("energyConsumedPhaseB", value.toDouble() / 1000);
+                thing->setStateValue("energyConsumedPhaseB", coiotDouble(value) / 1000);
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 2)) {
-                child->setStateValue(shellyEmChannelTotalEnergyConsumedStateTypeId, value.toDouble() / 1000);
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelTotalEnergyConsumedStateTypeId, coiotDouble(value) / 1000);
             }
             break;
         case 4306:
             if (thing->hasState("energyConsumedPhaseC")) {
-                thing->setStateValue("energyConsumedPhaseC", value.toDouble() / 1000);
+                thing->setStateValue("energyConsumedPhaseC", coiotDouble(value) / 1000);
             }
             break;
         case 4107:
             if (thing->hasState("energyProducedPhaseA")) {
-                thing->setStateValue("energyProducedPhaseA", value.toDouble() / 1000);
+                thing->setStateValue("energyProducedPhaseA", coiotDouble(value) / 1000);
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 1)) {
-                child->setStateValue(shellyEmChannelTotalEnergyProducedStateTypeId, value.toDouble() / 1000);
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelTotalEnergyProducedStateTypeId, coiotDouble(value) / 1000);
             }
             break;
         case 4207:
             if (thing->hasState("energyProducedPhaseB")) {
-                thing->setStateValue("energyProducedPhaseB", value.toDouble() / 1000);
+                thing->setStateValue("energyProducedPhaseB", coiotDouble(value) / 1000);
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 2)) {
-                child->setStateValue(shellyEmChannelTotalEnergyProducedStateTypeId, value.toDouble() / 1000);
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelTotalEnergyProducedStateTypeId, coiotDouble(value) / 1000);
             }
             break;
         case 4307:
             if (thing->hasState("energyProducedPhaseC")) {
-                thing->setStateValue("energyProducedPhaseC", value.toDouble() / 1000);
+                thing->setStateValue("energyProducedPhaseC", coiotDouble(value) / 1000);
             }
             break;
         case 4108:
             if (thing->hasState("voltagePhaseA")) {
-                thing->setStateValue("voltagePhaseA", value.toDouble());
+                thing->setStateValue("voltagePhaseA", coiotDouble(value));
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 1)) {
-                child->setStateValue(shellyEmChannelVoltagePhaseAStateTypeId, value.toDouble() / 1000);
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelVoltagePhaseAStateTypeId, coiotDouble(value) / 1000);
             }
             break;
         case 4208:
             if (thing->hasState("voltagePhaseB")) {
-                thing->setStateValue("voltagePhaseB", value.toDouble());
+                thing->setStateValue("voltagePhaseB", coiotDouble(value));
             }
-            foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 2)) {
-                child->setStateValue(shellyEmChannelVoltagePhaseAStateTypeId, value.toDouble() / 1000);
+            foreach (Thing *child, children) {
+                child->setStateValue(shellyEmChannelVoltagePhaseAStateTypeId, coiotDouble(value) / 1000);
             }
             break;
         case 4308:
             if (thing->hasState("voltagePhaseC")) {
-                thing->setStateValue("voltagePhaseC", value.toDouble());
+                thing->setStateValue("voltagePhaseC", coiotDouble(value));
             }
             break;
         case 4109:
             if (thing->hasState("currentPhaseA")) {
-                thing->setStateValue("currentPhaseA", value.toDouble());
+                thing->setStateValue("currentPhaseA", coiotDouble(value));
             }
             break;
         case 4209:
             if (thing->hasState("currentPhaseB")) {
-                thing->setStateValue("currentPhaseB", value.toDouble());
+                thing->setStateValue("currentPhaseB", coiotDouble(value));
             }
             break;
         case 4309:
             if (thing->hasState("currentPhaseC")) {
-                thing->setStateValue("currentPhaseC", value.toDouble());
+                thing->setStateValue("currentPhaseC", coiotDouble(value));
             }
             break;
         case 4110:
             if (thing->hasState("powerFactorPhaseA")) {
-                thing->setStateValue("powerFactorPhaseA", value.toDouble());
+                thing->setStateValue("powerFactorPhaseA", coiotDouble(value));
             }
             break;
         case 4210:
             if (thing->hasState("powerFactorPhaseB")) {
-                thing->setStateValue("powerFactorPhaseB", value.toDouble());
+                thing->setStateValue("powerFactorPhaseB", coiotDouble(value));
             }
             break;
         case 4310:
             if (thing->hasState("powerFactorPhaseC")) {
-                thing->setStateValue("powerFactorPhaseC", value.toDouble());
+                thing->setStateValue("powerFactorPhaseC", coiotDouble(value));
             }
             break;
         case 5101: // dimmable lights brightness
         case 5102: // rgb lights gain
-            thing->setStateValue("brightness", value.toInt());
+            thing->setStateValue("brightness", coiotInt(value));
             break;
         case 5105:
-            red = value.toInt();
+            red = coiotInt(value);
             break;
         case 5106:
-            green = value.toInt();
+            green = coiotInt(value);
             break;
         case 5107:
-            blue = value.toInt();
+            blue = coiotInt(value);
             break;
         case 5108:
-            white = value.toInt();
+            white = coiotInt(value);
             break;
         case 6105:
-            thing->setStateValue("fireDetected", value.toInt() == 1);
+            thing->setStateValue("fireDetected", coiotInt(value) == 1);
             break;
         case 6106:
-            thing->setStateValue("waterDetected", value.toInt() == 1);
+            thing->setStateValue("waterDetected", coiotInt(value) == 1);
             break;
         case 6107:
-            thing->setStateValue("isPresent", value.toInt() == 1);
+            thing->setStateValue("isPresent", coiotInt(value) == 1);
             break;
         case 6108:
-            thing->setStateValue("gas", value);
+            thing->setStateValue("gas", coiotString(value));
             break;
         case 6110:
-            thing->setStateValue("vibration", value.toInt() == 1);
+            thing->setStateValue("vibration", coiotInt(value) == 1);
             break;
         }
     }
@@ -1162,7 +1207,7 @@ void IntegrationPluginShelly::onMulticastMessageReceived(const QHostAddress &sou
                              thing->stateValue(shellyEm3EnergyProducedPhaseCStateTypeId).toDouble());
     }
     if (thing->thingClassId() == shellyEmThingClassId) {
-        foreach (Thing *child, myThings().filterByParentId(thing->id()).filterByThingClassId(shellyEmChannelThingClassId)) {
+        foreach (Thing *child, table.emChannels) {
             double power = child->stateValue(shellyEmChannelCurrentPowerStateTypeId).toDouble();
             double voltage = child->stateValue(shellyEmChannelVoltagePhaseAStateTypeId).toDouble();
             if (qFuzzyCompare(voltage, 0) == false) {
@@ -1183,7 +1228,7 @@ void IntegrationPluginShelly::onMulticastMessageReceived(const QHostAddress &sou
     handleInputEvent(thing, "3", inputEvent3String, inputEvent3Count);
 
     if (thing->thingClassId() == shelly2ThingClassId || thing->thingClassId() == shelly25ThingClassId) {
-        foreach (Thing *roller, myThings().filterByInterface("extendedshutter").filterByParentId(thing->id())) {
+        foreach (Thing *roller, table.rollers) {
             bool moving = thing->stateValue("channel1").toBool() || thing->stateValue("channel2").toBool();
             roller->setStateValue(shellyRollerMovingStateTypeId, moving);
         }
@@ -1198,17 +1243,26 @@ void IntegrationPluginShelly::onMulticastMessageReceived(const QHostAddress &sou
 
 void IntegrationPluginShelly::updateStatus()
 {
+    bool gen2PushUpdates = configValue(shellyPluginGen2PushUpdatesParamTypeId).toBool();
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
     foreach (Thing *thing, myThings().filterByParentId(ThingId())) {
-        if (thing->paramValue("id").toString().contains("Plus")) {
+        // Gen1 devices are polled by m_pollScheduler
+        if (!thing->paramValue("id").toString().contains("Plus")) {
+            continue;
+        }
+
+        if (!gen2PushUpdates) {
+            fetchDeviceInfoGen2(thing);
             fetchStatusGen2(thing);
-        } else {
-            //Skipping sleepy devices, as they won't reply to cyclic requests.
-            if (thing->thingClassId() == shellyFloodThingClassId
-                    || thing->thingClassId() == shellyTrvThingClassId) {
-                continue;
-            }
+            continue;
+        }
 
-            fetchStatusGen1(thing);
+        // Notifications keep the cache up to date. Only catch up if we lost track of the device.
+        const Gen2StatusCache cache = m_gen2StatusCache.value(thing);
+        if (!cache.synced || now - cache.lastUpdate > gen2StatusMaxSilence) {
+            qCDebug(dcShelly()) << "Status cache for" << thing->name() << "is out of sync. Fetching full status.";
+            fetchStatusGen2(thing);
         }
     }
 }
@@ -1224,6 +1278,7 @@ void IntegrationPluginShelly::fetchStatusGen1(Thing *thing)
     QNetworkReply *reply = hardwareManager()->networkManager()->get(QNetworkRequest(url));
     connect(reply, &QNetworkReply::finished, &QNetworkReply::deleteLater);
     connect(reply, &QNetworkReply::finished, thing, [this, thing, reply](){
+        m_pollScheduler->pollFinished(thing, reply->error() == QNetworkReply::NoError);
         if (reply->error() != QNetworkReply::NoError) {
             qCWarning(dcShelly()) << "Unable to update status for" << thing->name() << reply->error() << reply->errorString();
             if (reply->error() == QNetworkReply::HostNotFoundError && !thing->hasState("batteryLevel")) {
@@ -1273,25 +1328,114 @@ void IntegrationPluginShelly::fetchStatusGen2(Thing *thing)
             qCWarning(dcShelly()) << "Error updating status from shelly:" << status;
             return;
         }
-        int signalStrength = qMin(100, qMax(0, (response.value("wifi").toMap().value("rssi").toInt() + 100) * 2));
-        thing->setStateValue("connected", true);
-        thing->setStateValue("signalStrength", signalStrength);
-        foreach (Thing *child, myThings().filterByParentId(thing->id())) {
-            child->setStateValue("connected", true);
-            child->setStateValue("signalStrength", signalStrength);
-        }
+        updateGen2Status(thing, response, true);
     });
+}
 
+void IntegrationPluginShelly::fetchDeviceInfoGen2(Thing *thing)
+{
+    // The device info is static, so it's only fetched once per connection when using notifications
+    if (m_gen2StatusCache.value(thing).deviceInfoFetched && configValue(shellyPluginGen2PushUpdatesParamTypeId).toBool()) {
+        return;
+    }
+
+    ShellyJsonRpcClient *client = m_rpcClients.value(thing);
     ShellyRpcReply *infoReply = client->sendRequest("Shelly.GetDeviceInfo");
-    connect(infoReply, &ShellyRpcReply::finished, thing, [thing](ShellyRpcReply::Status status, const QVariantMap &response){
+    connect(infoReply, &ShellyRpcReply::finished, thing, [this, thing](ShellyRpcReply::Status status, const QVariantMap &response){
         if (status != ShellyRpcReply::StatusSuccess) {
             qCWarning(dcShelly()) << "Error updating device info from shelly:" << status;
             return;
         }
+        m_gen2StatusCache[thing].deviceInfoFetched = true;
         thing->setStateValue("currentVersion", response.value("ver").toString());
     });
 }
 
+void IntegrationPluginShelly::updateGen2Status(Thing *thing, const QVariantMap &status, bool fullStatus)
+{
+    Gen2StatusCache &cache = m_gen2StatusCache[thing];
+
+    // Notifications carry a timestamp. If one arrives older than what we've seen already, we might have missed something.
+    double timestamp = status.value("ts").toDouble();
+    if (!fullStatus && timestamp > 0 && timestamp < cache.lastTimestamp) {
+        qCDebug(dcShelly()) << "Out of order status notification from" << thing->name() << ". Status will be fetched again.";
+        cache.synced = false;
+    }
+    if (timestamp > cache.lastTimestamp) {
+        cache.lastTimestamp = timestamp;
+    }
+
+    QVariantMap components;
+    if (fullStatus) {
+        cache.status = status;
+        cache.synced = true;
+        components = status;
+    } else {
+        // Notifications only contain the changed fields of a component, merge them into what we have
+        foreach (const QString &key, status.keys()) {
+            if (key == "ts") {
+                continue;
+            }
+            QVariantMap component = cache.status.value(key).toMap();
+            QVariantMap changes = status.value(key).toMap();
+            for (QVariantMap::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++it) {
+                component.insert(it.key(), it.value());
+            }
+            cache.status.insert(key, component);
+            components.insert(key, component);
+        }
+    }
+    cache.version++;
+    cache.lastUpdate = QDateTime::currentMSecsSinceEpoch();
+
+    qCDebug(dcShelly()) << "Status of" << thing->name() << "updated to version" << cache.version << (fullStatus ? "(full)" : "");
+    applyGen2Status(thing, components, !fullStatus);
+}
+
+void IntegrationPluginShelly::applyGen2Status(Thing *thing, const QVariantMap &components, bool live)
+{
+    Things children = myThings().filterByParentId(thing->id());
+
+    if (components.contains("switch:0")) {
+        QVariantMap switch0 = components.value("switch:0").toMap();
+        if (switch0.contains("apower") && thing->hasState("currentPower")) {
+            thing->setStateValue("currentPower", switch0.value("apower").toDouble());
+        }
+        if (switch0.contains("aenergy") && thing->hasState("totalEnergyConsumed")) {
+            thing->setStateValue("totalEnergyConsumed", switch0.value("aenergy").toMap().value("total").toDouble() / 1000);
+        }
+        if (switch0.contains("output") && thing->hasState("power")) {
+            thing->setStateValue("power", switch0.value("output").toBool());
+        }
+    }
+    if (components.contains("input:0")) {
+        QVariantMap input0 = components.value("input:0").toMap();
+        Thing *t = children.findByParams({Param(shellySwitchThingChannelParamTypeId, 1)});
+        if (t) {
+            t->setStateValue("power", input0.value("state").toBool());
+            // Only live notifications represent an actual button press
+            if (live) {
+                t->emitEvent("pressed");
+            }
+        }
+    }
+    if (components.contains("wifi")) {
+        QVariantMap wifi = components.value("wifi").toMap();
+        if (wifi.contains("rssi")) {
+            int signalStrength = qMin(100, qMax(0, (wifi.value("rssi").toInt() + 100) * 2));
+            thing->setStateValue("signalStrength", signalStrength);
+            foreach (Thing *child, children) {
+                child->setStateValue("signalStrength", signalStrength);
+            }
+        }
+    }
+
+    thing->setStateValue("connected", true);
+    foreach (Thing *child, children) {
+        child->setStateValue("connected", true);
+    }
+}
+
 void IntegrationPluginShelly::setupGen1(ThingSetupInfo *info)
 {
     Thing *thing = info->thing();
@@ -1449,6 +1593,19 @@ void IntegrationPluginShelly::setupGen1(ThingSetupInfo *info)
         info->finish(Thing::ThingErrorNoError);
         info->thing()->setStateValue("connected", true);
 
+        // CoIoT messages identify the device by the part of the id after the last dash
+        QString shellyId = info->thing()->paramValue("id").toString();
+        m_coiotThings.insert(shellyId.mid(shellyId.lastIndexOf('-') + 1), info->thing());
+        m_unknownCoiotIds.clear();
+        invalidateCoiotDispatchTable(info->thing());
+        fetchCoiotDescription(info->thing(), address);
+
+        // Skipping sleepy devices, as they won't reply to cyclic requests.
+        if (info->thing()->thingClassId() != shellyFloodThingClassId
+                && info->thing()->thingClassId() != shellyTrvThingClassId) {
+            m_pollScheduler->addThing(info->thing());
+        }
+
         emit autoThingsAppeared(autoChilds);
 
         // Make sure authentication is enalbed if the user wants it
@@ -1477,20 +1634,6 @@ void IntegrationPluginShelly::setupGen1(ThingSetupInfo *info)
         }
     });
 
-    // For testing and debugging, introspect the coap API. Allows introspecting the coap api on the device
-//    url.clear();
-//    url.setScheme("coap");
-//    url.setHost(address.toString());
-//    url.setPath("/cit/d");
-
-//    CoapRequest coapRequest(url);
-//    CoapReply *coapReply = m_coap->get(coapRequest);
-//    qCDebug(dcShelly) << "Coap request" << url;
-//    connect(coapReply, &CoapReply::finished, thing, [=](){
-//        qCDebug(dcShelly) << "Coap reply" << coapReply->error() << qUtf8Printable(QJsonDocument::fromJson(coapReply->payload()).toJson());
-//    });
-
-
     // Handle thing settings of gateway devices
     if (info->thing()->thingClassId() == shellyPlugThingClassId ||
             info->thing()->thingClassId() == shellyButton1ThingClassId ||
@@ -1607,6 +1750,17 @@ void IntegrationPluginShelly::setupGen2(ThingSetupInfo *info)
             child->setStateValue("connected", state == QAbstractSocket::ConnectedState);
         }
 
+        // Notifications may have been missed while disconnected. Catch up with the device once the connection is back.
+        if (state == QAbstractSocket::ConnectedState || state == QAbstractSocket::UnconnectedState) {
+            Gen2StatusCache &cache = m_gen2StatusCache[thing];
+            cache.synced = false;
+            cache.deviceInfoFetched = false;
+        }
+        if (state == QAbstractSocket::ConnectedState && thing->setupComplete()) {
+            fetchDeviceInfoGen2(thing);
+            fetchStatusGen2(thing);
+        }
+
         if (state == QAbstractSocket::UnconnectedState) {
             QTimer::singleShot(1000, thing, [this, client, thing](){
                 client->open(getIP(thing), "admin", thing->paramValue("password").toString(), thing->paramValue("id").toString());
@@ -1615,26 +1769,11 @@ void IntegrationPluginShelly::setupGen2(ThingSetupInfo *info)
     });
     connect(client, &ShellyJsonRpcClient::notificationReceived, thing, [thing, this](const QVariantMap &notification){
         qCDebug(dcShelly) << "notification received" << qUtf8Printable(QJsonDocument::fromVariant(notification).toJson());
-        if (notification.contains("switch:0")) {
-            QVariantMap switch0 = notification.value("switch:0").toMap();
-            if (switch0.contains("apower") && thing->hasState("currentPower")) {
-                thing->setStateValue("currentPower", switch0.value("apower").toDouble());
-            }
-            if (switch0.contains("aenergy") && thing->hasState("totalEnergyConsumed")) {
-                thing->setStateValue("totalEnergyConsumed", notification.value("switch:0").toMap().value("aenergy").toMap().value("total").toDouble() / 1000);
-            }
-            if (switch0.contains("output") && thing->hasState("power")) {
-                thing->setStateValue("power", switch0.value("output").toBool());
-            }
-        }
-        if (notification.contains("input:0")) {
-            QVariantMap input0 = notification.value("input:0").toMap();
-            Thing *t = myThings().filterByParentId(thing->id()).findByParams({Param(shellySwitchThingChannelParamTypeId, 1)});
-            if (t) {
-                t->setStateValue("power", input0.value("state").toBool());
-                t->emitEvent("pressed");
-            }
-        }
+        updateGen2Status(thing, notification, false);
+    });
+    connect(client, &ShellyJsonRpcClient::fullStatusReceived, thing, [thing, this](const QVariantMap &status){
+        qCDebug(dcShelly) << "full status received for" << thing->name();
+        updateGen2Status(thing, status, true);
     });
 }
 
@@ -1722,6 +1861,9 @@ void IntegrationPluginShelly::setupShellyChild(ThingSetupInfo *info)
         }
     });
 
+    // The parents CoIoT dispatch table needs to pick up the new child
+    invalidateCoiotDispatchTable(parent);
+
     info->finish(Thing::ThingErrorNoError);
 }
 
@@ -1792,6 +1934,139 @@ void IntegrationPluginShelly::handleInputEvent(Thing *thing, const QString &butt
     }
 }
 
+Thing *IntegrationPluginShelly::findCoiotThing(const QString &coiotId)
+{
+    Thing *thing = m_coiotThings.value(coiotId);
+    if (thing || m_unknownCoiotIds.contains(coiotId)) {
+        return thing;
+    }
+
+    // Not indexed (yet). Fall back to scanning once and remember the result, also if nothing is found,
+    // as there may be lots of shellies in the network which are not set up in nymea.
+    foreach (Thing *t, myThings().filterByParentId(ThingId())) {
+        if (t->setupComplete() && t->paramValue("id").toString().endsWith(coiotId)) {
+            m_coiotThings.insert(coiotId, t);
+            return t;
+        }
+    }
+    m_unknownCoiotIds.insert(coiotId);
+    return nullptr;
+}
+
+void IntegrationPluginShelly::fetchCoiotDescription(Thing *thing, const QHostAddress &address)
+{
+    QUrl url;
+    url.setScheme("coap");
+    url.setHost(address.toString());
+    url.setPath("/cit/d");
+
+    CoapReply *reply = m_coap->get(CoapRequest(url));
+    if (reply->isFinished()) {
+        qCDebug(dcShelly()) << "Unable to fetch CoIoT description for" << thing->name() << reply->errorString();
+        reply->deleteLater();
+        return;
+    }
+
+    connect(reply, &CoapReply::finished, reply, &CoapReply::deleteLater);
+    connect(reply, &CoapReply::finished, thing, [this, thing, reply](){
+        if (reply->error() != CoapReply::NoError) {
+            // Sleepy devices won't answer. All known sensors will be dispatched for those.
+            qCDebug(dcShelly()) << "Unable to fetch CoIoT description for" << thing->name() << reply->errorString();
+            return;
+        }
+
+        QJsonParseError error;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(reply->payload(), &error);
+        if (error.error != QJsonParseError::NoError) {
+            qCWarning(dcShelly()) << "JSON parse error in CoIoT description:" << error.errorString();
+            return;
+        }
+
+        QSet<int> sensorIds;
+        foreach (const QJsonValue &sensor, jsonDoc.object().value("sen").toArray()) {
+            int id = sensor.toObject().value("I").toInt();
+            if (coiotSensorIds.contains(id)) {
+                sensorIds.insert(id);
+            }
+        }
+        if (sensorIds.isEmpty()) {
+            qCDebug(dcShelly()) << "CoIoT description for" << thing->name() << "does not contain any known sensors.";
+            return;
+        }
+
+        qCDebug(dcShelly()) << "CoIoT description for" << thing->name() << "announces" << sensorIds.count() << "known sensors";
+        m_coiotDescriptions.insert(thing, sensorIds);
+        invalidateCoiotDispatchTable(thing);
+    });
+}
+
+IntegrationPluginShelly::CoiotDispatchTable IntegrationPluginShelly::coiotDispatchTable(Thing *thing)
+{
+    QHash<Thing*, CoiotDispatchTable>::const_iterator it = m_coiotDispatchTables.constFind(thing);
+    if (it != m_coiotDispatchTables.constEnd()) {
+        return it.value();
+    }
+
+    CoiotDispatchTable table;
+    Things children = myThings().filterByParentId(thing->id());
+    table.children = children;
+    table.rollers = children.filterByInterface("extendedshutter");
+    table.emChannels = children.filterByThingClassId(shellyEmChannelThingClassId);
+
+    // If the device announced its sensors, only those are dispatched. Otherwise all known ones are.
+    QSet<int> announcedIds = m_coiotDescriptions.value(thing);
+    foreach (int id, coiotSensorIds) {
+        if (!announcedIds.isEmpty() && !announcedIds.contains(id)) {
+            continue;
+        }
+
+        CoiotSensor sensor;
+        sensor.id = id;
+        switch (id) {
+        case 1103:
+            sensor.children = table.rollers;
+            break;
+        case 2101:
+        case 2201:
+            sensor.children = children.filterByThingClassId(shellySwitchThingClassId).filterByParam(shellySwitchThingChannelParamTypeId, id == 2101 ? 1 : 2);
+            break;
+        case 4101:
+        case 4103:
+            sensor.children = children.filterByThingClassId(shellyPowerMeterChannelThingClassId).filterByParam(shellyPowerMeterChannelThingChannelParamTypeId, 1);
+            break;
+        case 4201:
+        case 4203:
+            sensor.children = children.filterByThingClassId(shellyPowerMeterChannelThingClassId).filterByParam(shellyPowerMeterChannelThingChannelParamTypeId, 2);
+            break;
+        case 4102:
+            sensor.children = children.filterByThingClassId(shellyRollerThingClassId).filterByParam(shellyRollerThingChannelParamTypeId, 1);
+            break;
+        case 4105:
+        case 4106:
+        case 4107:
+        case 4108:
+            sensor.children = children.filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 1);
+            break;
+        case 4205:
+        case 4206:
+        case 4207:
+        case 4208:
+            sensor.children = children.filterByThingClassId(shellyEmChannelThingClassId).filterByParam(shellyEmChannelThingChannelParamTypeId, 2);
+            break;
+        }
+        table.sensors.insert(id, sensor);
+    }
+
+    qCDebug(dcShelly()) << "Created CoIoT dispatch table for" << thing->name() << "with" << table.sensors.count() << "sensors";
+    m_coiotDispatchTables.insert(thing, table);
+    return table;
+}
+
+void IntegrationPluginShelly::invalidateCoiotDispatchTable(Thing *thing)
+{
+    m_coiotDispatchTables.remove(thing);
+}
+
 QVariantMap IntegrationPluginShelly::createRpcRequest(const QString &method)
 {
     QVariantMap map;
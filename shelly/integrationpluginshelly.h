@@ -42,6 +42,7 @@ class ZeroConfServiceBrowser;
 class PluginTimer;
 
 class ShellyJsonRpcClient;
+class ShellyPollScheduler;
 
 class IntegrationPluginShelly: public IntegrationPlugin
 {
@@ -69,6 +70,7 @@ private slots:
     void updateStatus();
     void fetchStatusGen1(Thing *thing);
     void fetchStatusGen2(Thing *thing);
+    void fetchDeviceInfoGen2(Thing *thing);
 
 private:
     void setupGen1(ThingSetupInfo *info);
@@ -77,18 +79,56 @@ private:
 
     QHostAddress getIP(Thing *thing) const;
 
+    void updateGen2Status(Thing *thing, const QVariantMap &status, bool fullStatus);
+    void applyGen2Status(Thing *thing, const QVariantMap &components, bool live);
+
     void handleInputEvent(Thing *thing, const QString &buttonName, const QString &inputEventString, int inputEventCount);
 
     QVariantMap createRpcRequest(const QString &method);
 
+    // CoIoT (Gen1 multicast status) handling
+    struct CoiotSensor {
+        int id = 0;
+        QList<Thing*> children; // Child things this sensor value is applied to
+    };
+    struct CoiotDispatchTable {
+        QHash<int, CoiotSensor> sensors;
+        QList<Thing*> children;
+        QList<Thing*> rollers;
+        QList<Thing*> emChannels;
+    };
+
+    // Gen2 status cache, kept up to date by NotifyStatus/NotifyFullStatus notifications
+    struct Gen2StatusCache {
+        QVariantMap status;
+        quint64 version = 0;
+        double lastTimestamp = 0;
+        qint64 lastUpdate = 0;
+        bool synced = false;
+        bool deviceInfoFetched = false;
+    };
+
+    Thing *findCoiotThing(const QString &coiotId);
+    void fetchCoiotDescription(Thing *thing, const QHostAddress &address);
+    // Returned by value, dispatching may re-enter the plugin and change m_coiotDispatchTables
+    CoiotDispatchTable coiotDispatchTable(Thing *thing);
+    void invalidateCoiotDispatchTable(Thing *thing);
+
 private:
     ZeroConfServiceBrowser *m_zeroconfBrowser = nullptr;
     PluginTimer *m_statusUpdateTimer = nullptr;
     PluginTimer *m_reconfigureTimer = nullptr;
+    ShellyPollScheduler *m_pollScheduler = nullptr;
 
     Coap *m_coap = nullptr;
 
     QHash<Thing*, ShellyJsonRpcClient*> m_rpcClients;
+    QHash<Thing*, Gen2StatusCache> m_gen2StatusCache;
+
+    QHash<QString, Thing*> m_coiotThings;
+    QSet<QString> m_unknownCoiotIds;
+    QHash<Thing*, QSet<int>> m_coiotDescriptions;
+    QHash<Thing*, CoiotDispatchTable> m_coiotDispatchTables;
 };
 
 #endif // INTEGRATIONPLUGINSHELLY_H
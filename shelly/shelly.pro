@@ -6,8 +6,10 @@ PKGCONFIG += nymea-mqtt
 
 SOURCES += \
     integrationpluginshelly.cpp \
-    shellyjsonrpcclient.cpp
+    shellyjsonrpcclient.cpp \
+    shellypollscheduler.cpp
 
 HEADERS += \
     integrationpluginshelly.h \
-    shellyjsonrpcclient.h
+    shellyjsonrpcclient.h \
+    shellypollscheduler.h
@@ -1,26 +1,35 @@
 #include "shellyjsonrpcclient.h"
 
 #include <QJsonDocument>
-#include <QTimer>
+#include <QJsonObject>
+#include <QDateTime>
 #include <QLoggingCategory>
 Q_DECLARE_LOGGING_CATEGORY(dcShelly)
 
-ShellyRpcReply::ShellyRpcReply(const QVariantMap &requestBody, QObject *parent):
+static const int requestTimeout = 10000;
+
+ShellyRpcReply::ShellyRpcReply(int id, const QString &method, const QVariantMap &params, QObject *parent):
     QObject(parent),
-    m_requestBody(requestBody)
+    m_id(id),
+    m_method(method),
+    m_params(params)
 {
-    QTimer::singleShot(10000, this, [this]{finished(StatusTimeout, QVariantMap());});
     connect(this, &ShellyRpcReply::finished, this, &ShellyRpcReply::deleteLater);
 }
 
 int ShellyRpcReply::id() const
 {
-    return m_requestBody.value("id").toInt();
+    return m_id;
 }
 
-QVariantMap ShellyRpcReply::requestBody() const
+QString ShellyRpcReply::method() const
 {
-    return m_requestBody;
+    return m_method;
+}
+
+QVariantMap ShellyRpcReply::params() const
+{
+    return m_params;
 }
 
 ShellyJsonRpcClient::ShellyJsonRpcClient(QObject *parent)
@@ -30,6 +39,12 @@ ShellyJsonRpcClient::ShellyJsonRpcClient(QObject *parent)
     connect(m_socket, &QWebSocket::stateChanged, this, &ShellyJsonRpcClient::stateChanged);
 
     connect(m_socket, &QWebSocket::textMessageReceived, this, &ShellyJsonRpcClient::onTextMessageReceived);
+
+    m_timeoutTimer.setSingleShot(true);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &ShellyJsonRpcClient::onTimeout);
+
+    // Reserving makes the buffer keep its capacity when being cleared for the next request
+    m_sendBuffer.reserve(512);
 }
 
 void ShellyJsonRpcClient::open(const QHostAddress &address, const QString &user, const QString &password, const QString &shellyId)
@@ -47,30 +62,89 @@ void ShellyJsonRpcClient::open(const QHostAddress &address, const QString &user,
 
 ShellyRpcReply *ShellyJsonRpcClient::sendRequest(const QString &method, const QVariantMap &params)
 {
-    int id = m_currentId++;
+    ShellyRpcReply *reply = new ShellyRpcReply(m_currentId++, method, params, this);
+    m_pendingReplies.insert(reply->id(), reply);
+    m_queuedReplies.enqueue(reply);
+
+    m_deadlines.enqueue(qMakePair(QDateTime::currentMSecsSinceEpoch() + requestTimeout, reply->id()));
+    if (!m_timeoutTimer.isActive()) {
+        m_timeoutTimer.start(requestTimeout);
+    }
+
+    sendQueuedRequests();
+    return reply;
+}
+
+int ShellyJsonRpcClient::maxInFlight() const
+{
+    return m_maxInFlight;
+}
+
+void ShellyJsonRpcClient::setMaxInFlight(int maxInFlight)
+{
+    m_maxInFlight = qMax(1, maxInFlight);
+    sendQueuedRequests();
+}
+
+int ShellyJsonRpcClient::pendingRequests() const
+{
+    return m_pendingReplies.count();
+}
 
-    QVariantMap data;
-    data.insert("id", id);
-    data.insert("src", "nymea");
-    data.insert("method", method);
-    if (!params.isEmpty()) {
-        data.insert("params", params);
+void ShellyJsonRpcClient::sendQueuedRequests()
+{
+    while (!m_queuedReplies.isEmpty() && m_pendingReplies.count() - m_queuedReplies.count() < m_maxInFlight) {
+        transmit(m_queuedReplies.dequeue());
     }
+}
 
+void ShellyJsonRpcClient::transmit(ShellyRpcReply *reply)
+{
+    // Only params and auth need a JSON serializer, the envelope is written directly into the buffer.
+    // Method names are plain identifiers and don't need escaping.
+    m_sendBuffer.resize(0);
+    m_sendBuffer.append("{\"id\":");
+    m_sendBuffer.append(QByteArray::number(reply->id()));
+    m_sendBuffer.append(",\"src\":\"nymea\",\"method\":\"");
+    m_sendBuffer.append(reply->method().toUtf8());
+    m_sendBuffer.append('"');
+    if (!reply->params().isEmpty()) {
+        m_sendBuffer.append(",\"params\":");
+        m_sendBuffer.append(QJsonDocument(QJsonObject::fromVariantMap(reply->params())).toJson(QJsonDocument::Compact));
+    }
     if (!m_password.isEmpty() && m_nonce != 0) {
-        data.insert("auth", createAuthMap());
+        m_sendBuffer.append(",\"auth\":");
+        m_sendBuffer.append(QJsonDocument(QJsonObject::fromVariantMap(createAuthMap())).toJson(QJsonDocument::Compact));
     }
+    m_sendBuffer.append('}');
 
-    ShellyRpcReply *reply = new ShellyRpcReply(data, this);
-    connect(reply, &ShellyRpcReply::finished, this, [this, id]{
-        m_pendingReplies.remove(id);
-    });
-    m_pendingReplies.insert(id, reply);
+    qCDebug(dcShelly) << "Sending request" << m_sendBuffer;
+    m_socket->sendTextMessage(QString::fromUtf8(m_sendBuffer));
+}
 
-    qCDebug(dcShelly) << "Sending request" << qUtf8Printable(QJsonDocument::fromVariant(data).toJson());
-    m_socket->sendTextMessage(QJsonDocument::fromVariant(data).toJson(QJsonDocument::Compact));
+void ShellyJsonRpcClient::finishReply(ShellyRpcReply *reply, ShellyRpcReply::Status status, const QVariantMap &response)
+{
+    m_pendingReplies.remove(reply->id());
+    m_queuedReplies.removeOne(reply);
+    emit reply->finished(status, response);
 
-    return reply;
+    sendQueuedRequests();
+}
+
+void ShellyJsonRpcClient::onTimeout()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (!m_deadlines.isEmpty() && m_deadlines.head().first <= now) {
+        ShellyRpcReply *reply = m_pendingReplies.value(m_deadlines.dequeue().second);
+        if (reply) {
+            qCDebug(dcShelly()) << "Request" << reply->id() << reply->method() << "timed out";
+            finishReply(reply, ShellyRpcReply::StatusTimeout, QVariantMap());
+        }
+    }
+
+    if (!m_deadlines.isEmpty()) {
+        m_timeoutTimer.start(qMax<qint64>(0, m_deadlines.head().first - now));
+    }
 }
 
 void ShellyJsonRpcClient::onTextMessageReceived(const QString &message)
@@ -85,10 +159,15 @@ void ShellyJsonRpcClient::onTextMessageReceived(const QString &message)
         return;
     }
 
-    if (data.value("method").toString() == "NotifyStatus") {
+    QString method = data.value("method").toString();
+    if (method == "NotifyStatus") {
         emit notificationReceived(data.value("params").toMap());
         return;
     }
+    if (method == "NotifyFullStatus") {
+        emit fullStatusReceived(data.value("params").toMap());
+        return;
+    }
 
     int id = data.value("id").toInt();
     ShellyRpcReply *reply = m_pendingReplies.value(id);
@@ -112,15 +191,13 @@ void ShellyJsonRpcClient::onTextMessageReceived(const QString &message)
                 QVariantMap authInfo = QJsonDocument::fromJson(errorMap.value("message").toByteArray(), &error).toVariant().toMap();
                 if (error.error != QJsonParseError::NoError) {
                     qCWarning(dcShelly()) << "Unable to parse auth error message. Authentication will not work.";
-                    emit reply->finished(status, QVariantMap());
+                    finishReply(reply, status, QVariantMap());
                     return;
                 }
                 m_nonce = authInfo.value("nonce").toInt();
                 m_nc = authInfo.value("nc").toInt();
-                QVariantMap newBody = reply->requestBody();
-                newBody.insert("auth", createAuthMap());
-                qCDebug(dcShelly) << "Sending request with auth" << qUtf8Printable(QJsonDocument::fromVariant(newBody).toJson());
-                m_socket->sendTextMessage(QJsonDocument::fromVariant(newBody).toJson(QJsonDocument::Compact));
+                // Resend with the same id, the request keeps its slot in the in-flight window
+                transmit(reply);
                 return;
             } else {
                 qCWarning(dcShelly()) << "Username and password seem to be wrong.";
@@ -128,7 +205,7 @@ void ShellyJsonRpcClient::onTextMessageReceived(const QString &message)
         }
     }
 
-    emit reply->finished(status, data.value("result").toMap());
+    finishReply(reply, status, data.value("result").toMap());
 }
 
 QVariantMap ShellyJsonRpcClient::createAuthMap() const
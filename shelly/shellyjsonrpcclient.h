@@ -3,6 +3,8 @@
 
 #include <QObject>
 #include <QWebSocket>
+#include <QQueue>
+#include <QTimer>
 
 class ShellyRpcReply: public QObject
 {
@@ -27,17 +29,19 @@ public:
     };
     Q_ENUM(Status)
 
-    explicit ShellyRpcReply(const QVariantMap &requestBody, QObject *parent = nullptr);
+    explicit ShellyRpcReply(int id, const QString &method, const QVariantMap &params, QObject *parent = nullptr);
 
     int id() const;
     QString method() const;
-    QVariantMap requestBody() const;
+    QVariantMap params() const;
 
 signals:
     void finished(Status status, const QVariantMap &response);
 
 private:
-    QVariantMap m_requestBody;
+    int m_id = 0;
+    QString m_method;
+    QVariantMap m_params;
 };
 
 class ShellyJsonRpcClient : public QObject
@@ -48,20 +52,43 @@ public:
 
     void open(const QHostAddress &address, const QString &user, const QString &password, const QString &shellyId);
 
+    // Requests are pipelined, up to maxInFlight() requests are sent without waiting for their replies.
+    // Any further requests are queued until a slot becomes available.
     ShellyRpcReply* sendRequest(const QString &method, const QVariantMap &params = QVariantMap());
 
+    int maxInFlight() const;
+    void setMaxInFlight(int maxInFlight);
+
+    int pendingRequests() const;
+
 signals:
     void stateChanged(QAbstractSocket::SocketState state);
     void notificationReceived(const QVariantMap &notification);
+    void fullStatusReceived(const QVariantMap &status);
 
 private slots:
     void onTextMessageReceived(const QString &message);
+    void onTimeout();
 
 private:
     QVariantMap createAuthMap() const;
 
+    void sendQueuedRequests();
+    void transmit(ShellyRpcReply *reply);
+    void finishReply(ShellyRpcReply *reply, ShellyRpcReply::Status status, const QVariantMap &response);
+
     QWebSocket *m_socket = nullptr;
+
+    // All unfinished replies, including the queued ones
     QHash<int, ShellyRpcReply*> m_pendingReplies;
+    QQueue<ShellyRpcReply*> m_queuedReplies;
+    int m_maxInFlight = 5;
+
+    // All requests share the same timeout, so deadlines are ordered by request id
+    QQueue<QPair<qint64, int>> m_deadlines;
+    QTimer m_timeoutTimer;
+
+    QByteArray m_sendBuffer;
 
     int m_currentId = 1;
 
@@ -0,0 +1,202 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "shellypollscheduler.h"
+#include "extern-plugininfo.h"
+
+#include <QDateTime>
+#include <QRandomGenerator>
+
+// Devices which pushed their state recently are not polled, but at least every maxSkips + 1 intervals
+// as some information (e.g. signal strength and firmware info) is only available by polling.
+static const int maxSkips = 9;
+
+// Unreachable devices are polled every 2^failures intervals, up to this exponent
+static const int maxBackoff = 4;
+
+ShellyPollScheduler::ShellyPollScheduler(int interval, QObject *parent):
+    QObject(parent),
+    m_interval(interval * 1000)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &ShellyPollScheduler::onTimeout);
+}
+
+void ShellyPollScheduler::addThing(Thing *thing)
+{
+    if (m_devices.contains(thing)) {
+        return;
+    }
+    m_devices.insert(thing, Device());
+    updatePhases();
+}
+
+void ShellyPollScheduler::removeThing(Thing *thing)
+{
+    if (!m_devices.contains(thing)) {
+        return;
+    }
+    m_schedule.remove(m_devices.value(thing).dueTime, thing);
+    m_devices.remove(thing);
+    updatePhases();
+}
+
+void ShellyPollScheduler::pollFinished(Thing *thing, bool success)
+{
+    if (!m_devices.contains(thing)) {
+        return;
+    }
+
+    Device &device = m_devices[thing];
+    if (success) {
+        device.failures = 0;
+        return;
+    }
+
+    device.failures++;
+    m_pollsFailed++;
+    int cycles = (1 << qMin(device.failures, maxBackoff)) - 1;
+    qCDebug(dcShelly()) << "Polling" << thing->name() << "failed" << device.failures << "times in a row. Skipping" << cycles << "poll cycles.";
+    schedule(thing, cycles);
+    armTimer();
+}
+
+void ShellyPollScheduler::pushReceived(Thing *thing)
+{
+    if (!m_devices.contains(thing)) {
+        return;
+    }
+
+    Device &device = m_devices[thing];
+    device.lastPush = QDateTime::currentMSecsSinceEpoch();
+
+    // The device is obviously reachable again, no need to wait for the backoff to expire
+    if (device.failures > 0) {
+        device.failures = 0;
+        schedule(thing, 0);
+        armTimer();
+    }
+}
+
+quint64 ShellyPollScheduler::pollsSent() const
+{
+    return m_pollsSent;
+}
+
+quint64 ShellyPollScheduler::pollsSkipped() const
+{
+    return m_pollsSkipped;
+}
+
+quint64 ShellyPollScheduler::pollsFailed() const
+{
+    return m_pollsFailed;
+}
+
+void ShellyPollScheduler::onTimeout()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    while (!m_schedule.isEmpty() && m_schedule.firstKey() <= now) {
+        QMultiMap<qint64, Thing*>::iterator it = m_schedule.begin();
+        Thing *thing = it.value();
+        m_schedule.erase(it);
+
+        Device &device = m_devices[thing];
+        device.dueTime = 0;
+
+        if (device.lastPush > 0 && now - device.lastPush < m_interval && device.skips < maxSkips) {
+            device.skips++;
+            m_pollsSkipped++;
+            schedule(thing, 0);
+            continue;
+        }
+
+        device.skips = 0;
+        m_pollsSent++;
+        schedule(thing, (1 << qMin(device.failures, maxBackoff)) - 1);
+        emit pollRequested(thing);
+    }
+
+    if (now - m_lastStatistics >= m_interval) {
+        qCDebug(dcShelly()) << "Poll statistics for" << m_devices.count() << "devices: sent:" << m_pollsSent << "skipped:" << m_pollsSkipped << "failed:" << m_pollsFailed;
+        m_lastStatistics = now;
+    }
+
+    armTimer();
+}
+
+void ShellyPollScheduler::updatePhases()
+{
+    // Sorting by id keeps the phases stable across restarts
+    QList<Thing*> things = m_devices.keys();
+    std::sort(things.begin(), things.end(), [](Thing *a, Thing *b){
+        return a->id().toString() < b->id().toString();
+    });
+
+    for (int i = 0; i < things.count(); i++) {
+        m_devices[things.at(i)].phase = m_interval * i / things.count();
+        schedule(things.at(i), 0);
+    }
+    armTimer();
+}
+
+void ShellyPollScheduler::schedule(Thing *thing, int cycles)
+{
+    Device &device = m_devices[thing];
+    if (device.dueTime > 0) {
+        m_schedule.remove(device.dueTime, thing);
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 dueTime = now - (now % m_interval) + device.phase;
+    while (dueTime <= now) {
+        dueTime += m_interval;
+    }
+    dueTime += cycles * m_interval;
+
+    // Some jitter, so devices don't lock into the same pattern with other traffic on the network
+    int jitter = static_cast<int>(m_interval / m_devices.count() / 10);
+    if (jitter > 0) {
+        dueTime += QRandomGenerator::global()->bounded(-jitter, jitter + 1);
+    }
+
+    device.dueTime = dueTime;
+    m_schedule.insert(dueTime, thing);
+}
+
+void ShellyPollScheduler::armTimer()
+{
+    if (m_schedule.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+    m_timer.start(static_cast<int>(qMax<qint64>(0, m_schedule.firstKey() - QDateTime::currentMSecsSinceEpoch())));
+}
@@ -0,0 +1,90 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef SHELLYPOLLSCHEDULER_H
+#define SHELLYPOLLSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QMultiMap>
+#include <QTimer>
+
+#include "integrations/thing.h"
+
+// Distributes status polls of many devices evenly over the poll interval instead of
+// polling all of them at once. Devices which fail to reply are polled less often and
+// polls are skipped for devices which recently pushed their state on their own.
+class ShellyPollScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ShellyPollScheduler(int interval, QObject *parent = nullptr);
+
+    void addThing(Thing *thing);
+    void removeThing(Thing *thing);
+
+    void pollFinished(Thing *thing, bool success);
+    void pushReceived(Thing *thing);
+
+    quint64 pollsSent() const;
+    quint64 pollsSkipped() const;
+    quint64 pollsFailed() const;
+
+signals:
+    void pollRequested(Thing *thing);
+
+private slots:
+    void onTimeout();
+
+private:
+    struct Device {
+        qint64 phase = 0;
+        qint64 dueTime = 0;
+        qint64 lastPush = 0;
+        int failures = 0;
+        int skips = 0;
+    };
+
+    void updatePhases();
+    void schedule(Thing *thing, int cycles);
+    void armTimer();
+
+    qint64 m_interval = 0;
+    QHash<Thing*, Device> m_devices;
+    QMultiMap<qint64, Thing*> m_schedule;
+    QTimer m_timer;
+
+    quint64 m_pollsSent = 0;
+    quint64 m_pollsSkipped = 0;
+    quint64 m_pollsFailed = 0;
+    qint64 m_lastStatistics = 0;
+};
+
+#endif // SHELLYPOLLSCHEDULER_H
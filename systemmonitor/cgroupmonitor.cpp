@@ -0,0 +1,252 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "cgroupmonitor.h"
+#include "extern-plugininfo.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+#include <unistd.h>
+
+// A unit which could not be found is searched for in the whole cgroup tree at most this often
+static const int cgroupLookupInterval = 30000;
+
+CgroupMonitor::CgroupMonitor(const QString &service, QObject *parent) :
+    QObject(parent),
+    m_service(service)
+{
+
+}
+
+CgroupMonitor::~CgroupMonitor()
+{
+    close();
+}
+
+QString CgroupMonitor::cgroupRoot()
+{
+    // Pure cgroup v2 systems mount the unified hierarchy directly, hybrid setups below "unified"
+    if (QFileInfo::exists("/sys/fs/cgroup/cgroup.controllers")) {
+        return "/sys/fs/cgroup";
+    }
+    if (QFileInfo::exists("/sys/fs/cgroup/unified/cgroup.controllers")) {
+        return "/sys/fs/cgroup/unified";
+    }
+    return QString();
+}
+
+QString CgroupMonitor::service() const
+{
+    return m_service;
+}
+
+QString CgroupMonitor::path() const
+{
+    return m_path;
+}
+
+bool CgroupMonitor::update()
+{
+    if (!m_cpuStat || !m_cpuStat->read()) {
+        // systemd removes the cgroup when the service stops and creates a new one when it starts again
+        close();
+        if (!open() || !m_cpuStat->read()) {
+            if (m_running) {
+                qCDebug(dcSystemMonitor()) << "Service" << m_service << "is not running";
+            }
+            close();
+            resetValues();
+            m_running = false;
+            return false;
+        }
+    }
+
+    qint64 elapsed = m_sampleTimer.isValid() ? m_sampleTimer.restart() : 0;
+    if (!m_sampleTimer.isValid()) {
+        m_sampleTimer.start();
+    }
+
+    // cpu.stat: "usage_usec <n>" is the first line and always available
+    ProcTokenizer tokenizer = m_cpuStat->tokenizer();
+    tokenizer.skip();
+    qulonglong cpuUsec = tokenizer.nextNumber();
+    if (elapsed > 0 && cpuUsec >= m_cpuUsec) {
+        long cpus = qMax(1L, sysconf(_SC_NPROCESSORS_ONLN));
+        m_cpuUsage = qMin(100.0, 100.0 * (cpuUsec - m_cpuUsec) / (elapsed * 1000.0 * cpus));
+    }
+    m_cpuUsec = cpuUsec;
+
+    m_memory = readValue(m_memoryCurrent.data());
+    m_processCount = static_cast<int>(readValue(m_pidsCurrent.data()));
+
+    // io.stat: one "<major>:<minor> rbytes=<n> wbytes=<n> rios=<n> ..." line per device
+    if (m_ioStat && m_ioStat->read()) {
+        qulonglong readBytes = 0;
+        qulonglong writtenBytes = 0;
+        ProcTokenizer ioTokenizer = m_ioStat->tokenizer();
+        for (; !ioTokenizer.atEnd(); ioTokenizer.nextLine()) {
+            ioTokenizer.skip();
+            const char *token;
+            int length;
+            while (ioTokenizer.nextToken(&token, &length)) {
+                if (length > 7 && strncmp(token, "rbytes=", 7) == 0) {
+                    readBytes += ProcTokenizer(token, length).nextNumber();
+                } else if (length > 7 && strncmp(token, "wbytes=", 7) == 0) {
+                    writtenBytes += ProcTokenizer(token, length).nextNumber();
+                }
+            }
+        }
+        if (elapsed > 0) {
+            m_ioReadRate = readBytes >= m_readBytes ? (readBytes - m_readBytes) * 1000.0 / elapsed : 0;
+            m_ioWriteRate = writtenBytes >= m_writtenBytes ? (writtenBytes - m_writtenBytes) * 1000.0 / elapsed : 0;
+        }
+        m_readBytes = readBytes;
+        m_writtenBytes = writtenBytes;
+    }
+
+    // An existing but empty cgroup means the service has no processes left
+    m_running = m_processCount != 0;
+    return m_running;
+}
+
+bool CgroupMonitor::running() const
+{
+    return m_running;
+}
+
+double CgroupMonitor::cpuUsage() const
+{
+    return m_cpuUsage;
+}
+
+qint64 CgroupMonitor::memory() const
+{
+    return m_memory;
+}
+
+int CgroupMonitor::processCount() const
+{
+    return m_processCount;
+}
+
+double CgroupMonitor::ioReadRate() const
+{
+    return m_ioReadRate;
+}
+
+double CgroupMonitor::ioWriteRate() const
+{
+    return m_ioWriteRate;
+}
+
+bool CgroupMonitor::open()
+{
+    if (m_path.isEmpty() || !QFileInfo::exists(m_path)) {
+        m_path = resolvePath();
+        if (m_path.isEmpty()) {
+            return false;
+        }
+    }
+
+    m_cpuStat.reset(new ProcFile(QFile::encodeName(m_path + "/cpu.stat")));
+    if (!m_cpuStat->isOpen()) {
+        return false;
+    }
+
+    // The remaining files only exist when the respective controller is enabled for the cgroup
+    m_memoryCurrent.reset(new ProcFile(QFile::encodeName(m_path + "/memory.current")));
+    m_ioStat.reset(new ProcFile(QFile::encodeName(m_path + "/io.stat")));
+    m_pidsCurrent.reset(new ProcFile(QFile::encodeName(m_path + "/pids.current")));
+    qCDebug(dcSystemMonitor()) << "Monitoring service" << m_service << "in" << m_path;
+    return true;
+}
+
+void CgroupMonitor::close()
+{
+    m_cpuStat.reset();
+    m_memoryCurrent.reset();
+    m_ioStat.reset();
+    m_pidsCurrent.reset();
+    m_sampleTimer.invalidate();
+}
+
+QString CgroupMonitor::resolvePath()
+{
+    QString root = cgroupRoot();
+    if (root.isEmpty()) {
+        return QString();
+    }
+
+    if (m_service.startsWith('/')) {
+        QString path = QDir::cleanPath(root + m_service);
+        return QFileInfo::exists(path) ? path : QString();
+    }
+
+    QString unit = m_service.contains('.') ? m_service : m_service + ".service";
+    QString path = root + "/system.slice/" + unit;
+    if (QFileInfo::exists(path)) {
+        return path;
+    }
+
+    // Units in other slices (user sessions, custom slices) need a walk over the tree
+    if (m_lookupTimer.isValid() && m_lookupTimer.elapsed() < cgroupLookupInterval) {
+        return QString();
+    }
+    m_lookupTimer.start();
+    QDirIterator it(root, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (it.fileName() == unit) {
+            return it.filePath();
+        }
+    }
+    return QString();
+}
+
+void CgroupMonitor::resetValues()
+{
+    m_cpuUsage = -1;
+    m_memory = -1;
+    m_processCount = -1;
+    m_ioReadRate = -1;
+    m_ioWriteRate = -1;
+}
+
+qint64 CgroupMonitor::readValue(ProcFile *file)
+{
+    if (!file || !file->isOpen() || !file->read()) {
+        return -1;
+    }
+    return static_cast<qint64>(file->tokenizer().nextNumber());
+}
@@ -0,0 +1,95 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGROUPMONITOR_H
+#define CGROUPMONITOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+
+#include "procfile.h"
+
+// Reads the cgroup v2 accounting files of a systemd unit or cgroup path. The
+// numbers cover all processes of the service, at a fixed cost of four reads.
+class CgroupMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CgroupMonitor(const QString &service, QObject *parent = nullptr);
+    ~CgroupMonitor() override;
+
+    static QString cgroupRoot();
+
+    QString service() const;
+    QString path() const;
+
+    bool update();
+
+    bool running() const;
+
+    // Values not provided by the cgroup (e.g. the controller is disabled) are negative
+    double cpuUsage() const;
+    qint64 memory() const;
+    int processCount() const;
+    double ioReadRate() const;
+    double ioWriteRate() const;
+
+private:
+    bool open();
+    void close();
+    QString resolvePath();
+    void resetValues();
+
+    static qint64 readValue(ProcFile *file);
+
+    QString m_service;
+    QString m_path;
+    QElapsedTimer m_lookupTimer;
+
+    QScopedPointer<ProcFile> m_cpuStat;
+    QScopedPointer<ProcFile> m_memoryCurrent;
+    QScopedPointer<ProcFile> m_ioStat;
+    QScopedPointer<ProcFile> m_pidsCurrent;
+
+    QElapsedTimer m_sampleTimer;
+    qulonglong m_cpuUsec = 0;
+    qulonglong m_readBytes = 0;
+    qulonglong m_writtenBytes = 0;
+
+    bool m_running = false;
+    double m_cpuUsage = -1;
+    qint64 m_memory = -1;
+    int m_processCount = -1;
+    double m_ioReadRate = -1;
+    double m_ioWriteRate = -1;
+};
+
+#endif // CGROUPMONITOR_H
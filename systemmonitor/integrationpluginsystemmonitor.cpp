@@ -38,7 +38,8 @@
 
 IntegrationPluginSystemMonitor::IntegrationPluginSystemMonitor()
 {
-
+    m_processScanner = new ProcessScanner(this);
+    m_systemSampler = new SystemSampler(this);
 }
 
 IntegrationPluginSystemMonitor::~IntegrationPluginSystemMonitor()
@@ -51,40 +52,162 @@ IntegrationPluginSystemMonitor::~IntegrationPluginSystemMonitor()
 void IntegrationPluginSystemMonitor::setupThing(ThingSetupInfo *info)
 {
     if (!m_refreshTimer) {
-        m_refreshTimer = hardwareManager()->pluginTimerManager()->registerTimer(2);
-        connect(m_refreshTimer, &PluginTimer::timeout, this, [=](){
-
-            foreach (Thing *thing, myThings()) {
+        m_refreshTimer = hardwareManager()->pluginTimerManager()->registerTimer(1);
+        connect(m_refreshTimer, &PluginTimer::timeout, this, &IntegrationPluginSystemMonitor::onRefreshTimer);
+        m_sampleClock.start();
+    }
 
-                if (thing->thingClassId() == systemMonitorThingClassId) {
-                    updateSystemMonitor(thing);
+    if (info->thing()->thingClassId() == processMonitorThingClassId) {
+        m_processScanner->watch(processName(info->thing()));
 
-                } else if (thing->thingClassId() == processMonitorThingClassId) {
-                    updateProcessMonitor(thing);
-                }
-            }
-        });
+    } else if (info->thing()->thingClassId() == serviceMonitorThingClassId) {
+        if (CgroupMonitor::cgroupRoot().isEmpty()) {
+            qCWarning(dcSystemMonitor()) << "No cgroup v2 hierarchy mounted. Cannot monitor services.";
+            info->finish(Thing::ThingErrorHardwareNotAvailable, QT_TR_NOOP("This system does not provide cgroup v2 accounting."));
+            return;
+        }
+        QString service = info->thing()->paramValue(serviceMonitorThingServiceParamTypeId).toString();
+        CgroupMonitor *monitor = new CgroupMonitor(service, this);
+        m_serviceMonitors.insert(info->thing(), monitor);
+        updateServiceMonitor(info->thing());
     }
     info->finish(Thing::ThingErrorNoError);
 }
 
+void IntegrationPluginSystemMonitor::postSetupThing(Thing *thing)
+{
+    if (thing->thingClassId() == systemMonitorThingClassId) {
+        // Take a first sample of everything so the child things can be created right away
+        m_systemSampler->sampleCpu();
+        m_systemSampler->sampleBlockDevices();
+        m_systemSampler->sampleNetworkInterfaces();
+        createChildThings(thing, SourceCpu);
+        createChildThings(thing, SourceBlockDevices);
+        createChildThings(thing, SourceNetwork);
+        createChildThings(thing, SourceFileSystems);
+    }
+}
+
 void IntegrationPluginSystemMonitor::thingRemoved(Thing *thing)
 {
-    Q_UNUSED(thing)
+    if (thing->thingClassId() == processMonitorThingClassId) {
+        m_processScanner->unwatch(processName(thing));
+    }
+
+    if (m_serviceMonitors.contains(thing)) {
+        delete m_serviceMonitors.take(thing);
+    }
 
     if (myThings().isEmpty()) {
         hardwareManager()->pluginTimerManager()->unregisterTimer(m_refreshTimer);
         m_refreshTimer = nullptr;
+        m_lastSample.clear();
     }
 
     m_oldTotalJiffies.remove(thing);
-    m_oldWorkJiffies.remove(thing);
     m_oldProcessWorkJiffies.remove(thing);
 }
 
+void IntegrationPluginSystemMonitor::onRefreshTimer()
+{
+    bool systemMonitors = !myThings().filterByThingClassId(systemMonitorThingClassId).isEmpty();
+    bool processMonitors = !myThings().filterByThingClassId(processMonitorThingClassId).isEmpty();
+    bool serviceMonitors = !m_serviceMonitors.isEmpty();
+
+    // Process monitors keep their fixed 2 second cycle, all other sources are sampled as configured
+    bool processesDue = processMonitors && sampleDue(SourceProcesses, 2);
+    bool servicesDue = serviceMonitors && sampleDue(SourceServices, 2);
+    bool cpuDue = systemMonitors && sampleDue(SourceCpu, configValue(systemMonitorPluginCpuSampleIntervalParamTypeId).toInt());
+    bool pressureDue = systemMonitors && sampleDue(SourcePressure, configValue(systemMonitorPluginPressureSampleIntervalParamTypeId).toInt());
+    bool blockDevicesDue = systemMonitors && sampleDue(SourceBlockDevices, configValue(systemMonitorPluginBlockDeviceSampleIntervalParamTypeId).toInt());
+    bool networkDue = systemMonitors && sampleDue(SourceNetwork, configValue(systemMonitorPluginNetworkSampleIntervalParamTypeId).toInt());
+    bool fileSystemsDue = systemMonitors && sampleDue(SourceFileSystems, configValue(systemMonitorPluginFileSystemSampleIntervalParamTypeId).toInt());
+
+    if (processesDue) {
+        m_processScanner->update();
+    }
+    if (cpuDue) {
+        m_systemSampler->sampleCpu();
+    }
+    if (pressureDue) {
+        m_systemSampler->samplePressure();
+    }
+    if (blockDevicesDue) {
+        m_systemSampler->sampleBlockDevices();
+    }
+    if (networkDue) {
+        m_systemSampler->sampleNetworkInterfaces();
+    }
+
+    foreach (Thing *thing, myThings()) {
+        if (thing->thingClassId() == systemMonitorThingClassId) {
+            if (cpuDue) {
+                updateSystemMonitor(thing);
+            }
+            if (pressureDue) {
+                updatePressure(thing);
+            }
+            // Only enumerate what has just been sampled, mounts are only rescanned with the file systems
+            if (cpuDue) {
+                createChildThings(thing, SourceCpu);
+            }
+            if (blockDevicesDue) {
+                createChildThings(thing, SourceBlockDevices);
+            }
+            if (networkDue) {
+                createChildThings(thing, SourceNetwork);
+            }
+            if (fileSystemsDue) {
+                createChildThings(thing, SourceFileSystems);
+            }
+
+        } else if (thing->thingClassId() == processMonitorThingClassId) {
+            if (processesDue) {
+                updateProcessMonitor(thing);
+            }
+
+        } else if (thing->thingClassId() == serviceMonitorThingClassId) {
+            if (servicesDue) {
+                updateServiceMonitor(thing);
+            }
+
+        } else if (thing->thingClassId() == cpuCoreThingClassId) {
+            if (cpuDue) {
+                updateCpuCore(thing);
+            }
+
+        } else if (thing->thingClassId() == blockDeviceThingClassId) {
+            if (blockDevicesDue) {
+                updateBlockDevice(thing);
+            }
+
+        } else if (thing->thingClassId() == networkInterfaceThingClassId) {
+            if (networkDue) {
+                updateNetworkInterface(thing);
+            }
+
+        } else if (thing->thingClassId() == fileSystemThingClassId) {
+            if (fileSystemsDue) {
+                updateFileSystem(thing);
+            }
+        }
+    }
+}
+
+bool IntegrationPluginSystemMonitor::sampleDue(Source source, int interval)
+{
+    qint64 now = m_sampleClock.elapsed();
+    // Allow some jitter of the 1 second plugin timer
+    if (m_lastSample.contains(source) && now - m_lastSample.value(source) < qMax(1, interval) * 1000 - 500) {
+        return false;
+    }
+    m_lastSample[source] = now;
+    return true;
+}
+
 void IntegrationPluginSystemMonitor::updateSystemMonitor(Thing *thing)
 {
-    double cpuPercentage = readTotalCpuUsage(thing);
+    double cpuPercentage = m_systemSampler->cpuUsage();
     if (cpuPercentage >= 0) {
         thing->setStateValue(systemMonitorCpuUsageStateTypeId, cpuPercentage);
     }
@@ -96,80 +219,227 @@ void IntegrationPluginSystemMonitor::updateSystemMonitor(Thing *thing)
 
 }
 
-void IntegrationPluginSystemMonitor::updateProcessMonitor(Thing *thing)
+void IntegrationPluginSystemMonitor::updatePressure(Thing *thing)
 {
-    QString processName = thing->paramValue(processMonitorThingProcessNameParamTypeId).toString();
-    // For backwards compatibility we'll use nymead if the new parameter (version 1.3) isn't set at all yet.
-    if (processName.isEmpty()) {
-        processName = "nymead";
+    SystemSampler::Pressure cpu = m_systemSampler->cpuPressure();
+    if (cpu.valid) {
+        thing->setStateValue(systemMonitorCpuPressureStateTypeId, cpu.some);
     }
-    qint32 pid = getPidByName(processName);
-    if (pid == -1) {
-        thing->setStateValue(processMonitorRunningStateTypeId, false);
+    SystemSampler::Pressure io = m_systemSampler->ioPressure();
+    if (io.valid) {
+        thing->setStateValue(systemMonitorIoPressureStateTypeId, io.some);
+        thing->setStateValue(systemMonitorIoPressureFullStateTypeId, io.full);
+    }
+    SystemSampler::Pressure memory = m_systemSampler->memoryPressure();
+    if (memory.valid) {
+        thing->setStateValue(systemMonitorMemoryPressureStateTypeId, memory.some);
+        thing->setStateValue(systemMonitorMemoryPressureFullStateTypeId, memory.full);
+    }
+}
+
+void IntegrationPluginSystemMonitor::updateServiceMonitor(Thing *thing)
+{
+    CgroupMonitor *monitor = m_serviceMonitors.value(thing);
+    if (!monitor) {
         return;
     }
-    thing->setStateValue(processMonitorRunningStateTypeId, true);
 
-    quint32 total, rss, shared;
-    double percentage;
-    if (readProcessMemoryUsage(pid, total, rss, shared, percentage)) {
-        thing->setStateValue(processMonitorPercentMemoryStateTypeId, percentage);
-        thing->setStateValue(processMonitorRssMemoryStateTypeId, rss);
-        thing->setStateValue(processMonitorVirtualMemoryStateTypeId, total);
-        thing->setStateValue(processMonitorSharedMemoryStateTypeId, shared);
+    if (!monitor->update()) {
+        thing->setStateValue(serviceMonitorRunningStateTypeId, false);
+        thing->setStateValue(serviceMonitorProcessCountStateTypeId, 0);
+        return;
     }
+    thing->setStateValue(serviceMonitorRunningStateTypeId, true);
 
-    thing->setStateValue(processMonitorCpuUsageStateTypeId, readProcessCpuUsage(pid, thing));
+    if (monitor->cpuUsage() >= 0) {
+        thing->setStateValue(serviceMonitorCpuUsageStateTypeId, monitor->cpuUsage());
+    }
+    if (monitor->memory() >= 0) {
+        struct sysinfo memInfo;
+        sysinfo(&memInfo);
+        qulonglong totalMem = memInfo.totalram;
+        totalMem *= memInfo.mem_unit;
+
+        thing->setStateValue(serviceMonitorMemoryStateTypeId, monitor->memory() / 1024);
+        thing->setStateValue(serviceMonitorPercentMemoryStateTypeId, 100.0 * monitor->memory() / totalMem);
+    }
+    if (monitor->processCount() >= 0) {
+        thing->setStateValue(serviceMonitorProcessCountStateTypeId, monitor->processCount());
+    }
+    if (monitor->ioReadRate() >= 0) {
+        thing->setStateValue(serviceMonitorIoReadRateStateTypeId, monitor->ioReadRate() / 1024);
+        thing->setStateValue(serviceMonitorIoWriteRateStateTypeId, monitor->ioWriteRate() / 1024);
+    }
 }
 
-double IntegrationPluginSystemMonitor::readTotalCpuUsage(Thing *thing)
+void IntegrationPluginSystemMonitor::updateCpuCore(Thing *thing)
 {
-    QFile f("/proc/stat");
-    if (!f.open(QFile::ReadOnly)) {
-        qCWarning(dcSystemMonitor()) << "Unable to open /proc/stat. Cannot read CPU usage";
-        return -1;
+    int core = thing->paramValue(cpuCoreThingCoreParamTypeId).toInt();
+    QVector<double> coreUsage = m_systemSampler->coreUsage();
+    if (core < coreUsage.count() && coreUsage.at(core) >= 0) {
+        thing->setStateValue(cpuCoreCpuUsageStateTypeId, coreUsage.at(core));
     }
-    QByteArray cpuStat = f.readLine().replace("  ", " ");
-    f.close();
-    qCDebug(dcSystemMonitor()) << "SystemCPU:" << "stat:" << cpuStat;
-    QList<QByteArray> parts = cpuStat.split(' ');
-    if (parts.first() != "cpu" || parts.count() < 8) {
-        qCWarning(dcSystemMonitor()) << "/proc/stat not in expected format";
-        return -1;
+}
+
+void IntegrationPluginSystemMonitor::updateBlockDevice(Thing *thing)
+{
+    QByteArray deviceName = thing->paramValue(blockDeviceThingDeviceNameParamTypeId).toString().toUtf8();
+    foreach (const SystemSampler::BlockDevice &device, m_systemSampler->blockDevices()) {
+        if (device.name == deviceName) {
+            thing->setStateValue(blockDeviceReadRateStateTypeId, device.readRate / 1024);
+            thing->setStateValue(blockDeviceWriteRateStateTypeId, device.writeRate / 1024);
+            thing->setStateValue(blockDeviceUtilizationStateTypeId, device.utilization);
+            return;
+        }
     }
+    thing->setStateValue(blockDeviceReadRateStateTypeId, 0);
+    thing->setStateValue(blockDeviceWriteRateStateTypeId, 0);
+    thing->setStateValue(blockDeviceUtilizationStateTypeId, 0);
+}
 
-    qulonglong systemJiffies = parts.at(1).toULong();
-//    qulonglong niceJiffies = parts.at(2).toULong();
-    qulonglong userJiffies = parts.at(3).toULong();
-    qulonglong idleJiffies = parts.at(4).toULong();
-//    qulonglong ioWaitJiffies = parts.at(5).toULong();
-//    qulonglong irqJiffies = parts.at(6).toULong();
-//    qulonglong softirqJiffies = parts.at(7).toULong();
+void IntegrationPluginSystemMonitor::updateNetworkInterface(Thing *thing)
+{
+    QByteArray interfaceName = thing->paramValue(networkInterfaceThingInterfaceNameParamTypeId).toString().toUtf8();
+    foreach (const SystemSampler::NetworkInterface &networkInterface, m_systemSampler->networkInterfaces()) {
+        if (networkInterface.name == interfaceName) {
+            thing->setStateValue(networkInterfaceReceiveRateStateTypeId, networkInterface.receiveRate / 1024);
+            thing->setStateValue(networkInterfaceTransmitRateStateTypeId, networkInterface.transmitRate / 1024);
+            return;
+        }
+    }
+    thing->setStateValue(networkInterfaceReceiveRateStateTypeId, 0);
+    thing->setStateValue(networkInterfaceTransmitRateStateTypeId, 0);
+}
+
+void IntegrationPluginSystemMonitor::updateFileSystem(Thing *thing)
+{
+    QStorageInfo storageInfo(thing->paramValue(fileSystemThingMountPointParamTypeId).toString());
+    if (!storageInfo.isValid() || !storageInfo.isReady() || storageInfo.bytesTotal() <= 0) {
+        return;
+    }
+    double percentage = 100.0 * (storageInfo.bytesTotal() - storageInfo.bytesFree()) / storageInfo.bytesTotal();
+    thing->setStateValue(fileSystemPercentStorageStateTypeId, percentage);
+    thing->setStateValue(fileSystemAvailableStorageStateTypeId, storageInfo.bytesAvailable() / 1024.0 / 1024.0);
+}
 
-    qulonglong workJiffies = systemJiffies + userJiffies;
-    qulonglong totalJiffies = workJiffies + idleJiffies;
+void IntegrationPluginSystemMonitor::createChildThings(Thing *parent, Source source)
+{
+    ThingClassId thingClassId;
+    ParamTypeId paramTypeId;
+    ThingDescriptors found;
+
+    switch (source) {
+    case SourceCpu: {
+        thingClassId = cpuCoreThingClassId;
+        paramTypeId = cpuCoreThingCoreParamTypeId;
+        QVector<double> coreUsage = m_systemSampler->coreUsage();
+        for (int core = 0; core < coreUsage.count(); core++) {
+            ThingDescriptor descriptor(cpuCoreThingClassId, QString("CPU %1").arg(core), QString(), parent->id());
+            descriptor.setParams(ParamList() << Param(cpuCoreThingCoreParamTypeId, core));
+            found.append(descriptor);
+        }
+        break;
+    }
+    case SourceBlockDevices:
+        thingClassId = blockDeviceThingClassId;
+        paramTypeId = blockDeviceThingDeviceNameParamTypeId;
+        foreach (const SystemSampler::BlockDevice &device, m_systemSampler->blockDevices()) {
+            QString deviceName = QString::fromUtf8(device.name);
+            ThingDescriptor descriptor(blockDeviceThingClassId, deviceName, QString(), parent->id());
+            descriptor.setParams(ParamList() << Param(blockDeviceThingDeviceNameParamTypeId, deviceName));
+            found.append(descriptor);
+        }
+        break;
+    case SourceNetwork:
+        thingClassId = networkInterfaceThingClassId;
+        paramTypeId = networkInterfaceThingInterfaceNameParamTypeId;
+        foreach (const SystemSampler::NetworkInterface &networkInterface, m_systemSampler->networkInterfaces()) {
+            QString interfaceName = QString::fromUtf8(networkInterface.name);
+            ThingDescriptor descriptor(networkInterfaceThingClassId, interfaceName, QString(), parent->id());
+            descriptor.setParams(ParamList() << Param(networkInterfaceThingInterfaceNameParamTypeId, interfaceName));
+            found.append(descriptor);
+        }
+        break;
+    case SourceFileSystems:
+        thingClassId = fileSystemThingClassId;
+        paramTypeId = fileSystemThingMountPointParamTypeId;
+        foreach (const QStorageInfo &storageInfo, QStorageInfo::mountedVolumes()) {
+            // Only file systems backed by a device, this skips proc, sysfs, tmpfs and friends
+            if (!storageInfo.isValid() || !storageInfo.isReady() || !storageInfo.device().startsWith("/dev/")) {
+                continue;
+            }
+            QString mountPoint = storageInfo.rootPath();
+            ThingDescriptor descriptor(fileSystemThingClassId, mountPoint, QString::fromUtf8(storageInfo.device()), parent->id());
+            descriptor.setParams(ParamList() << Param(fileSystemThingMountPointParamTypeId, mountPoint));
+            found.append(descriptor);
+        }
+        break;
+    default:
+        return;
+    }
 
+    Things children = myThings().filterByParentId(parent->id()).filterByThingClassId(thingClassId);
+    QString keyPrefix = parent->id().toString() + thingClassId.toString();
+
+    // Things announced before are not set up yet when the next sample comes in
+    ThingDescriptors newDescriptors;
+    QSet<QString> foundKeys;
+    foreach (const ThingDescriptor &descriptor, found) {
+        QString key = keyPrefix + descriptor.title();
+        foundKeys.insert(key);
+        if (!children.findByParams(descriptor.params()) && !m_announcedThings.contains(key)) {
+            m_announcedThings.insert(key);
+            newDescriptors.append(descriptor);
+        }
+    }
 
-    double cpuPercentage = 0;
-    if (m_oldTotalJiffies.contains(thing)) {
-        qulonglong oldTotalJiffies = m_oldTotalJiffies.value(thing);
-        qulonglong oldWorkJiffies = m_oldWorkJiffies.value(thing);
-        qCDebug(dcSystemMonitor()) << "SystemCPU:" << "Current work:" << workJiffies << "total:" << totalJiffies << "Old work:" << oldWorkJiffies << "total:" << oldTotalJiffies;
-        if (workJiffies < oldWorkJiffies || totalJiffies < oldTotalJiffies) {
-            // One of the values overflowed. Skipping this cycle
-            m_oldTotalJiffies[thing] = totalJiffies;
-            m_oldWorkJiffies[thing] = workJiffies;
-            return -1;
+    // Disks, interfaces and mounts come and go, CPU cores stay
+    if (source != SourceCpu) {
+        foreach (const QString &key, m_announcedThings) {
+            if (key.startsWith(keyPrefix) && !foundKeys.contains(key)) {
+                m_announcedThings.remove(key);
+            }
         }
-        qulonglong totalJiffDiff = totalJiffies - oldTotalJiffies;
-        qulonglong workJiffDiff = workJiffies - oldWorkJiffies;
+        foreach (Thing *child, children) {
+            bool present = false;
+            foreach (const ThingDescriptor &descriptor, found) {
+                if (descriptor.params().paramValue(paramTypeId) == child->paramValue(paramTypeId)) {
+                    present = true;
+                    break;
+                }
+            }
+            if (!present) {
+                qCDebug(dcSystemMonitor()) << "Removing system monitor child thing" << child->name();
+                emit autoThingDisappeared(child->id());
+            }
+        }
+    }
 
-        cpuPercentage = 100.0 * workJiffDiff / totalJiffDiff;
+    if (!newDescriptors.isEmpty()) {
+        qCDebug(dcSystemMonitor()) << "Adding" << newDescriptors.count() << "system monitor child things";
+        emit autoThingsAppeared(newDescriptors);
+    }
+}
+
+void IntegrationPluginSystemMonitor::updateProcessMonitor(Thing *thing)
+{
+    QString processName = this->processName(thing);
+    if (m_processScanner->pid(processName) == -1) {
+        thing->setStateValue(processMonitorRunningStateTypeId, false);
+        return;
+    }
+    thing->setStateValue(processMonitorRunningStateTypeId, true);
+
+    quint32 total, rss, shared;
+    double percentage;
+    if (readProcessMemoryUsage(processName, total, rss, shared, percentage)) {
+        thing->setStateValue(processMonitorPercentMemoryStateTypeId, percentage);
+        thing->setStateValue(processMonitorRssMemoryStateTypeId, rss);
+        thing->setStateValue(processMonitorVirtualMemoryStateTypeId, total);
+        thing->setStateValue(processMonitorSharedMemoryStateTypeId, shared);
     }
-    m_oldTotalJiffies[thing] = totalJiffies;
-    m_oldWorkJiffies[thing] = workJiffies;
 
-    return cpuPercentage;
+    thing->setStateValue(processMonitorCpuUsageStateTypeId, readProcessCpuUsage(processName, thing));
 }
 
 double IntegrationPluginSystemMonitor::readTotalMemoryUsage()
@@ -193,33 +463,20 @@ double IntegrationPluginSystemMonitor::readTotalMemoryUsage()
 
 }
 
-bool IntegrationPluginSystemMonitor::readProcessMemoryUsage(qint32 pid, quint32 &total, quint32 &rss, quint32 &shared, double &percentage)
+bool IntegrationPluginSystemMonitor::readProcessMemoryUsage(const QString &processName, quint32 &total, quint32 &rss, quint32 &shared, double &percentage)
 {
-    QFile f(QString("/proc/%1/statm").arg(pid));
-    if (!f.open(QFile::ReadOnly)) {
-        qCWarning(dcSystemMonitor()).nospace() << "Unable to open " << f.fileName() << ". Cannot read memory usage.";
+    ProcessScanner::ProcessMemory memory;
+    if (!m_processScanner->processMemory(processName, memory)) {
         return false;
     }
 
-    QByteArray memStat = f.readLine();
-    f.close();
-
-    QList<QByteArray> parts = memStat.split(' ');
-    if (parts.count() < 3) {
-        qCWarning(dcSystemMonitor()) << f.fileName() << "not in expected format";
-        return false;
-    }
-    int tsize = parts.at(0).toInt();
-    int resident = parts.at(1).toInt();
-    int share = parts.at(2).toInt();
-
     long page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024;
 
-    total = tsize;
+    total = memory.total;
     total *= page_size_kb;
-    rss = resident;
+    rss = memory.resident;
     rss *= page_size_kb;
-    shared = share;
+    shared = memory.shared;
     shared *= page_size_kb;
 
     struct sysinfo memInfo;
@@ -234,51 +491,15 @@ bool IntegrationPluginSystemMonitor::readProcessMemoryUsage(qint32 pid, quint32
     return true;
 }
 
-double IntegrationPluginSystemMonitor::readProcessCpuUsage(qint32 pid, Thing *thing)
+double IntegrationPluginSystemMonitor::readProcessCpuUsage(const QString &processName, Thing *thing)
 {
-    QFile systemFile("/proc/stat");
-    if (!systemFile.open(QFile::ReadOnly)) {
-        qCWarning(dcSystemMonitor()) << "Unable to open /proc/stat. Cannot read CPU usage";
-        return 0;
-    }
-    QByteArray cpuStat = systemFile.readLine().replace("  ", " ");
-    systemFile.close();
-    qCDebug(dcSystemMonitor()) << "ProcessCPU:" << "System stat:" << cpuStat;
-    QList<QByteArray> parts = cpuStat.split(' ');
-    if (parts.first() != "cpu" || parts.count() < 8) {
-        qCWarning(dcSystemMonitor()) << "/proc/stat not in expected format";
-        return 0;
-    }
-    parts.removeFirst();
-
-    qulonglong systemJiffies = parts.at(1).toULong();
-    qulonglong userJiffies = parts.at(3).toULong();
-//    qulonglong idleJiffies = parts.at(4).toULong();
-
-    qulonglong totalJiffies = systemJiffies + userJiffies;// + idleJiffies;
-
-    QFile f(QString("/proc/%1/stat").arg(pid));
-    if (!f.open(QFile::ReadOnly)) {
-        qCWarning(dcSystemMonitor()).nospace() << "Unable to open " << f.fileName() << ". Cannot read CPU usage.";
-        return 0;
-    }
-
-    QByteArray stat = f.readLine();
-    f.close();
-
-    qCDebug(dcSystemMonitor()) << "ProcessCPU:" << "Process stat:" << stat;
-
-    parts = stat.split(' ');
-    if (parts.length() < 15) {
-        qCWarning(dcSystemMonitor()) << f.fileName() << "not in expected format";
+    ProcessScanner::ProcessStat stat;
+    if (!m_processScanner->processStat(processName, stat)) {
         return 0;
     }
 
-    qulonglong processUserJiffies = parts.at(13).toULongLong();
-    qulonglong processKernelJiffies = parts.at(14).toULongLong();
-    qulonglong processChildUserJiffies = parts.at(15).toULongLong();
-    qulonglong processChildKernelJiffies = parts.at(16).toULongLong();
-    qulonglong processWorkJiffies = processUserJiffies + processKernelJiffies + processChildUserJiffies + processChildKernelJiffies;
+    qulonglong totalJiffies = m_processScanner->totalJiffies();
+    qulonglong processWorkJiffies = stat.workJiffies;
 
     double percentage = 0;
     if (m_oldTotalJiffies.contains(thing)) {
@@ -287,9 +508,10 @@ double IntegrationPluginSystemMonitor::readProcessCpuUsage(qint32 pid, Thing *th
 
         qCDebug(dcSystemMonitor()) << "ProcessCPU:" << "Current total:" << totalJiffies << "process:" << processWorkJiffies << "Old total:" << oldTotalJiffies << "process:" << oldProcessWorkJiffies;
 
-        qulonglong totalJiffDiff = totalJiffies - oldTotalJiffies;
-        qulonglong processWorkJiffDiff = processWorkJiffies - oldProcessWorkJiffies;
-        if (totalJiffDiff > 0) {
+        // The process counters start over when the process has been restarted
+        if (totalJiffies > oldTotalJiffies && processWorkJiffies >= oldProcessWorkJiffies) {
+            qulonglong totalJiffDiff = totalJiffies - oldTotalJiffies;
+            qulonglong processWorkJiffDiff = processWorkJiffies - oldProcessWorkJiffies;
             percentage = 100.0 * processWorkJiffDiff / totalJiffDiff;
         }
     }
@@ -300,22 +522,12 @@ double IntegrationPluginSystemMonitor::readProcessCpuUsage(qint32 pid, Thing *th
     return percentage;
 }
 
-qint32 IntegrationPluginSystemMonitor::getPidByName(const QString &processName)
+QString IntegrationPluginSystemMonitor::processName(Thing *thing) const
 {
-    QDir proc("/proc");
-    foreach (const QString dirName, proc.entryList(QDir::AllDirs | QDir::NoDotAndDotDot)) {
-        QFile statusFile(proc.absoluteFilePath(dirName + QDir::separator() + "status"));
-        if (!statusFile.open(QFile::ReadOnly)) {
-            continue;
-        }
-        QString line = statusFile.readLine().trimmed();
-        line.remove(QRegExp("Name:(\\s)*"));
-//        qCDebug(dcSystemMonitor()) << "Found process:" << line << "looking for" << processName.left(15);
-        // names in /proc/<pid>/status are trimmed to 15 characters...
-        if (processName.left(15) == line.left(15)) {
-            return dirName.toInt();
-        }
+    QString processName = thing->paramValue(processMonitorThingProcessNameParamTypeId).toString();
+    // For backwards compatibility we'll use nymead if the new parameter (version 1.3) isn't set at all yet.
+    if (processName.isEmpty()) {
+        processName = "nymead";
     }
-    return -1;
+    return processName;
 }
-
@@ -33,10 +33,14 @@
 
 #include "integrations/integrationplugin.h"
 #include "plugintimer.h"
+#include "processscanner.h"
+#include "systemsampler.h"
+#include "cgroupmonitor.h"
 
 #include <QDebug>
 #include <QProcess>
 #include <QUrlQuery>
+#include <QElapsedTimer>
 
 #include "extern-plugininfo.h"
 
@@ -50,24 +54,53 @@ public:
     ~IntegrationPluginSystemMonitor() override;
 
     void setupThing(ThingSetupInfo *info) override;
+    void postSetupThing(Thing *thing) override;
     void thingRemoved(Thing *thing) override;
 
+private slots:
+    void onRefreshTimer();
+
 private:
+    enum Source {
+        SourceProcesses,
+        SourceServices,
+        SourceCpu,
+        SourcePressure,
+        SourceBlockDevices,
+        SourceNetwork,
+        SourceFileSystems
+    };
+
+    bool sampleDue(Source source, int interval);
+
     void updateSystemMonitor(Thing *thing);
+    void updatePressure(Thing *thing);
     void updateProcessMonitor(Thing *thing);
+    void updateServiceMonitor(Thing *thing);
+    void updateCpuCore(Thing *thing);
+    void updateBlockDevice(Thing *thing);
+    void updateNetworkInterface(Thing *thing);
+    void updateFileSystem(Thing *thing);
+
+    void createChildThings(Thing *parent, Source source);
 
-    double readTotalCpuUsage(Thing *thing);
     double readTotalMemoryUsage();
-    bool readProcessMemoryUsage(qint32 pid, quint32 &total, quint32 &rss, quint32 &shared, double &percentage);
-    double readProcessCpuUsage(qint32 pid, Thing *thing);
+    bool readProcessMemoryUsage(const QString &processName, quint32 &total, quint32 &rss, quint32 &shared, double &percentage);
+    double readProcessCpuUsage(const QString &processName, Thing *thing);
 
-    qint32 getPidByName(const QString &processName);
+    QString processName(Thing *thing) const;
 
 private:
     PluginTimer *m_refreshTimer = nullptr;
+    ProcessScanner *m_processScanner = nullptr;
+    SystemSampler *m_systemSampler = nullptr;
+    QHash<Thing*, CgroupMonitor*> m_serviceMonitors;
+
+    QElapsedTimer m_sampleClock;
+    QHash<int, qint64> m_lastSample;
+    QSet<QString> m_announcedThings;
 
     QHash<Thing*, qulonglong> m_oldTotalJiffies;
-    QHash<Thing*, qulonglong> m_oldWorkJiffies;
     QHash<Thing*, qulonglong> m_oldProcessWorkJiffies;
 
 };
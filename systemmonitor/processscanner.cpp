@@ -0,0 +1,336 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "processscanner.h"
+#include "extern-plugininfo.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Processes which are not running are searched for at most this often
+static const int missingProcessRescanInterval = 10000;
+
+// Names in /proc/<pid>/stat are trimmed to 15 characters
+static const int commNameLength = 15;
+
+ProcessScanner::ProcessScanner(QObject *parent) :
+    QObject(parent),
+    m_procStat("/proc/stat")
+{
+    if (!m_procStat.isOpen()) {
+        qCWarning(dcSystemMonitor()) << "Unable to open /proc/stat. Cannot read CPU usage";
+    }
+}
+
+ProcessScanner::~ProcessScanner()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        closeEntry(it.value());
+    }
+}
+
+void ProcessScanner::watch(const QString &processName)
+{
+    QByteArray name = commName(processName);
+    Entry &entry = m_entries[name];
+    entry.refCount++;
+    if (entry.pid < 0) {
+        m_scanPending = true;
+    }
+}
+
+void ProcessScanner::unwatch(const QString &processName)
+{
+    QByteArray name = commName(processName);
+    if (!m_entries.contains(name)) {
+        return;
+    }
+    Entry &entry = m_entries[name];
+    if (--entry.refCount > 0) {
+        return;
+    }
+    closeEntry(entry);
+    m_entries.remove(name);
+}
+
+void ProcessScanner::update()
+{
+    readTotalJiffies();
+
+    bool missing = false;
+    char buffer[1024];
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        Entry &entry = it.value();
+        if (entry.pid < 0) {
+            missing = true;
+            continue;
+        }
+
+        // Once the process is gone, reads on its stat file fail with ESRCH. Comparing
+        // the start time additionally protects against the PID having been recycled.
+        int length = 0;
+        ProcessStat stat;
+        if (!readFd(entry.statFd, buffer, sizeof(buffer), length)
+                || !parseStat(buffer, length, nullptr, stat)
+                || stat.startTime != entry.stat.startTime) {
+            qCDebug(dcSystemMonitor()) << "Process" << it.key() << "with PID" << entry.pid << "disappeared";
+            closeEntry(entry);
+            m_scanPending = true;
+            continue;
+        }
+        entry.stat = stat;
+    }
+
+    if (m_scanPending || (missing && (!m_lastScan.isValid() || m_lastScan.elapsed() >= missingProcessRescanInterval))) {
+        rescan();
+    }
+}
+
+qint32 ProcessScanner::pid(const QString &processName) const
+{
+    return m_entries.value(commName(processName)).pid;
+}
+
+bool ProcessScanner::processStat(const QString &processName, ProcessStat &stat) const
+{
+    QHash<QByteArray, Entry>::const_iterator it = m_entries.constFind(commName(processName));
+    if (it == m_entries.constEnd() || it.value().pid < 0) {
+        return false;
+    }
+    stat = it.value().stat;
+    return true;
+}
+
+bool ProcessScanner::processMemory(const QString &processName, ProcessMemory &memory)
+{
+    QHash<QByteArray, Entry>::const_iterator it = m_entries.constFind(commName(processName));
+    if (it == m_entries.constEnd() || it.value().pid < 0) {
+        return false;
+    }
+
+    char buffer[256];
+    int length = 0;
+    if (!readFd(it.value().statmFd, buffer, sizeof(buffer), length)) {
+        qCWarning(dcSystemMonitor()).nospace() << "Unable to read /proc/" << it.value().pid << "/statm. Cannot read memory usage.";
+        return false;
+    }
+
+    ProcTokenizer tokenizer(buffer, length);
+    memory.total = tokenizer.nextNumber();
+    memory.resident = tokenizer.nextNumber();
+    memory.shared = tokenizer.nextNumber();
+    return true;
+}
+
+qulonglong ProcessScanner::totalJiffies() const
+{
+    return m_totalJiffies;
+}
+
+int ProcessScanner::rescanCount() const
+{
+    return m_rescanCount;
+}
+
+void ProcessScanner::rescan()
+{
+    m_scanPending = false;
+    m_lastScan.start();
+
+    QHash<QByteArray, Entry*> unresolved;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it.value().pid < 0) {
+            unresolved.insert(it.key(), &it.value());
+        }
+    }
+    if (unresolved.isEmpty()) {
+        return;
+    }
+
+    DIR *proc = opendir("/proc");
+    if (!proc) {
+        qCWarning(dcSystemMonitor()) << "Unable to open /proc. Cannot look up processes.";
+        return;
+    }
+    m_rescanCount++;
+
+    char path[64];
+    char buffer[1024];
+    QByteArray comm;
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(proc)) != nullptr) {
+        const char *name = dirEntry->d_name;
+        if (name[0] < '1' || name[0] > '9') {
+            continue;
+        }
+        qint32 pid = static_cast<qint32>(strtol(name, nullptr, 10));
+
+        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+        int statFd = open(path, O_RDONLY | O_CLOEXEC);
+        if (statFd < 0) {
+            continue;
+        }
+
+        int length = 0;
+        ProcessStat stat;
+        if (!readFd(statFd, buffer, sizeof(buffer), length) || !parseStat(buffer, length, &comm, stat)) {
+            close(statFd);
+            continue;
+        }
+
+        // Prefer the lowest PID when several processes share a name, which usually is the parent
+        Entry *entry = unresolved.value(comm);
+        if (!entry || (entry->pid >= 0 && entry->pid < pid)) {
+            close(statFd);
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+        int statmFd = open(path, O_RDONLY | O_CLOEXEC);
+        if (statmFd < 0) {
+            close(statFd);
+            continue;
+        }
+
+        closeEntry(*entry);
+        entry->pid = pid;
+        entry->statFd = statFd;
+        entry->statmFd = statmFd;
+        entry->stat = stat;
+    }
+    closedir(proc);
+
+    foreach (const QByteArray &name, unresolved.keys()) {
+        if (unresolved.value(name)->pid >= 0) {
+            qCDebug(dcSystemMonitor()) << "Found process" << name << "with PID" << unresolved.value(name)->pid;
+        }
+    }
+}
+
+void ProcessScanner::closeEntry(Entry &entry)
+{
+    if (entry.statFd >= 0) {
+        close(entry.statFd);
+    }
+    if (entry.statmFd >= 0) {
+        close(entry.statmFd);
+    }
+    entry.statFd = -1;
+    entry.statmFd = -1;
+    entry.pid = -1;
+    entry.stat = ProcessStat();
+}
+
+bool ProcessScanner::readTotalJiffies()
+{
+    if (!m_procStat.read()) {
+        return false;
+    }
+
+    const char *token;
+    int length;
+    ProcTokenizer tokenizer = m_procStat.tokenizer();
+    if (!tokenizer.nextToken(&token, &length) || length != 3 || strncmp(token, "cpu", 3) != 0) {
+        qCWarning(dcSystemMonitor()) << "/proc/stat not in expected format";
+        return false;
+    }
+
+    // user nice system idle iowait irq softirq steal; guest time is already part of user
+    qulonglong total = 0;
+    for (int i = 0; i < 8; i++) {
+        total += tokenizer.nextNumber();
+    }
+    m_totalJiffies = total;
+    return true;
+}
+
+QByteArray ProcessScanner::commName(const QString &processName)
+{
+    return processName.toUtf8().left(commNameLength);
+}
+
+bool ProcessScanner::readFd(int fd, char *buffer, int size, int &length)
+{
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t result = pread(fd, buffer, static_cast<size_t>(size - 1), 0);
+    if (result <= 0) {
+        return false;
+    }
+    length = static_cast<int>(result);
+    buffer[length] = '\0';
+    return true;
+}
+
+bool ProcessScanner::parseStat(const char *data, int length, QByteArray *comm, ProcessStat &stat)
+{
+    // The process name may contain spaces and parentheses, so it spans from the
+    // first '(' to the last ')'. All fields after it are plain numbers.
+    const char *end = data + length;
+    const char *nameStart = static_cast<const char*>(memchr(data, '(', static_cast<size_t>(length)));
+    const char *nameEnd = end;
+    while (nameEnd > data && *(nameEnd - 1) != ')') {
+        nameEnd--;
+    }
+    if (!nameStart || nameEnd <= nameStart + 1) {
+        return false;
+    }
+    nameEnd--;
+
+    if (comm) {
+        comm->setRawData(nameStart + 1, static_cast<uint>(nameEnd - nameStart - 1));
+    }
+
+    // Fields 3 (state) to 13 are skipped, utime, stime, cutime and cstime follow
+    ProcTokenizer tokenizer(nameEnd + 1, static_cast<int>(end - nameEnd - 1));
+    tokenizer.skip(11);
+    qulonglong utime = tokenizer.nextNumber();
+    qulonglong stime = tokenizer.nextNumber();
+    qulonglong cutime = tokenizer.nextNumber();
+    qulonglong cstime = tokenizer.nextNumber();
+
+    // Fields 18 to 21 are skipped, followed by starttime
+    tokenizer.skip(4);
+    const char *token;
+    int tokenLength;
+    if (!tokenizer.nextToken(&token, &tokenLength)) {
+        return false;
+    }
+    qulonglong startTime = ProcTokenizer(token, tokenLength).nextNumber();
+
+    stat.workJiffies = utime + stime + cutime + cstime;
+    stat.startTime = startTime;
+    return true;
+}
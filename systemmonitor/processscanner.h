@@ -0,0 +1,102 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef PROCESSSCANNER_H
+#define PROCESSSCANNER_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+
+#include "procfile.h"
+
+// Resolves process names to PIDs with a single shared walk over /proc and keeps
+// the /proc/<pid>/stat and statm files of every watched process open, so that a
+// refresh cycle costs one pread() per file instead of a directory scan per thing.
+class ProcessScanner : public QObject
+{
+    Q_OBJECT
+public:
+    struct ProcessStat {
+        qulonglong workJiffies = 0;
+        qulonglong startTime = 0;
+    };
+
+    struct ProcessMemory {
+        quint64 total = 0;
+        quint64 resident = 0;
+        quint64 shared = 0;
+    };
+
+    explicit ProcessScanner(QObject *parent = nullptr);
+    ~ProcessScanner() override;
+
+    void watch(const QString &processName);
+    void unwatch(const QString &processName);
+
+    // Call once per refresh cycle before querying any process.
+    void update();
+
+    qint32 pid(const QString &processName) const;
+    bool processStat(const QString &processName, ProcessStat &stat) const;
+    bool processMemory(const QString &processName, ProcessMemory &memory);
+
+    qulonglong totalJiffies() const;
+
+    int rescanCount() const;
+
+private:
+    struct Entry {
+        int refCount = 0;
+        qint32 pid = -1;
+        int statFd = -1;
+        int statmFd = -1;
+        ProcessStat stat;
+    };
+
+    void rescan();
+    void closeEntry(Entry &entry);
+    bool readTotalJiffies();
+
+    static QByteArray commName(const QString &processName);
+    static bool readFd(int fd, char *buffer, int size, int &length);
+    static bool parseStat(const char *data, int length, QByteArray *comm, ProcessStat &stat);
+
+    QHash<QByteArray, Entry> m_entries;
+
+    ProcFile m_procStat;
+    qulonglong m_totalJiffies = 0;
+
+    bool m_scanPending = false;
+    QElapsedTimer m_lastScan;
+    int m_rescanCount = 0;
+};
+
+#endif // PROCESSSCANNER_H
@@ -0,0 +1,177 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "procfile.h"
+#include "extern-plugininfo.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+ProcTokenizer::ProcTokenizer(const char *data, int length) :
+    m_position(data),
+    m_end(data + length)
+{
+
+}
+
+bool ProcTokenizer::atEnd() const
+{
+    return m_position >= m_end;
+}
+
+bool ProcTokenizer::nextLine()
+{
+    const char *newline = static_cast<const char*>(memchr(m_position, '\n', static_cast<size_t>(m_end - m_position)));
+    m_position = newline ? newline + 1 : m_end;
+    return !atEnd();
+}
+
+bool ProcTokenizer::nextToken(const char **token, int *length, char separator)
+{
+    while (m_position < m_end && isSpace(*m_position)) {
+        m_position++;
+    }
+    if (m_position >= m_end || *m_position == '\n') {
+        return false;
+    }
+
+    const char *start = m_position;
+    while (m_position < m_end && !isSpace(*m_position) && *m_position != '\n' && *m_position != separator) {
+        m_position++;
+    }
+    *token = start;
+    *length = static_cast<int>(m_position - start);
+
+    if (separator != '\0' && m_position < m_end && *m_position == separator) {
+        m_position++;
+    }
+    return true;
+}
+
+void ProcTokenizer::skip(int count)
+{
+    const char *token;
+    int length;
+    for (int i = 0; i < count; i++) {
+        if (!nextToken(&token, &length)) {
+            return;
+        }
+    }
+}
+
+qulonglong ProcTokenizer::nextNumber()
+{
+    const char *token;
+    int length;
+    if (!nextToken(&token, &length)) {
+        return 0;
+    }
+
+    const char *end = token + length;
+    const char *equals = static_cast<const char*>(memchr(token, '=', static_cast<size_t>(length)));
+    const char *p = equals ? equals + 1 : token;
+
+    qulonglong value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + static_cast<qulonglong>(*p - '0');
+        p++;
+    }
+    return value;
+}
+
+ProcFile::ProcFile(const QByteArray &path) :
+    m_path(path),
+    m_buffer(4096, Qt::Uninitialized)
+{
+    m_fd = open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        qCDebug(dcSystemMonitor()) << "Unable to open" << path;
+    }
+}
+
+ProcFile::~ProcFile()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+QByteArray ProcFile::path() const
+{
+    return m_path;
+}
+
+bool ProcFile::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+bool ProcFile::read()
+{
+    m_size = 0;
+    if (m_fd < 0) {
+        return false;
+    }
+
+    // /proc files are generated on each read, so a short buffer would only give
+    // us the first part. Grow it until the whole file fits in a single read.
+    forever {
+        ssize_t result = pread(m_fd, m_buffer.data(), static_cast<size_t>(m_buffer.size()), 0);
+        if (result < 0) {
+            return false;
+        }
+        if (result < m_buffer.size()) {
+            m_size = static_cast<int>(result);
+            return m_size > 0;
+        }
+        m_buffer.resize(m_buffer.size() * 2);
+    }
+}
+
+const char *ProcFile::data() const
+{
+    return m_buffer.constData();
+}
+
+int ProcFile::size() const
+{
+    return m_size;
+}
+
+ProcTokenizer ProcFile::tokenizer() const
+{
+    return ProcTokenizer(m_buffer.constData(), m_size);
+}
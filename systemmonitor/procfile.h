@@ -0,0 +1,83 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef PROCFILE_H
+#define PROCFILE_H
+
+#include <QByteArray>
+
+// Splits the contents of a /proc file into whitespace separated tokens without
+// copying or allocating. Tokens never span lines; nextLine() moves on to the next one.
+class ProcTokenizer
+{
+public:
+    ProcTokenizer(const char *data, int length);
+
+    bool atEnd() const;
+    bool nextLine();
+
+    bool nextToken(const char **token, int *length, char separator = '\0');
+    void skip(int count = 1);
+
+    // Parses the next token as unsigned number. Tokens in "key=value" form yield the value.
+    qulonglong nextNumber();
+
+private:
+    const char *m_position = nullptr;
+    const char *m_end = nullptr;
+};
+
+// Keeps a /proc file open and re-reads it with pread() into a buffer which is
+// only reallocated when the file outgrows it.
+class ProcFile
+{
+public:
+    explicit ProcFile(const QByteArray &path);
+    ~ProcFile();
+
+    QByteArray path() const;
+    bool isOpen() const;
+
+    bool read();
+
+    const char *data() const;
+    int size() const;
+    ProcTokenizer tokenizer() const;
+
+private:
+    Q_DISABLE_COPY(ProcFile)
+
+    QByteArray m_path;
+    int m_fd = -1;
+    QByteArray m_buffer;
+    int m_size = 0;
+};
+
+#endif // PROCFILE_H
@@ -4,6 +4,14 @@ TARGET = $$qtLibraryTarget(nymea_integrationpluginsystemmonitor)
 
 SOURCES += \
     integrationpluginsystemmonitor.cpp \
+    cgroupmonitor.cpp \
+    procfile.cpp \
+    processscanner.cpp \
+    systemsampler.cpp \
 
 HEADERS += \
     integrationpluginsystemmonitor.h \
+    cgroupmonitor.h \
+    procfile.h \
+    processscanner.h \
+    systemsampler.h \
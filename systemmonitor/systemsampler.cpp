@@ -0,0 +1,401 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "systemsampler.h"
+#include "extern-plugininfo.h"
+
+#include <cstring>
+#include <unistd.h>
+
+// Sector size used by /proc/diskstats, independent of the actual device
+static const int diskStatsSectorSize = 512;
+
+SystemSampler::SystemSampler(QObject *parent) :
+    QObject(parent),
+    m_stat("/proc/stat"),
+    m_cpuPressure("/proc/pressure/cpu"),
+    m_ioPressure("/proc/pressure/io"),
+    m_memoryPressure("/proc/pressure/memory"),
+    m_diskStats("/proc/diskstats"),
+    m_netDev("/proc/net/dev")
+{
+
+}
+
+bool SystemSampler::sampleCpu()
+{
+    if (!m_stat.read()) {
+        qCWarning(dcSystemMonitor()) << "Unable to read /proc/stat. Cannot read CPU usage";
+        return false;
+    }
+
+    // The cpu lines come first: the aggregate "cpu" followed by one "cpuN" per online core
+    ProcTokenizer tokenizer = m_stat.tokenizer();
+    do {
+        const char *token;
+        int length;
+        if (!tokenizer.nextToken(&token, &length) || length < 3 || strncmp(token, "cpu", 3) != 0) {
+            break;
+        }
+
+        // user nice system idle iowait irq softirq steal; guest time is already part of user
+        qulonglong values[8];
+        for (int i = 0; i < 8; i++) {
+            values[i] = tokenizer.nextNumber();
+        }
+        CpuCounters counters;
+        counters.work = values[0] + values[1] + values[2] + values[5] + values[6] + values[7];
+        counters.total = counters.work + values[3] + values[4];
+
+        if (length == 3) {
+            m_cpuUsage = cpuUsage(counters, m_cpuCounters);
+            m_cpuCounters = counters;
+            continue;
+        }
+
+        int core = static_cast<int>(ProcTokenizer(token + 3, length - 3).nextNumber());
+        if (core >= m_coreCounters.count()) {
+            m_coreCounters.resize(core + 1);
+            m_coreUsage.resize(core + 1);
+        }
+        m_coreUsage[core] = cpuUsage(counters, m_coreCounters.at(core));
+        m_coreCounters[core] = counters;
+    } while (tokenizer.nextLine());
+
+    return true;
+}
+
+double SystemSampler::cpuUsage() const
+{
+    return m_cpuUsage;
+}
+
+QVector<double> SystemSampler::coreUsage() const
+{
+    return m_coreUsage;
+}
+
+bool SystemSampler::samplePressure()
+{
+    bool cpu = samplePressureSource(&m_cpuPressure);
+    bool io = samplePressureSource(&m_ioPressure);
+    bool memory = samplePressureSource(&m_memoryPressure);
+    return cpu || io || memory;
+}
+
+SystemSampler::Pressure SystemSampler::cpuPressure() const
+{
+    return m_cpuPressure.pressure;
+}
+
+SystemSampler::Pressure SystemSampler::ioPressure() const
+{
+    return m_ioPressure.pressure;
+}
+
+SystemSampler::Pressure SystemSampler::memoryPressure() const
+{
+    return m_memoryPressure.pressure;
+}
+
+bool SystemSampler::sampleBlockDevices()
+{
+    if (!m_diskStats.read()) {
+        return false;
+    }
+
+    qint64 elapsed = m_diskTimer.isValid() ? m_diskTimer.restart() : 0;
+    if (!m_diskTimer.isValid()) {
+        m_diskTimer.start();
+    }
+    m_diskGeneration++;
+
+    ProcTokenizer tokenizer = m_diskStats.tokenizer();
+    do {
+        // major minor name reads merged sectors ms writes merged sectors ms in_flight io_ms ...
+        const char *name;
+        int length;
+        tokenizer.skip(2);
+        if (!tokenizer.nextToken(&name, &length)) {
+            continue;
+        }
+
+        int index = -1;
+        for (int i = 0; i < m_blockDevices.count(); i++) {
+            if (nameEquals(m_blockDevices.at(i).name, name, length)) {
+                index = i;
+                break;
+            }
+        }
+
+        if (index < 0) {
+            bool ignored = false;
+            foreach (const QByteArray &ignoredName, m_ignoredBlockDevices) {
+                if (nameEquals(ignoredName, name, length)) {
+                    ignored = true;
+                    break;
+                }
+            }
+            if (ignored) {
+                continue;
+            }
+        }
+
+        tokenizer.skip(2);
+        qulonglong sectorsRead = tokenizer.nextNumber();
+        tokenizer.skip(3);
+        qulonglong sectorsWritten = tokenizer.nextNumber();
+        tokenizer.skip(2);
+        qulonglong ioTicks = tokenizer.nextNumber();
+
+        if (index < 0) {
+            QByteArray deviceName(name, length);
+            if (!monitorBlockDevice(deviceName)) {
+                m_ignoredBlockDevices.append(deviceName);
+                continue;
+            }
+            qCDebug(dcSystemMonitor()) << "Monitoring block device" << deviceName;
+            BlockDevice device;
+            device.name = deviceName;
+            m_blockDevices.append(device);
+            BlockDeviceCounters counters;
+            counters.sectorsRead = sectorsRead;
+            counters.sectorsWritten = sectorsWritten;
+            counters.ioTicks = ioTicks;
+            counters.generation = m_diskGeneration;
+            m_blockDeviceCounters.append(counters);
+            continue;
+        }
+
+        BlockDevice &device = m_blockDevices[index];
+        BlockDeviceCounters &counters = m_blockDeviceCounters[index];
+        if (elapsed > 0) {
+            double factor = 1000.0 / elapsed;
+            device.readRate = rate(sectorsRead, counters.sectorsRead, factor * diskStatsSectorSize);
+            device.writeRate = rate(sectorsWritten, counters.sectorsWritten, factor * diskStatsSectorSize);
+            device.utilization = qMin(100.0, rate(ioTicks, counters.ioTicks, 100.0 / elapsed));
+        }
+        counters.sectorsRead = sectorsRead;
+        counters.sectorsWritten = sectorsWritten;
+        counters.ioTicks = ioTicks;
+        counters.generation = m_diskGeneration;
+    } while (tokenizer.nextLine());
+
+    for (int i = m_blockDevices.count() - 1; i >= 0; i--) {
+        if (m_blockDeviceCounters.at(i).generation != m_diskGeneration) {
+            qCDebug(dcSystemMonitor()) << "Block device" << m_blockDevices.at(i).name << "disappeared";
+            m_blockDevices.remove(i);
+            m_blockDeviceCounters.remove(i);
+        }
+    }
+    return true;
+}
+
+QVector<SystemSampler::BlockDevice> SystemSampler::blockDevices() const
+{
+    return m_blockDevices;
+}
+
+bool SystemSampler::sampleNetworkInterfaces()
+{
+    if (!m_netDev.read()) {
+        return false;
+    }
+
+    qint64 elapsed = m_netTimer.isValid() ? m_netTimer.restart() : 0;
+    if (!m_netTimer.isValid()) {
+        m_netTimer.start();
+    }
+    m_netGeneration++;
+
+    // Two header lines, then "name: rx_bytes rx_packets ... (8 receive fields) tx_bytes ..."
+    // Ignored interfaces which are gone are forgotten, virtual interfaces come and go with random names
+    QVector<QByteArray> ignoredNetworkInterfaces;
+
+    ProcTokenizer tokenizer = m_netDev.tokenizer();
+    tokenizer.nextLine();
+    tokenizer.nextLine();
+    for (; !tokenizer.atEnd(); tokenizer.nextLine()) {
+        const char *name;
+        int length;
+        if (!tokenizer.nextToken(&name, &length, ':')) {
+            continue;
+        }
+
+        int index = -1;
+        for (int i = 0; i < m_networkInterfaces.count(); i++) {
+            if (nameEquals(m_networkInterfaces.at(i).name, name, length)) {
+                index = i;
+                break;
+            }
+        }
+
+        if (index < 0) {
+            bool ignored = false;
+            foreach (const QByteArray &ignoredName, m_ignoredNetworkInterfaces) {
+                if (nameEquals(ignoredName, name, length)) {
+                    ignoredNetworkInterfaces.append(ignoredName);
+                    ignored = true;
+                    break;
+                }
+            }
+            if (ignored) {
+                continue;
+            }
+        }
+
+        qulonglong receivedBytes = tokenizer.nextNumber();
+        tokenizer.skip(7);
+        qulonglong transmittedBytes = tokenizer.nextNumber();
+
+        if (index < 0) {
+            QByteArray interfaceName(name, length);
+            if (!monitorNetworkInterface(interfaceName)) {
+                ignoredNetworkInterfaces.append(interfaceName);
+                continue;
+            }
+            NetworkInterface networkInterface;
+            networkInterface.name = interfaceName;
+            qCDebug(dcSystemMonitor()) << "Monitoring network interface" << networkInterface.name;
+            m_networkInterfaces.append(networkInterface);
+            InterfaceCounters counters;
+            counters.receivedBytes = receivedBytes;
+            counters.transmittedBytes = transmittedBytes;
+            counters.generation = m_netGeneration;
+            m_interfaceCounters.append(counters);
+            continue;
+        }
+
+        NetworkInterface &networkInterface = m_networkInterfaces[index];
+        InterfaceCounters &counters = m_interfaceCounters[index];
+        if (elapsed > 0) {
+            double factor = 1000.0 / elapsed;
+            networkInterface.receiveRate = rate(receivedBytes, counters.receivedBytes, factor);
+            networkInterface.transmitRate = rate(transmittedBytes, counters.transmittedBytes, factor);
+        }
+        counters.receivedBytes = receivedBytes;
+        counters.transmittedBytes = transmittedBytes;
+        counters.generation = m_netGeneration;
+    }
+
+    for (int i = m_networkInterfaces.count() - 1; i >= 0; i--) {
+        if (m_interfaceCounters.at(i).generation != m_netGeneration) {
+            qCDebug(dcSystemMonitor()) << "Network interface" << m_networkInterfaces.at(i).name << "disappeared";
+            m_networkInterfaces.remove(i);
+            m_interfaceCounters.remove(i);
+        }
+    }
+    m_ignoredNetworkInterfaces = ignoredNetworkInterfaces;
+    return true;
+}
+
+QVector<SystemSampler::NetworkInterface> SystemSampler::networkInterfaces() const
+{
+    return m_networkInterfaces;
+}
+
+bool SystemSampler::samplePressureSource(PressureSource *source)
+{
+    // Not available on kernels before 4.20 or when booted without psi support
+    if (!source->file.isOpen() || !source->file.read()) {
+        source->pressure.valid = false;
+        return false;
+    }
+
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=<usec>", optionally followed by a "full" line
+    qulonglong someTotal = 0;
+    qulonglong fullTotal = 0;
+    ProcTokenizer tokenizer = source->file.tokenizer();
+    do {
+        const char *token;
+        int length;
+        if (!tokenizer.nextToken(&token, &length) || length != 4) {
+            continue;
+        }
+        tokenizer.skip(3);
+        if (strncmp(token, "some", 4) == 0) {
+            someTotal = tokenizer.nextNumber();
+        } else if (strncmp(token, "full", 4) == 0) {
+            fullTotal = tokenizer.nextNumber();
+        }
+    } while (tokenizer.nextLine());
+
+    qint64 elapsed = source->timer.isValid() ? source->timer.restart() : 0;
+    if (!source->timer.isValid()) {
+        source->timer.start();
+    }
+    if (elapsed > 0) {
+        // Stall totals are in microseconds, elapsed time in milliseconds
+        double factor = 100.0 / (elapsed * 1000.0);
+        source->pressure.some = qMin(100.0, rate(someTotal, source->someTotal, factor));
+        source->pressure.full = qMin(100.0, rate(fullTotal, source->fullTotal, factor));
+        source->pressure.valid = true;
+    }
+    source->someTotal = someTotal;
+    source->fullTotal = fullTotal;
+    return true;
+}
+
+bool SystemSampler::monitorBlockDevice(const QByteArray &name)
+{
+    if (name.startsWith("loop") || name.startsWith("ram") || name.startsWith("zram")) {
+        return false;
+    }
+    // Partitions are listed in /proc/diskstats too, but only whole disks appear in /sys/block
+    return access(QByteArray("/sys/block/" + name).constData(), F_OK) == 0;
+}
+
+bool SystemSampler::monitorNetworkInterface(const QByteArray &name)
+{
+    // Only interfaces backed by a device, this skips lo, bridges, veth pairs, tunnels and friends
+    return access(QByteArray("/sys/class/net/" + name + "/device").constData(), F_OK) == 0;
+}
+
+bool SystemSampler::nameEquals(const QByteArray &name, const char *token, int length)
+{
+    return name.length() == length && memcmp(name.constData(), token, static_cast<size_t>(length)) == 0;
+}
+
+double SystemSampler::cpuUsage(const CpuCounters &current, const CpuCounters &previous)
+{
+    if (previous.total == 0 || current.total <= previous.total || current.work < previous.work) {
+        // First sample, or the counters have been reset
+        return -1;
+    }
+    return 100.0 * (current.work - previous.work) / (current.total - previous.total);
+}
+
+double SystemSampler::rate(qulonglong current, qulonglong previous, double factor)
+{
+    if (current < previous) {
+        return 0;
+    }
+    return (current - previous) * factor;
+}
@@ -0,0 +1,143 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef SYSTEMSAMPLER_H
+#define SYSTEMSAMPLER_H
+
+#include <QObject>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include "procfile.h"
+
+// Samples the host wide counters in /proc and turns them into usage percentages
+// and rates by comparing each sample with the previous one of the same source.
+class SystemSampler : public QObject
+{
+    Q_OBJECT
+public:
+    struct Pressure {
+        bool valid = false;
+        double some = 0;
+        double full = 0;
+    };
+
+    struct BlockDevice {
+        QByteArray name;
+        double readRate = 0;
+        double writeRate = 0;
+        double utilization = 0;
+    };
+
+    struct NetworkInterface {
+        QByteArray name;
+        double receiveRate = 0;
+        double transmitRate = 0;
+    };
+
+    explicit SystemSampler(QObject *parent = nullptr);
+
+    bool sampleCpu();
+    double cpuUsage() const;
+    QVector<double> coreUsage() const;
+
+    bool samplePressure();
+    Pressure cpuPressure() const;
+    Pressure ioPressure() const;
+    Pressure memoryPressure() const;
+
+    bool sampleBlockDevices();
+    QVector<BlockDevice> blockDevices() const;
+
+    bool sampleNetworkInterfaces();
+    QVector<NetworkInterface> networkInterfaces() const;
+
+private:
+    struct CpuCounters {
+        qulonglong work = 0;
+        qulonglong total = 0;
+    };
+
+    struct PressureSource {
+        explicit PressureSource(const QByteArray &path) : file(path) { }
+        ProcFile file;
+        QElapsedTimer timer;
+        qulonglong someTotal = 0;
+        qulonglong fullTotal = 0;
+        Pressure pressure;
+    };
+
+    struct BlockDeviceCounters {
+        int generation = 0;
+        qulonglong sectorsRead = 0;
+        qulonglong sectorsWritten = 0;
+        qulonglong ioTicks = 0;
+    };
+
+    struct InterfaceCounters {
+        int generation = 0;
+        qulonglong receivedBytes = 0;
+        qulonglong transmittedBytes = 0;
+    };
+
+    bool samplePressureSource(PressureSource *source);
+
+    static bool monitorBlockDevice(const QByteArray &name);
+    static bool monitorNetworkInterface(const QByteArray &name);
+    static bool nameEquals(const QByteArray &name, const char *token, int length);
+    static double cpuUsage(const CpuCounters &current, const CpuCounters &previous);
+    static double rate(qulonglong current, qulonglong previous, double factor);
+
+    ProcFile m_stat;
+    CpuCounters m_cpuCounters;
+    QVector<CpuCounters> m_coreCounters;
+    double m_cpuUsage = -1;
+    QVector<double> m_coreUsage;
+
+    PressureSource m_cpuPressure;
+    PressureSource m_ioPressure;
+    PressureSource m_memoryPressure;
+
+    ProcFile m_diskStats;
+    QElapsedTimer m_diskTimer;
+    QVector<BlockDevice> m_blockDevices;
+    QVector<BlockDeviceCounters> m_blockDeviceCounters;
+    QVector<QByteArray> m_ignoredBlockDevices;
+    int m_diskGeneration = 0;
+
+    ProcFile m_netDev;
+    QElapsedTimer m_netTimer;
+    QVector<NetworkInterface> m_networkInterfaces;
+    QVector<InterfaceCounters> m_interfaceCounters;
+    QVector<QByteArray> m_ignoredNetworkInterfaces;
+    int m_netGeneration = 0;
+};
+
+#endif // SYSTEMSAMPLER_H
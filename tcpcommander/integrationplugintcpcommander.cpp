@@ -88,12 +88,15 @@ void IntegrationPluginTcpCommander::setupThing(ThingSetupInfo *info)
 
         tcpServer = new TcpServer(port, this);
         tcpServer->setConfirmCommands(thing->setting(tcpServerSettingsConfirmCommandParamTypeId).toBool());
+        tcpServer->setFramer(framerFromSettings(thing));
 
         if (tcpServer->isValid()) {
             m_tcpServers.insert(thing, tcpServer);
             connect(thing, &Thing::settingChanged, tcpServer, [=](const ParamTypeId &paramTypeId, const QVariant &value){
                 if (paramTypeId == tcpServerSettingsConfirmCommandParamTypeId) {
                     tcpServer->setConfirmCommands(value.toBool());
+                } else {
+                    tcpServer->setFramer(framerFromSettings(thing));
                 }
             });
 
@@ -188,3 +191,13 @@ void IntegrationPluginTcpCommander::onTcpServerCommandReceived(const QString &cl
     params.append(Param(tcpServerTriggeredEventClientIpParamTypeId, clientIp));
     emit emitEvent(Event(tcpServerTriggeredEventTypeId, thing->id(), params));
 }
+
+MessageFramer IntegrationPluginTcpCommander::framerFromSettings(Thing *thing) const
+{
+    MessageFramer framer(MessageFramer::modeFromString(thing->setting(tcpServerSettingsFramingParamTypeId).toString()));
+    framer.setDelimiter(MessageFramer::unescape(thing->setting(tcpServerSettingsDelimiterParamTypeId).toString()));
+    framer.setFrameLength(thing->setting(tcpServerSettingsFrameLengthParamTypeId).toInt());
+    framer.setPrefixSize(thing->setting(tcpServerSettingsLengthPrefixSizeParamTypeId).toInt());
+    framer.setIdleTimeout(thing->setting(tcpServerSettingsIdleTimeoutParamTypeId).toInt());
+    return framer;
+}
@@ -54,6 +54,8 @@ private:
     QHash<Thing*, QTcpSocket*> m_tcpSockets;
     QHash<Thing*, TcpServer*> m_tcpServers;
 
+    MessageFramer framerFromSettings(Thing *thing) const;
+
 private slots:
     void onTcpSocketConnectionChanged(bool connected);
 
@@ -0,0 +1,286 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "messageframer.h"
+
+MessageFramer::MessageFramer(Mode mode) :
+    m_mode(mode)
+{
+
+}
+
+MessageFramer::Mode MessageFramer::mode() const
+{
+    return m_mode;
+}
+
+void MessageFramer::setMode(Mode mode)
+{
+    m_mode = mode;
+    clear();
+}
+
+QByteArray MessageFramer::delimiter() const
+{
+    return m_delimiter;
+}
+
+void MessageFramer::setDelimiter(const QByteArray &delimiter)
+{
+    m_delimiter = delimiter;
+    clear();
+}
+
+int MessageFramer::frameLength() const
+{
+    return m_frameLength;
+}
+
+void MessageFramer::setFrameLength(int frameLength)
+{
+    m_frameLength = qMax(1, frameLength);
+    clear();
+}
+
+int MessageFramer::prefixSize() const
+{
+    return m_prefixSize;
+}
+
+void MessageFramer::setPrefixSize(int prefixSize)
+{
+    m_prefixSize = qBound(1, prefixSize, 4);
+    clear();
+}
+
+int MessageFramer::idleTimeout() const
+{
+    return m_idleTimeout;
+}
+
+void MessageFramer::setIdleTimeout(int idleTimeout)
+{
+    m_idleTimeout = qMax(1, idleTimeout);
+}
+
+int MessageFramer::maxFrameSize() const
+{
+    return m_maxFrameSize;
+}
+
+void MessageFramer::setMaxFrameSize(int maxFrameSize)
+{
+    m_maxFrameSize = maxFrameSize;
+}
+
+QList<QByteArray> MessageFramer::feed(const QByteArray &data)
+{
+    QList<QByteArray> messages;
+    if (m_error || data.isEmpty())
+        return messages;
+
+    if (m_mode == ModeNone || (m_mode == ModeDelimiter && m_delimiter.isEmpty())) {
+        messages.append(data);
+        return messages;
+    }
+
+    m_buffer.append(data);
+
+    // Messages are copied out of the buffer and the consumed part is removed once at the end
+    int position = 0;
+    switch (m_mode) {
+    case ModeDelimiter:
+        forever {
+            int index = m_buffer.indexOf(m_delimiter, qMax(position, m_scanOffset));
+            if (index < 0)
+                break;
+
+            messages.append(m_buffer.mid(position, index - position));
+            position = index + m_delimiter.size();
+        }
+        // The already scanned bytes can't contain a delimiter, except for the start of one split between two reads
+        m_scanOffset = qMax(0, m_buffer.size() - position - m_delimiter.size() + 1);
+        if (m_buffer.size() - position > m_maxFrameSize)
+            m_error = true;
+
+        break;
+    case ModeFixedLength:
+        while (m_buffer.size() - position >= m_frameLength) {
+            messages.append(m_buffer.mid(position, m_frameLength));
+            position += m_frameLength;
+        }
+        break;
+    case ModeLengthPrefix:
+        while (m_buffer.size() - position >= m_prefixSize) {
+            quint32 length = 0;
+            for (int i = 0; i < m_prefixSize; i++)
+                length = (length << 8) | static_cast<quint8>(m_buffer.at(position + i));
+
+            if (length > static_cast<quint32>(m_maxFrameSize)) {
+                m_error = true;
+                break;
+            }
+
+            if (m_buffer.size() - position - m_prefixSize < static_cast<int>(length))
+                break;
+
+            messages.append(m_buffer.mid(position + m_prefixSize, static_cast<int>(length)));
+            position += m_prefixSize + static_cast<int>(length);
+        }
+        break;
+    case ModeIdleTimeout:
+        if (m_buffer.size() >= m_maxFrameSize)
+            messages.append(flush());
+
+        break;
+    case ModeNone:
+        break;
+    }
+
+    if (m_error) {
+        clear();
+        m_error = true;
+        return QList<QByteArray>();
+    }
+
+    if (position > 0)
+        m_buffer.remove(0, position);
+
+    return messages;
+}
+
+QByteArray MessageFramer::flush()
+{
+    QByteArray message = m_buffer;
+    m_buffer.clear();
+    m_scanOffset = 0;
+    return message;
+}
+
+void MessageFramer::clear()
+{
+    m_buffer.clear();
+    m_scanOffset = 0;
+    m_error = false;
+}
+
+int MessageFramer::bufferedSize() const
+{
+    return m_buffer.size();
+}
+
+bool MessageFramer::hasError() const
+{
+    return m_error;
+}
+
+QByteArray MessageFramer::encode(const QByteArray &message) const
+{
+    switch (m_mode) {
+    case ModeDelimiter:
+        if (message.endsWith(m_delimiter))
+            return message;
+
+        return message + m_delimiter;
+    case ModeLengthPrefix: {
+        if (m_prefixSize < 4 && message.size() >= (1 << (8 * m_prefixSize)))
+            return QByteArray();
+
+        QByteArray frame(m_prefixSize, 0);
+        for (int i = 0; i < m_prefixSize; i++)
+            frame[m_prefixSize - 1 - i] = static_cast<char>((message.size() >> (8 * i)) & 0xff);
+
+        frame.append(message);
+        return frame;
+    }
+    default:
+        return message;
+    }
+}
+
+MessageFramer::Mode MessageFramer::modeFromString(const QString &mode)
+{
+    if (mode == "Delimiter")
+        return ModeDelimiter;
+
+    if (mode == "Fixed length")
+        return ModeFixedLength;
+
+    if (mode == "Length prefix")
+        return ModeLengthPrefix;
+
+    if (mode == "Idle timeout")
+        return ModeIdleTimeout;
+
+    return ModeNone;
+}
+
+QByteArray MessageFramer::unescape(const QString &text)
+{
+    QByteArray escaped = text.toUtf8();
+    QByteArray result;
+    for (int i = 0; i < escaped.size(); i++) {
+        if (escaped.at(i) != '\\' || i + 1 >= escaped.size()) {
+            result.append(escaped.at(i));
+            continue;
+        }
+
+        char c = escaped.at(++i);
+        switch (c) {
+        case 'n':
+            result.append('\n');
+            break;
+        case 'r':
+            result.append('\r');
+            break;
+        case 't':
+            result.append('\t');
+            break;
+        case '0':
+            result.append('\0');
+            break;
+        case 'x': {
+            bool ok = false;
+            char value = static_cast<char>(escaped.mid(i + 1, 2).toUInt(&ok, 16));
+            if (ok && i + 2 < escaped.size()) {
+                result.append(value);
+                i += 2;
+            } else {
+                result.append("\\x");
+            }
+            break;
+        }
+        default:
+            result.append(c);
+            break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef MESSAGEFRAMER_H
+#define MESSAGEFRAMER_H
+
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+// Splits a byte stream into messages. Every connection needs its own framer since it buffers
+// incomplete messages until the rest arrives.
+class MessageFramer
+{
+public:
+    enum Mode {
+        ModeNone,           // Every read is one message
+        ModeDelimiter,      // Messages end with the delimiter
+        ModeFixedLength,    // Messages have frameLength bytes
+        ModeLengthPrefix,   // Messages start with their length as big endian integer of prefixSize bytes
+        ModeIdleTimeout     // Messages end when no data arrives for idleTimeout ms, flushed by the owner
+    };
+
+    MessageFramer(Mode mode = ModeNone);
+
+    Mode mode() const;
+    void setMode(Mode mode);
+
+    QByteArray delimiter() const;
+    void setDelimiter(const QByteArray &delimiter);
+
+    int frameLength() const;
+    void setFrameLength(int frameLength);
+
+    int prefixSize() const;
+    void setPrefixSize(int prefixSize);
+
+    int idleTimeout() const;
+    void setIdleTimeout(int idleTimeout);
+
+    int maxFrameSize() const;
+    void setMaxFrameSize(int maxFrameSize);
+
+    // Appends data to the buffer and returns all messages completed by it. Returns nothing and
+    // sets hasError() if the stream can't be framed any more, e.g. a message exceeds maxFrameSize.
+    QList<QByteArray> feed(const QByteArray &data);
+    // Returns the buffered incomplete message and clears the buffer
+    QByteArray flush();
+    void clear();
+
+    int bufferedSize() const;
+    bool hasError() const;
+
+    // Frames a message for sending
+    QByteArray encode(const QByteArray &message) const;
+
+    static Mode modeFromString(const QString &mode);
+    // Resolves escape sequences like \n, \r, \t, \\ and \xHH
+    static QByteArray unescape(const QString &text);
+
+private:
+    Mode m_mode = ModeNone;
+    QByteArray m_delimiter = "\n";
+    int m_frameLength = 16;
+    int m_prefixSize = 2;
+    int m_idleTimeout = 100;
+    int m_maxFrameSize = 65536;
+
+    QByteArray m_buffer;
+    int m_scanOffset = 0;
+    bool m_error = false;
+};
+
+#endif // MESSAGEFRAMER_H
@@ -6,8 +6,10 @@ TARGET = $$qtLibraryTarget(nymea_integrationplugintcpcommander)
 
 SOURCES += \
     integrationplugintcpcommander.cpp \
-    tcpserver.cpp
+    tcpserver.cpp \
+    messageframer.cpp
 
 HEADERS += \
     integrationplugintcpcommander.h \
-    tcpserver.h
+    tcpserver.h \
+    messageframer.h
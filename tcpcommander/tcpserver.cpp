@@ -59,6 +59,11 @@ TcpServer::TcpServer(const quint16 &port, QObject *parent) :
 
 TcpServer::~TcpServer()
 {
+    foreach (Client *client, m_clients) {
+        delete client->idleTimer;
+        client->socket->disconnect(this);
+        delete client;
+    }
 }
 
 bool TcpServer::isValid() const
@@ -86,6 +91,22 @@ int TcpServer::serverPort()
     return m_tcpServer->serverPort();
 }
 
+MessageFramer TcpServer::framer() const
+{
+    return m_framer;
+}
+
+void TcpServer::setFramer(const MessageFramer &framer)
+{
+    m_framer = framer;
+    m_framer.clear();
+    foreach (Client *client, m_clients) {
+        client->framer = m_framer;
+        client->idleTimer->stop();
+        client->idleTimer->setInterval(m_framer.idleTimeout());
+    }
+}
+
 int TcpServer::connectionCount() const
 {
     return m_clients.count();
@@ -93,16 +114,37 @@ int TcpServer::connectionCount() const
 
 bool TcpServer::sendCommand(const QString &clientIp, const QByteArray &data)
 {
+    // Frame the data once, all clients share the encoded buffer
+    QByteArray frame = m_framer.encode(data);
+    if (frame.isEmpty() && !data.isEmpty()) {
+        qCWarning(dcTCPCommander()) << "Message too long for the configured length prefix:" << data.length() << "bytes";
+        return false;
+    }
+
+    QString host = clientIp.trimmed();
+    quint16 port = 0;
+    if (host.startsWith('[') && host.contains("]:")) {
+        port = host.section("]:", 1).toUShort();
+        host = host.section("]:", 0, 0).mid(1);
+    } else if (host.count(':') == 1) {
+        port = host.section(':', 1).toUShort();
+        host = host.section(':', 0, 0);
+    }
+    QHostAddress address = normalizedAddress(QHostAddress(host));
+
     bool success = false;
-    QHostAddress address(clientIp);
-    bool broadcast = false;
-    if (address == QHostAddress(QHostAddress::AnyIPv4) || address == QHostAddress(QHostAddress::Broadcast))
-        broadcast = true;
-
-    foreach (QTcpSocket *client, m_clients) {
-        if (broadcast || client->peerAddress() == address) {
-            qint64 len = client->write(data);
-            if (len == data.length()) {
+    if (address == QHostAddress(QHostAddress::AnyIPv4) || address == QHostAddress(QHostAddress::Broadcast)) {
+        foreach (Client *client, m_clients) {
+            if (write(client, frame)) {
+                success = true;
+            }
+        }
+    } else if (port != 0) {
+        Client *client = m_clients.value(ClientKey(address, port));
+        success = client && write(client, frame);
+    } else {
+        foreach (Client *client, m_clientsByAddress.values(address)) {
+            if (write(client, frame)) {
                 success = true;
             }
         }
@@ -117,36 +159,94 @@ void TcpServer::newConnection()
     QTcpSocket *socket = m_tcpServer->nextPendingConnection();
     socket->flush();
 
-    m_clients.append(socket);
+    Client *client = new Client();
+    client->socket = socket;
+    client->key = ClientKey(normalizedAddress(socket->peerAddress()), socket->peerPort());
+    client->framer = m_framer;
+    client->idleTimer = new QTimer(socket);
+    client->idleTimer->setSingleShot(true);
+    client->idleTimer->setInterval(m_framer.idleTimeout());
+    connect(client->idleTimer, &QTimer::timeout, this, [this, client](){
+        QByteArray message = client->framer.flush();
+        if (!message.isEmpty()) {
+            processMessage(client, message);
+        }
+    });
+
+    m_clients.insert(client->key, client);
+    m_clientsByAddress.insert(client->key.first, client);
     emit connectionCountChanged(m_clients.count());
-    connect(socket, &QTcpSocket::disconnected, this, &TcpServer::onDisconnected);
-    connect(socket, &QTcpSocket::readyRead, this, &TcpServer::readData);
+    connect(socket, &QTcpSocket::disconnected, this, [this, client](){
+        onDisconnected(client);
+    });
+    connect(socket, &QTcpSocket::readyRead, this, [this, client](){
+        readData(client);
+    });
     // Note: error signal will be interpreted as function, not as signal in C++11
     connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(onError(QAbstractSocket::SocketError)));
 }
 
-void TcpServer::onDisconnected()
+void TcpServer::onError(QAbstractSocket::SocketError error)
+{
+    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
+    qWarning(dcTCPCommander()) << "Socket Error" << socket->errorString() << error;
+}
+
+void TcpServer::onDisconnected(Client *client)
 {
-    QTcpSocket *client = qobject_cast<QTcpSocket*>(sender());
     qDebug(dcTCPCommander()) << "TCP client disconnected";
-    m_clients.removeAll(client);
+    m_clients.remove(client->key);
+    m_clientsByAddress.remove(client->key.first, client);
+    // The timer would outlive the client until the socket gets deleted
+    delete client->idleTimer;
+    client->socket->disconnect(this);
+    client->socket->deleteLater();
+    delete client;
     emit connectionCountChanged(m_clients.count());
 }
 
-void TcpServer::readData()
+void TcpServer::readData(Client *client)
 {
-    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
-    QByteArray data = socket->readAll();
+    QByteArray data = client->socket->readAll();
     qDebug(dcTCPCommander()) << "TCP Server data received: " << data;
+
+    foreach (const QByteArray &message, client->framer.feed(data)) {
+        processMessage(client, message);
+    }
+
+    if (client->framer.hasError()) {
+        qCWarning(dcTCPCommander()) << "Invalid message framing from" << client->socket->peerAddress().toString() << "closing the connection";
+        client->socket->abort();
+        return;
+    }
+
+    if (client->framer.mode() == MessageFramer::ModeIdleTimeout && client->framer.bufferedSize() > 0) {
+        client->idleTimer->start();
+    }
+}
+
+void TcpServer::processMessage(Client *client, const QByteArray &message)
+{
     if (m_confirmCommands) {
-        socket->write("OK\n");
+        write(client, m_framer.mode() == MessageFramer::ModeNone ? QByteArray("OK\n") : m_framer.encode("OK"));
     }
 
-    emit commandReceived(socket->peerAddress().toString(), data);
+    emit commandReceived(client->socket->peerAddress().toString(), message);
 }
 
-void TcpServer::onError(QAbstractSocket::SocketError error)
+bool TcpServer::write(Client *client, const QByteArray &data)
 {
-    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
-    qWarning(dcTCPCommander()) << "Socket Error" << socket->errorString() << error;
+    qint64 len = client->socket->write(data);
+    return len == data.length();
+}
+
+QHostAddress TcpServer::normalizedAddress(const QHostAddress &address)
+{
+    // IPv4 clients of a dual stack server show up as IPv4 mapped IPv6 addresses
+    bool isIPv4 = false;
+    quint32 ipv4Address = address.toIPv4Address(&isIPv4);
+    if (isIPv4 && address.protocol() == QAbstractSocket::IPv6Protocol) {
+        return QHostAddress(ipv4Address);
+    }
+    return address;
 }
@@ -34,6 +34,11 @@
 #include <QObject>
 #include <QTcpSocket>
 #include <QTcpServer>
+#include <QTimer>
+#include <QHash>
+#include <QPair>
+
+#include "messageframer.h"
 
 class TcpServer : public QObject
 {
@@ -52,8 +57,14 @@ public:
     bool confirmCommands() const;
     void setConfirmCommands(bool confirmCommands);
 
+    // Framing of received and sent messages, buffers of connected clients are reset
+    MessageFramer framer() const;
+    void setFramer(const MessageFramer &framer);
+
     int connectionCount() const;
 
+    // The client is given as "address" for all connections of a host, as "address:port"
+    // ("[address]:port" for IPv6) for a single connection, or 0.0.0.0 for all clients
     bool sendCommand(const QString &clientIp, const QByteArray &data);
 
 signals:
@@ -63,15 +74,30 @@ signals:
 
 private slots:
     void newConnection();
-    void onDisconnected();
-    void readData();
     void onError(QAbstractSocket::SocketError error);
 
 private:
+    typedef QPair<QHostAddress, quint16> ClientKey;
+
+    struct Client {
+        QTcpSocket *socket = nullptr;
+        ClientKey key;
+        MessageFramer framer;
+        QTimer *idleTimer = nullptr;
+    };
+
     QTcpServer *m_tcpServer = nullptr;
     bool m_confirmCommands = false;
-    QList<QTcpSocket*> m_clients;
+    MessageFramer m_framer;
+    QHash<ClientKey, Client *> m_clients;
+    QMultiHash<QHostAddress, Client *> m_clientsByAddress;
+
+    void onDisconnected(Client *client);
+    void readData(Client *client);
+    void processMessage(Client *client, const QByteArray &message);
+    bool write(Client *client, const QByteArray &data);
 
+    static QHostAddress normalizedAddress(const QHostAddress &address);
 };
 
 #endif // TCPSERVER_H
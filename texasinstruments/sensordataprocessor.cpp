@@ -66,22 +66,20 @@ SensorDataProcessor::SensorDataProcessor(Thing *thing, QObject *parent) :
     m_accelerometerFilter->setLowPassAlpha(0.6);
     m_accelerometerFilter->setFilterWindowSize(40);
 
-    // Check if the data should be logged
-    if (m_filterDebug) {
-        m_logFile = new QFile("/tmp/multisensor.log", this);
-        if (!m_logFile->open(QIODevice::Append | QIODevice::Text)) {
-            qCWarning(dcTexasInstruments()) << "Could not open log file" << m_logFile->fileName();
-            delete m_logFile;
-            m_logFile = nullptr;
+    // Record the raw sensor frames for diagnostics and offline replay
+    if (m_recordSensorData) {
+        QString address = m_thing->paramValue(sensorTagThingMacParamTypeId).toString().remove(':').toLower();
+        m_recorder = new SensorRecorder(QString("/tmp/sensortag-%1.rec").arg(address));
+        if (!m_recorder->open()) {
+            delete m_recorder;
+            m_recorder = nullptr;
         }
     }
 }
 
 SensorDataProcessor::~SensorDataProcessor()
 {
-    if (m_logFile) {
-        m_logFile->close();
-    }
+    delete m_recorder;
 }
 
 void SensorDataProcessor::setAccelerometerRange(int accelerometerRange)
@@ -107,6 +105,8 @@ bool SensorDataProcessor::testBitUint8(quint8 value, int bitPosition)
 
 void SensorDataProcessor::processTemperatureData(const QByteArray &data)
 {
+    recordFrame(SensorRecorder::FrameTypeTemperature, data);
+
     Q_ASSERT(data.count() == 4);
 
     quint16 rawObjectTemperature = 0;
@@ -141,6 +141,8 @@ void SensorDataProcessor::processTemperatureData(const QByteArray &data)
 
 void SensorDataProcessor::processKeyData(const QByteArray &data)
 {
+    recordFrame(SensorRecorder::FrameTypeKeys, data);
+
     Q_ASSERT(data.count() == 1);
     quint8 flags = static_cast<quint8>(data.at(0));
     setLeftButtonPressed(testBitUint8(flags, 0));
@@ -150,6 +152,8 @@ void SensorDataProcessor::processKeyData(const QByteArray &data)
 
 void SensorDataProcessor::processHumidityData(const QByteArray &data)
 {
+    recordFrame(SensorRecorder::FrameTypeHumidity, data);
+
     Q_ASSERT(data.count() == 4);
     quint16 rawHumidityTemperature = 0;
     quint16 rawHumidity = 0;
@@ -171,6 +175,8 @@ void SensorDataProcessor::processHumidityData(const QByteArray &data)
 
 void SensorDataProcessor::processPressureData(const QByteArray &data)
 {
+    recordFrame(SensorRecorder::FrameTypePressure, data);
+
     Q_ASSERT(data.count() == 6);
 
     QByteArray temperatureData(data.left(3));
@@ -199,6 +205,8 @@ void SensorDataProcessor::processPressureData(const QByteArray &data)
 
 void SensorDataProcessor::processOpticalData(const QByteArray &data)
 {
+    recordFrame(SensorRecorder::FrameTypeOptical, data);
+
     Q_ASSERT(data.count() == 2);
 
     quint16 rawOptical = 0;
@@ -218,12 +226,12 @@ void SensorDataProcessor::processOpticalData(const QByteArray &data)
     if (m_opticalFilter->isReady()) {
         m_thing->setStateValue(sensorTagLightIntensityStateTypeId, qRound(luxFiltered));
     }
-
-    logSensorValue(lux, qRound(luxFiltered));
 }
 
 void SensorDataProcessor::processMovementData(const QByteArray &data)
 {
+    recordFrame(SensorRecorder::FrameTypeMovement, data);
+
     //qCDebug(dcTexasInstruments()) << "--> Movement value" << data.toHex();
 
     QByteArray payload(data);
@@ -281,6 +289,32 @@ void SensorDataProcessor::processMovementData(const QByteArray &data)
     m_lastAccelerometerVectorLenght = filteredVectorLength;
 }
 
+void SensorDataProcessor::processFrame(const SensorRecorder::Frame &frame)
+{
+    m_replaying = true;
+    switch (frame.type) {
+    case SensorRecorder::FrameTypeTemperature:
+        processTemperatureData(frame.data);
+        break;
+    case SensorRecorder::FrameTypeHumidity:
+        processHumidityData(frame.data);
+        break;
+    case SensorRecorder::FrameTypePressure:
+        processPressureData(frame.data);
+        break;
+    case SensorRecorder::FrameTypeOptical:
+        processOpticalData(frame.data);
+        break;
+    case SensorRecorder::FrameTypeKeys:
+        processKeyData(frame.data);
+        break;
+    case SensorRecorder::FrameTypeMovement:
+        processMovementData(frame.data);
+        break;
+    }
+    m_replaying = false;
+}
+
 void SensorDataProcessor::reset()
 {
     m_lastAccelerometerVectorLenght = -99999;
@@ -324,14 +358,10 @@ void SensorDataProcessor::setMagnetDetected(bool detected)
     m_thing->setStateValue(sensorTagMagnetDetectedStateTypeId, m_magnetDetected);
 }
 
-void SensorDataProcessor::logSensorValue(double originalValue, double filteredValue)
+void SensorDataProcessor::recordFrame(SensorRecorder::FrameType type, const QByteArray &data)
 {
-    if (!m_filterDebug || !m_logFile)
+    if (!m_recorder || m_replaying)
         return;
 
-    QString logLine = QString("%1 %2 %3\n").arg(QDateTime::currentDateTime().toTime_t()).arg(originalValue).arg(filteredValue);
-
-    QTextStream logStream(m_logFile);
-    logStream.setCodec("UTF-8");
-    logStream << logLine;
+    m_recorder->record(type, data);
 }
@@ -31,13 +31,13 @@
 #ifndef SENSORDATAPROCESSOR_H
 #define SENSORDATAPROCESSOR_H
 
-#include <QFile>
 #include <QObject>
 
 #include "integrations/thing.h"
 #include "extern-plugininfo.h"
 
 #include "sensorfilter.h"
+#include "sensorrecorder.h"
 
 class SensorDataProcessor : public QObject
 {
@@ -59,6 +59,9 @@ public:
     void processOpticalData(const QByteArray &data);
     void processMovementData(const QByteArray &data);
 
+    // Process a recorded frame, for replaying recordings offline
+    void processFrame(const SensorRecorder::Frame &frame);
+
     void reset();
 
 private:
@@ -72,10 +75,11 @@ private:
     bool m_rightButtonPressed = false;
     bool m_magnetDetected = false;
 
-    // Log sensor data for debugging filters
-    // Note: set this to true for enable sensor filter logging
-    bool m_filterDebug = true;
-    QFile *m_logFile = nullptr;
+    // Record the raw sensor frames into /tmp/sensortag-<address>.rec
+    // Note: set this to false to disable the sensor recording
+    bool m_recordSensorData = true;
+    bool m_replaying = false;
+    SensorRecorder *m_recorder = nullptr;
 
     SensorFilter *m_temperatureFilter = nullptr;
     SensorFilter *m_objectTemperatureFilter = nullptr;
@@ -89,7 +93,7 @@ private:
     void setRightButtonPressed(bool pressed);
     void setMagnetDetected(bool detected);
 
-    void logSensorValue(double originalValue, double filteredValue);
+    void recordFrame(SensorRecorder::FrameType type, const QByteArray &data);
 
 
 signals:
@@ -31,44 +31,66 @@
 #include "sensorfilter.h"
 
 #include <QDebug>
+#include <QtMath>
 
 SensorFilter::SensorFilter(Type filterType, QObject *parent) :
     QObject(parent),
     m_filterType(filterType)
 {
-
+    setFilterWindowSize(m_filterWindowSize);
+    setLowPassAlpha(m_lowPassAlpha);
+    setHighPassAlpha(m_highPassAlpha);
 }
 
 float SensorFilter::filterValue(float value)
 {
-    float resultValue =  value;
+    int slot = static_cast<int>(m_sampleCount % m_filterWindowSize);
+    if (m_sampleCount >= m_filterWindowSize) {
+        m_averageSum -= m_inputData.at(slot);
+    }
+    m_inputData[slot] = value;
+    m_averageSum += value;
+
+    pushMonotonic(m_minimumQueue, value, true);
+    pushMonotonic(m_maximumQueue, value, false);
+
+    float resultValue = value;
     switch (m_filterType) {
     case TypeLowPass:
-        resultValue = lowPassFilterValue(value);
-        break;
     case TypeHighPass:
-        resultValue = highPassFilterValue(value);
+        resultValue = processBiquad(value);
         break;
     case TypeAverage:
-        resultValue = averageFilterValue(value);
+        resultValue = static_cast<float>(m_averageSum / qMin<quint64>(m_sampleCount + 1, m_filterWindowSize));
         break;
-    default:
+    case TypeMinimum:
+        resultValue = inputAt(m_minimumQueue.samples.at(m_minimumQueue.head));
+        break;
+    case TypeMaximum:
+        resultValue = inputAt(m_maximumQueue.samples.at(m_maximumQueue.head));
         break;
     }
 
+    m_outputData[slot] = resultValue;
+    m_sampleCount++;
     return resultValue;
 }
 
 bool SensorFilter::isReady() const
 {
     // Note: filter is ready once 10% of window filled
-    return m_inputData.size() >= m_filterWindowSize * 0.1;
+    return windowCount() >= m_filterWindowSize * 0.1;
 }
 
 void SensorFilter::reset()
 {
+    m_sampleCount = 0;
     m_averageSum = 0;
-    m_inputData.clear();
+    m_minimumQueue.head = 0;
+    m_minimumQueue.count = 0;
+    m_maximumQueue.head = 0;
+    m_maximumQueue.count = 0;
+    m_biquad.x1 = m_biquad.x2 = m_biquad.y1 = m_biquad.y2 = 0;
 }
 
 SensorFilter::Type SensorFilter::filterType() const
@@ -78,12 +100,46 @@ SensorFilter::Type SensorFilter::filterType() const
 
 QVector<float> SensorFilter::inputData() const
 {
-    return m_inputData;
+    QVector<float> inputData;
+    inputData.reserve(windowCount());
+    for (quint64 sample = m_sampleCount - windowCount(); sample < m_sampleCount; sample++) {
+        inputData.append(inputAt(sample));
+    }
+    return inputData;
 }
 
 QVector<float> SensorFilter::outputData() const
 {
-    return m_outputData;
+    QVector<float> outputData;
+    outputData.reserve(windowCount());
+    for (quint64 sample = m_sampleCount - windowCount(); sample < m_sampleCount; sample++) {
+        outputData.append(m_outputData.at(static_cast<int>(sample % m_filterWindowSize)));
+    }
+    return outputData;
+}
+
+float SensorFilter::average() const
+{
+    if (m_sampleCount == 0)
+        return 0;
+
+    return static_cast<float>(m_averageSum / windowCount());
+}
+
+float SensorFilter::minimum() const
+{
+    if (m_minimumQueue.count == 0)
+        return 0;
+
+    return inputAt(m_minimumQueue.samples.at(m_minimumQueue.head));
+}
+
+float SensorFilter::maximum() const
+{
+    if (m_maximumQueue.count == 0)
+        return 0;
+
+    return inputAt(m_maximumQueue.samples.at(m_maximumQueue.head));
 }
 
 uint SensorFilter::windowSize() const
@@ -95,6 +151,13 @@ void SensorFilter::setFilterWindowSize(uint windowSize)
 {
     Q_ASSERT_X(windowSize > 0, "value out of range", "The filter window size must be bigger than 0");
     m_filterWindowSize = windowSize;
+
+    // Buffers are only allocated here, filtering values never allocates
+    m_inputData.fill(0, static_cast<int>(windowSize));
+    m_outputData.fill(0, static_cast<int>(windowSize));
+    m_minimumQueue.samples.fill(0, static_cast<int>(windowSize));
+    m_maximumQueue.samples.fill(0, static_cast<int>(windowSize));
+    reset();
 }
 
 float SensorFilter::lowPassAlpha() const
@@ -106,6 +169,11 @@ void SensorFilter::setLowPassAlpha(float alpha)
 {
     Q_ASSERT_X(alpha > 0 && alpha <= 1, "value out of range", "The alpha low pass filter value must be [ 0 < alpha <= 1 ]");
     m_lowPassAlpha = alpha;
+
+    // y[i] := y[i-1] + α * (x[i] - y[i-1])
+    if (m_filterType == TypeLowPass) {
+        setBiquadCoefficients(alpha, 0, 0, 1, alpha - 1, 0);
+    }
 }
 
 float SensorFilter::highPassAlpha() const
@@ -117,70 +185,94 @@ void SensorFilter::setHighPassAlpha(float alpha)
 {
     Q_ASSERT_X(alpha > 0 && alpha <= 1, "value out of range", "The alpha high pass filter value must be [ 0 < alpha <= 1 ]");
     m_highPassAlpha = alpha;
-}
 
-void SensorFilter::addInputValue(float value)
-{
-    m_inputData.append(value);
-    if (static_cast<uint>(m_inputData.size()) > m_filterWindowSize) {
-        m_inputData.removeFirst();
+    // y[i] := α * y[i-1] + α * (x[i] - x[i-1])
+    if (m_filterType == TypeHighPass) {
+        setBiquadCoefficients(alpha, -alpha, 0, 1, -alpha, 0);
     }
 }
 
-float SensorFilter::lowPassFilterValue(float value)
+void SensorFilter::setLowPassCutoff(float cutoffFrequency, float sampleRate, float q)
 {
-    addInputValue(value);
+    Q_ASSERT_X(cutoffFrequency > 0 && cutoffFrequency < sampleRate / 2, "value out of range", "The cutoff frequency must be [ 0 < cutoff < sample rate / 2 ]");
+    if (m_filterType != TypeLowPass)
+        return;
 
-    // Check if we have enough data for filtering
-    if (m_inputData.size() < 2) {
-        return value;
-    }
+    double omega = 2 * M_PI * cutoffFrequency / sampleRate;
+    double alpha = qSin(omega) / (2 * q);
+    double cosine = qCos(omega);
+    setBiquadCoefficients((1 - cosine) / 2, 1 - cosine, (1 - cosine) / 2, 1 + alpha, -2 * cosine, 1 - alpha);
+}
 
-    QVector<float> outputData;
-    outputData.append(m_inputData.at(0));
-    for (int i = 1; i < m_inputData.size(); i++) {
-        // y[i] := y[i-1] + α * (x[i] - y[i-1])
-        outputData.append(outputData.at(i - 1) + m_lowPassAlpha * (m_inputData.at(i) - outputData.at(i - 1)));
-    }
+void SensorFilter::setHighPassCutoff(float cutoffFrequency, float sampleRate, float q)
+{
+    Q_ASSERT_X(cutoffFrequency > 0 && cutoffFrequency < sampleRate / 2, "value out of range", "The cutoff frequency must be [ 0 < cutoff < sample rate / 2 ]");
+    if (m_filterType != TypeHighPass)
+        return;
 
-    m_outputData = outputData;
+    double omega = 2 * M_PI * cutoffFrequency / sampleRate;
+    double alpha = qSin(omega) / (2 * q);
+    double cosine = qCos(omega);
+    setBiquadCoefficients((1 + cosine) / 2, -(1 + cosine), (1 + cosine) / 2, 1 + alpha, -2 * cosine, 1 - alpha);
+}
 
-    return m_outputData.last();
+int SensorFilter::windowCount() const
+{
+    return static_cast<int>(qMin<quint64>(m_sampleCount, m_filterWindowSize));
 }
 
-float SensorFilter::highPassFilterValue(float value)
+float SensorFilter::inputAt(quint64 sample) const
 {
-    addInputValue(value);
+    return m_inputData.at(static_cast<int>(sample % m_filterWindowSize));
+}
 
-    // Check if we have enough data for filtering
-    if (m_inputData.size() < 2) {
-        return value;
+void SensorFilter::pushMonotonic(MonotonicQueue &queue, float value, bool minimum)
+{
+    int capacity = queue.samples.size();
+
+    // The front sample leaves the window
+    if (queue.count > 0 && m_sampleCount - queue.samples.at(queue.head) >= m_filterWindowSize) {
+        queue.head = (queue.head + 1) % capacity;
+        queue.count--;
     }
 
-    QVector<float> outputData;
-    outputData.append(m_inputData.at(0));
-    for (int i = 1; i < m_inputData.size(); i++) {
-        // y[i] := α * y[i-1] + α * (x[i] - x[i-1])
-        outputData.append(m_highPassAlpha * outputData.at(i - 1) + m_highPassAlpha * (m_inputData.at(i) - m_inputData.at(i - 1)));
+    // Values which can never be the extreme of the window again
+    while (queue.count > 0) {
+        quint64 back = queue.samples.at((queue.head + queue.count - 1) % capacity);
+        float backValue = inputAt(back);
+        if (minimum ? backValue < value : backValue > value)
+            break;
+
+        queue.count--;
     }
 
-    m_outputData = outputData;
-    return m_outputData.last();
+    queue.samples[(queue.head + queue.count) % capacity] = m_sampleCount;
+    queue.count++;
 }
 
-float SensorFilter::averageFilterValue(float value)
+float SensorFilter::processBiquad(float value)
 {
-    if (m_inputData.isEmpty()) {
-        addInputValue(value);
-        m_averageSum = value;
-        return value;
+    // Start in the steady state of the first value instead of ramping up from 0
+    if (m_sampleCount == 0) {
+        float steadyState = m_filterType == TypeHighPass ? 0 : value;
+        m_biquad.x1 = m_biquad.x2 = value;
+        m_biquad.y1 = m_biquad.y2 = steadyState;
+        return steadyState;
     }
 
-    if (static_cast<uint>(m_inputData.size()) >= m_filterWindowSize) {
-        m_averageSum -= m_inputData.takeFirst();
-    }
+    float result = m_biquad.b0 * value + m_biquad.b1 * m_biquad.x1 + m_biquad.b2 * m_biquad.x2 - m_biquad.a1 * m_biquad.y1 - m_biquad.a2 * m_biquad.y2;
+    m_biquad.x2 = m_biquad.x1;
+    m_biquad.x1 = value;
+    m_biquad.y2 = m_biquad.y1;
+    m_biquad.y1 = result;
+    return result;
+}
 
-    addInputValue(value);
-    m_averageSum += value;
-    return m_averageSum / m_inputData.size();
+void SensorFilter::setBiquadCoefficients(double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    m_biquad.b0 = static_cast<float>(b0 / a0);
+    m_biquad.b1 = static_cast<float>(b1 / a0);
+    m_biquad.b2 = static_cast<float>(b2 / a0);
+    m_biquad.a1 = static_cast<float>(a1 / a0);
+    m_biquad.a2 = static_cast<float>(a2 / a0);
 }
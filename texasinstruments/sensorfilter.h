@@ -34,6 +34,8 @@
 #include <QObject>
 #include <QVector>
 
+// Filters a stream of sensor values over a fixed size window. All filters and window statistics
+// are updated incrementally, so filtering a value takes constant time and never allocates.
 class SensorFilter : public QObject
 {
     Q_OBJECT
@@ -41,7 +43,9 @@ public:
     enum Type {
         TypeLowPass,
         TypeHighPass,
-        TypeAverage
+        TypeAverage,
+        TypeMinimum,
+        TypeMaximum
     };
     Q_ENUM(Type)
 
@@ -57,6 +61,11 @@ public:
     QVector<float> inputData() const;
     QVector<float> outputData() const;
 
+    // Statistics of the input values in the current window
+    float average() const;
+    float minimum() const;
+    float maximum() const;
+
     // Filter configuration
     uint windowSize() const;
     void setFilterWindowSize(uint windowSize = 20);
@@ -67,23 +76,45 @@ public:
     float highPassAlpha() const;
     void setHighPassAlpha(float alpha = 0.2f);
 
+    // Second order filters, replacing the first order alpha filter of the same type
+    void setLowPassCutoff(float cutoffFrequency, float sampleRate, float q = 0.7071f);
+    void setHighPassCutoff(float cutoffFrequency, float sampleRate, float q = 0.7071f);
+
 private:
+    // y[n] = b0 * x[n] + b1 * x[n-1] + b2 * x[n-2] - a1 * y[n-1] - a2 * y[n-2]
+    struct Biquad {
+        float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        float x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    };
+
+    // Sample numbers of the window values in monotonic order, the front is the extreme value
+    struct MonotonicQueue {
+        QVector<quint64> samples;
+        int head = 0;
+        int count = 0;
+    };
+
     Type m_filterType = TypeLowPass;
     uint m_filterWindowSize = 20;
     float m_lowPassAlpha = 0.2f;
     float m_highPassAlpha = 0.2f;
 
-    float m_averageSum = 0;
+    Biquad m_biquad;
 
+    // Ring buffers of the last window size values
     QVector<float> m_inputData;
     QVector<float> m_outputData;
+    quint64 m_sampleCount = 0;
+    double m_averageSum = 0;
 
-    void addInputValue(float value);
+    MonotonicQueue m_minimumQueue;
+    MonotonicQueue m_maximumQueue;
 
-    // Filter methods
-    float lowPassFilterValue(float value);
-    float highPassFilterValue(float value);
-    float averageFilterValue(float value);
+    int windowCount() const;
+    float inputAt(quint64 sample) const;
+    void pushMonotonic(MonotonicQueue &queue, float value, bool minimum);
+    float processBiquad(float value);
+    void setBiquadCoefficients(double b0, double b1, double b2, double a0, double a1, double a2);
 };
 
 #endif // SENSORFILTER_H
@@ -0,0 +1,8 @@
+# Incremental sensor value filters, can be included by other sensor plugins:
+# include(../texasinstruments/sensorfilter.pri)
+
+INCLUDEPATH += $$PWD
+
+HEADERS += $$PWD/sensorfilter.h
+
+SOURCES += $$PWD/sensorfilter.cpp
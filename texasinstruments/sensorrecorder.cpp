@@ -0,0 +1,218 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "sensorrecorder.h"
+#include "extern-plugininfo.h"
+
+#include <QDateTime>
+
+#include <string.h>
+#include <stddef.h>
+#include <atomic>
+
+#define RECORDER_VERSION 1
+#define RECORDER_FRAME_DATA_SIZE 20
+
+struct RecorderHeader {
+    char magic[4];
+    quint32 version;
+    quint32 slotSize;
+    quint32 slotCount;
+    quint64 frameCount;
+    quint8 reserved[40];
+};
+
+struct RecorderSlot {
+    qint64 timestamp;
+    quint8 type;
+    quint8 length;
+    quint16 reserved;
+    char data[RECORDER_FRAME_DATA_SIZE];
+};
+
+static_assert(sizeof(RecorderHeader) == 64, "Unexpected recorder header size");
+static_assert(sizeof(RecorderSlot) == 32, "Unexpected recorder slot size");
+
+static bool validHeader(const RecorderHeader *header, qint64 fileSize)
+{
+    return memcmp(header->magic, "STRC", 4) == 0
+            && header->version == RECORDER_VERSION
+            && header->slotSize == sizeof(RecorderSlot)
+            && header->slotCount > 0
+            && fileSize == static_cast<qint64>(sizeof(RecorderHeader) + static_cast<quint64>(header->slotCount) * sizeof(RecorderSlot));
+}
+
+SensorRecorder::SensorRecorder(const QString &fileName, quint32 capacity) :
+    m_file(fileName),
+    m_capacity(capacity)
+{
+
+}
+
+SensorRecorder::~SensorRecorder()
+{
+    close();
+}
+
+QString SensorRecorder::fileName() const
+{
+    return m_file.fileName();
+}
+
+bool SensorRecorder::open()
+{
+    if (m_map)
+        return true;
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qCWarning(dcTexasInstruments()) << "Could not open sensor recording" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+
+    qint64 fileSize = static_cast<qint64>(sizeof(RecorderHeader) + static_cast<quint64>(m_capacity) * sizeof(RecorderSlot));
+
+    // Continue an existing recording of the same layout, otherwise start a new one
+    RecorderHeader header;
+    bool existing = m_file.read(reinterpret_cast<char *>(&header), sizeof(header)) == sizeof(header)
+            && validHeader(&header, m_file.size())
+            && header.slotCount == m_capacity;
+
+    if (!existing && !m_file.resize(fileSize)) {
+        qCWarning(dcTexasInstruments()) << "Could not resize sensor recording" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    m_map = m_file.map(0, fileSize);
+    if (!m_map) {
+        qCWarning(dcTexasInstruments()) << "Could not map sensor recording" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    if (!existing) {
+        RecorderHeader *mappedHeader = reinterpret_cast<RecorderHeader *>(m_map);
+        memset(mappedHeader, 0, sizeof(RecorderHeader));
+        memcpy(mappedHeader->magic, "STRC", 4);
+        mappedHeader->version = RECORDER_VERSION;
+        mappedHeader->slotSize = sizeof(RecorderSlot);
+        mappedHeader->slotCount = m_capacity;
+    }
+
+    qCDebug(dcTexasInstruments()) << "Recording sensor frames to" << m_file.fileName();
+    return true;
+}
+
+void SensorRecorder::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.close();
+}
+
+bool SensorRecorder::isOpen() const
+{
+    return m_map != nullptr;
+}
+
+void SensorRecorder::record(FrameType type, const QByteArray &data)
+{
+    if (!m_map)
+        return;
+
+    RecorderHeader *header = reinterpret_cast<RecorderHeader *>(m_map);
+    RecorderSlot *slot = reinterpret_cast<RecorderSlot *>(m_map + sizeof(RecorderHeader)) + header->frameCount % m_capacity;
+
+    slot->timestamp = QDateTime::currentMSecsSinceEpoch();
+    slot->type = static_cast<quint8>(type);
+    slot->length = static_cast<quint8>(qMin(data.size(), RECORDER_FRAME_DATA_SIZE));
+    memcpy(slot->data, data.constData(), slot->length);
+
+    // The slot must be complete before the frame count publishes it
+    std::atomic_thread_fence(std::memory_order_release);
+    header->frameCount++;
+}
+
+QList<SensorRecorder::Frame> SensorRecorder::readFrames(const QString &fileName, qint64 from, qint64 to)
+{
+    QList<Frame> frames;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qCWarning(dcTexasInstruments()) << "Could not open sensor recording" << fileName << file.errorString();
+        return frames;
+    }
+
+    QByteArray content = file.readAll();
+    const RecorderHeader *header = reinterpret_cast<const RecorderHeader *>(content.constData());
+    if (content.size() < static_cast<int>(sizeof(RecorderHeader)) || !validHeader(header, content.size())) {
+        qCWarning(dcTexasInstruments()) << "Invalid sensor recording" << fileName;
+        return frames;
+    }
+
+    // The writer may have continued while the file was copied. It wrote the frames from the copied
+    // frame count up to the current one (the last one possibly incomplete), overwriting the slots of
+    // the frames one ring length before. Only frames after those are consistent in the copy.
+    quint64 currentFrameCount = header->frameCount;
+    if (file.seek(offsetof(RecorderHeader, frameCount))) {
+        file.read(reinterpret_cast<char *>(&currentFrameCount), sizeof(currentFrameCount));
+    }
+    quint64 first = header->frameCount - qMin<quint64>(header->frameCount, header->slotCount);
+    if (currentFrameCount + 1 > first + header->slotCount) {
+        first = currentFrameCount + 1 - header->slotCount;
+    }
+
+    const RecorderSlot *recordedSlots = reinterpret_cast<const RecorderSlot *>(content.constData() + sizeof(RecorderHeader));
+    for (quint64 i = first; i < header->frameCount; i++) {
+        const RecorderSlot &slot = recordedSlots[i % header->slotCount];
+        if (slot.timestamp < from || slot.timestamp > to)
+            continue;
+
+        Frame frame;
+        frame.timestamp = slot.timestamp;
+        frame.type = static_cast<FrameType>(slot.type);
+        frame.data = QByteArray(slot.data, qMin<int>(slot.length, RECORDER_FRAME_DATA_SIZE));
+        frames.append(frame);
+    }
+
+    return frames;
+}
+
+bool SensorRecorder::exportFrames(const QString &fileName, QIODevice *device, qint64 from, qint64 to)
+{
+    foreach (const Frame &frame, readFrames(fileName, from, to)) {
+        QByteArray line = QByteArray::number(frame.timestamp) + ' ' + QByteArray::number(frame.type) + ' ' + frame.data.toHex() + '\n';
+        if (device->write(line) != line.size())
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef SENSORRECORDER_H
+#define SENSORRECORDER_H
+
+#include <QFile>
+#include <QList>
+#include <QByteArray>
+
+#include <limits>
+
+// Records raw sensor characteristic frames into a memory mapped ring file of fixed size.
+//
+// File layout (host byte order):
+//   Header, 64 bytes: "STRC", quint32 version, quint32 slot size, quint32 slot count, quint64 frame count
+//   Slots, 32 bytes each: qint64 timestamp [ms since epoch], quint8 type, quint8 length, 2 reserved, 20 bytes data
+//
+// Frame n is stored in slot n % slot count. The frame count in the header is updated after the slot
+// has been written. Once the ring wraps, the writer overwrites the oldest slot while a reader may be
+// copying it, so readFrames() reads the frame count again after copying the slots and drops every
+// frame whose slot could have been overwritten in the meantime.
+class SensorRecorder
+{
+public:
+    enum FrameType {
+        FrameTypeTemperature = 1,
+        FrameTypeHumidity = 2,
+        FrameTypePressure = 3,
+        FrameTypeOptical = 4,
+        FrameTypeKeys = 5,
+        FrameTypeMovement = 6
+    };
+
+    struct Frame {
+        qint64 timestamp = 0;
+        FrameType type = FrameTypeTemperature;
+        QByteArray data;
+    };
+
+    explicit SensorRecorder(const QString &fileName, quint32 capacity = 8192);
+    ~SensorRecorder();
+
+    QString fileName() const;
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    void record(FrameType type, const QByteArray &data);
+
+    // Frames with a timestamp within [from, to], oldest first
+    static QList<Frame> readFrames(const QString &fileName, qint64 from = 0, qint64 to = std::numeric_limits<qint64>::max());
+
+    // Writes one "timestamp type hexdata" line per frame
+    static bool exportFrames(const QString &fileName, QIODevice *device, qint64 from = 0, qint64 to = std::numeric_limits<qint64>::max());
+
+private:
+    QFile m_file;
+    quint32 m_capacity = 0;
+    uchar *m_map = nullptr;
+};
+
+#endif // SENSORRECORDER_H
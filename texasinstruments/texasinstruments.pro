@@ -1,4 +1,5 @@
 include(../plugins.pri)
+include(sensorfilter.pri)
 
 QT += bluetooth
 
@@ -8,12 +9,12 @@ HEADERS += \
     integrationplugintexasinstruments.h \
     sensortag.h \
     sensordataprocessor.h \
-    sensorfilter.h
+    sensorrecorder.h
 
 SOURCES += \
     integrationplugintexasinstruments.cpp \
     sensortag.cpp \
     sensordataprocessor.cpp \
-    sensorfilter.cpp
+    sensorrecorder.cpp
 
 
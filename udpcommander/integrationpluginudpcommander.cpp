@@ -44,22 +44,46 @@ void IntegrationPluginUdpCommander::setupThing(ThingSetupInfo *info)
     qCDebug(dcUdpCommander()) << "Setup thing" << thing->name() << thing->params();
 
     if (thing->thingClassId() == udpReceiverThingClassId) {
-        QUdpSocket *udpSocket = new QUdpSocket(this);
-        int port = thing->paramValue(udpReceiverThingPortParamTypeId).toInt();
-        if (!udpSocket->bind(QHostAddress::Any, port, QUdpSocket::ShareAddress)) {
+        UdpReceiver *receiver = new UdpReceiver(this);
+        quint16 port = static_cast<quint16>(thing->paramValue(udpReceiverThingPortParamTypeId).toUInt());
+        QList<QHostAddress> multicastGroups = UdpReceiver::parseMulticastGroups(thing->setting(udpReceiverSettingsMulticastGroupsParamTypeId).toString());
+        if (!receiver->open(port, multicastGroups)) {
             qCWarning(dcUdpCommander()) << thing->name() << "cannot bind to port" << port;
-            delete udpSocket;
+            delete receiver;
             return info->finish(Thing::ThingErrorHardwareNotAvailable, QT_TR_NOOP("Error opening UDP port."));
         }
-        qCDebug(dcUdpCommander()) << "Listening on port" << port;
-
-        connect(udpSocket, SIGNAL(readyRead()), this, SLOT(readPendingDatagrams()));
-        m_receiverList.insert(udpSocket, thing);
+        configureReceiver(thing, receiver);
+
+        connect(receiver, &UdpReceiver::datagramReceived, thing, [this, thing](const QByteArray &data, const QHostAddress &sender, quint16 senderPort){
+            qCDebug(dcUdpCommander()) << "Incoming datagram" << data << "on" << thing->name() << "from" << sender.toString() << senderPort;
+            Event ev = Event(udpReceiverTriggeredEventTypeId, thing->id());
+            ParamList params;
+            params.append(Param(udpReceiverTriggeredEventDataParamTypeId, data));
+            params.append(Param(udpReceiverTriggeredEventSourceParamTypeId, QString("%1:%2").arg(sender.toString()).arg(senderPort)));
+            ev.setParams(params);
+            emit emitEvent(ev);
+        });
+        connect(receiver, &UdpReceiver::droppedCountChanged, thing, [thing](quint64 droppedCount){
+            thing->setStateValue(udpReceiverDroppedDatagramsStateTypeId, droppedCount);
+        });
+        connect(thing, &Thing::settingChanged, receiver, [this, thing, receiver, port](const ParamTypeId &paramTypeId, const QVariant &value){
+            if (paramTypeId == udpReceiverSettingsMulticastGroupsParamTypeId) {
+                if (!receiver->open(port, UdpReceiver::parseMulticastGroups(value.toString()))) {
+                    qCWarning(dcUdpCommander()) << thing->name() << "cannot bind to port" << port << "with the new multicast groups, listening without them";
+                    if (!receiver->open(port, QList<QHostAddress>())) {
+                        qCWarning(dcUdpCommander()) << thing->name() << "cannot bind to port" << port << "any more, no datagrams will be received";
+                    }
+                }
+            } else {
+                configureReceiver(thing, receiver);
+            }
+        });
+        m_receivers.insert(thing, receiver);
 
         return info->finish(Thing::ThingErrorNoError);
     } else if (thing->thingClassId() == udpCommanderThingClassId) {
         QUdpSocket *udpSocket = new QUdpSocket(this);
-        m_commanderList.insert(udpSocket, thing);
+        m_commanderSockets.insert(thing, udpSocket);
         return info->finish(Thing::ThingErrorNoError);
     }
 }
@@ -72,7 +96,7 @@ void IntegrationPluginUdpCommander::executeAction(ThingActionInfo *info)
 
     Q_ASSERT_X(action.actionTypeId() == udpCommanderTriggerActionTypeId, "UdpCommander", "Unhandled action type in UDP commander.");
 
-    QUdpSocket *udpSocket = m_commanderList.key(thing);
+    QUdpSocket *udpSocket = m_commanderSockets.value(thing);
     int port = thing->paramValue(udpCommanderThingPortParamTypeId).toInt();
     QHostAddress address = QHostAddress(thing->paramValue(udpCommanderThingAddressParamTypeId).toString());
     QByteArray data = action.param(udpCommanderTriggerActionDataParamTypeId).value().toByteArray();
@@ -85,47 +109,28 @@ void IntegrationPluginUdpCommander::executeAction(ThingActionInfo *info)
 void IntegrationPluginUdpCommander::thingRemoved(Thing *thing)
 {
     if (thing->thingClassId() == udpReceiverThingClassId) {
-        QUdpSocket *socket = m_receiverList.key(thing);
-        m_receiverList.remove(socket);
-        socket->close();
-        socket->deleteLater();
+        UdpReceiver *receiver = m_receivers.take(thing);
+        receiver->close();
+        receiver->deleteLater();
 
     } else if (thing->thingClassId() == udpCommanderThingClassId) {
-        QUdpSocket *socket = m_commanderList.key(thing);
-        m_commanderList.remove(socket);
+        QUdpSocket *socket = m_commanderSockets.take(thing);
         socket->close();
         socket->deleteLater();
     }
 }
 
-void IntegrationPluginUdpCommander::readPendingDatagrams()
+void IntegrationPluginUdpCommander::configureReceiver(Thing *thing, UdpReceiver *receiver)
 {
-    qCDebug(dcUdpCommander()) << "UDP datagram received";
-    QUdpSocket *socket= static_cast<QUdpSocket *>(sender());
-    Thing *thing = m_receiverList.value(socket);
-
-    if (!thing) {
-        qCWarning(dcUdpCommander()) << "Received a datagram from a socket we don't know";
-        return;
+    QString coalescing = thing->setting(udpReceiverSettingsCoalescingParamTypeId).toString();
+    receiver->setCoalescingInterval(thing->setting(udpReceiverSettingsCoalescingIntervalParamTypeId).toInt());
+    receiver->setMaxRate(thing->setting(udpReceiverSettingsMaxEventRateParamTypeId).toInt());
+    receiver->setConfirmDatagrams(thing->setting(udpReceiverSettingsConfirmDatagramsParamTypeId).toBool());
+    if (coalescing == "Latest per source") {
+        receiver->setCoalescingPolicy(UdpReceiver::CoalescingLatestPerSource);
+    } else if (coalescing == "Rate limit") {
+        receiver->setCoalescingPolicy(UdpReceiver::CoalescingRateLimit);
+    } else {
+        receiver->setCoalescingPolicy(UdpReceiver::CoalescingNone);
     }
-
-    QByteArray datagram;
-    QHostAddress sender;
-    quint16 senderPort = 0;
-
-    while (socket->hasPendingDatagrams()) {
-        datagram.resize(socket->pendingDatagramSize());
-        socket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
-        qCDebug(dcUdpCommander()) << "Incoming datatram" << datagram << "on" << thing->name() << "from" << sender.toString() << senderPort;
-
-        Event ev = Event(udpReceiverTriggeredEventTypeId, thing->id());
-        ParamList params;
-        params.append(Param(udpReceiverTriggeredEventDataParamTypeId, datagram));
-        ev.setParams(params);
-        emit emitEvent(ev);
-
-        // Send response for verification
-        socket->writeDatagram("OK\n", sender, senderPort);
-    }
-
 }
@@ -32,6 +32,7 @@
 #define INTEGRATIONPLUGINUDPCOMMANDER_H
 
 #include "integrations/integrationplugin.h"
+#include "udpreceiver.h"
 
 #include <QHash>
 #include <QDebug>
@@ -52,12 +53,10 @@ public:
     void executeAction(ThingActionInfo *info) override;
 
 private:
-    QHash<QUdpSocket *, Thing *> m_receiverList;
-    QHash<QUdpSocket *, Thing *> m_commanderList;
-
-private slots:
-    void readPendingDatagrams();
+    QHash<Thing *, UdpReceiver *> m_receivers;
+    QHash<Thing *, QUdpSocket *> m_commanderSockets;
 
+    void configureReceiver(Thing *thing, UdpReceiver *receiver);
 };
 
 #endif // INTEGRATIONPLUGINUDPCOMMANDER_H
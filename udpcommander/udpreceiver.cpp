@@ -0,0 +1,240 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "udpreceiver.h"
+#include "extern-plugininfo.h"
+
+// Largest possible UDP payload
+static const int maxDatagramSize = 65507;
+
+UdpReceiver::UdpReceiver(QObject *parent) :
+    QObject(parent)
+{
+    m_buffer.resize(maxDatagramSize);
+
+    m_flushTimer.setInterval(1000);
+    connect(&m_flushTimer, &QTimer::timeout, this, &UdpReceiver::flushLatest);
+
+    m_statisticsTimer.setInterval(1000);
+    connect(&m_statisticsTimer, &QTimer::timeout, this, [this](){
+        if (m_droppedCount != m_reportedDroppedCount) {
+            m_reportedDroppedCount = m_droppedCount;
+            emit droppedCountChanged(m_droppedCount);
+        }
+    });
+    m_statisticsTimer.start();
+}
+
+bool UdpReceiver::open(quint16 port, const QList<QHostAddress> &multicastGroups)
+{
+    // Datagrams waiting from the previous socket are still valid
+    flushLatest();
+    close();
+
+    // Joining IPv4 groups requires an IPv4 socket
+    bool ipv4Groups = false;
+    foreach (const QHostAddress &group, multicastGroups) {
+        if (group.protocol() == QAbstractSocket::IPv4Protocol) {
+            ipv4Groups = true;
+        }
+    }
+
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(ipv4Groups ? QHostAddress::AnyIPv4 : QHostAddress::Any, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+        qCWarning(dcUdpCommander()) << "Cannot bind to port" << port << m_socket->errorString();
+        delete m_socket;
+        m_socket = nullptr;
+        return false;
+    }
+    qCDebug(dcUdpCommander()) << "Listening on port" << port;
+
+    foreach (const QHostAddress &group, multicastGroups) {
+        if (!m_socket->joinMulticastGroup(group)) {
+            qCWarning(dcUdpCommander()) << "Cannot join multicast group" << group.toString() << m_socket->errorString();
+            continue;
+        }
+        qCDebug(dcUdpCommander()) << "Joined multicast group" << group.toString();
+    }
+
+    connect(m_socket, &QUdpSocket::readyRead, this, &UdpReceiver::readPendingDatagrams);
+    return true;
+}
+
+void UdpReceiver::close()
+{
+    if (!m_socket)
+        return;
+
+    m_socket->close();
+    m_socket->deleteLater();
+    m_socket = nullptr;
+    m_droppedCount += static_cast<quint64>(m_latest.count());
+    m_latest.clear();
+}
+
+UdpReceiver::CoalescingPolicy UdpReceiver::coalescingPolicy() const
+{
+    return m_coalescingPolicy;
+}
+
+void UdpReceiver::setCoalescingPolicy(CoalescingPolicy coalescingPolicy)
+{
+    if (m_coalescingPolicy == CoalescingLatestPerSource)
+        flushLatest();
+
+    m_coalescingPolicy = coalescingPolicy;
+    if (m_coalescingPolicy == CoalescingLatestPerSource) {
+        m_flushTimer.start();
+    } else {
+        m_flushTimer.stop();
+    }
+
+    if (m_coalescingPolicy == CoalescingRateLimit) {
+        m_tokens = m_maxRate;
+        m_lastRefill = 0;
+        m_rateTimer.start();
+    }
+}
+
+int UdpReceiver::coalescingInterval() const
+{
+    return m_flushTimer.interval();
+}
+
+void UdpReceiver::setCoalescingInterval(int coalescingInterval)
+{
+    m_flushTimer.setInterval(qMax(1, coalescingInterval));
+}
+
+int UdpReceiver::maxRate() const
+{
+    return m_maxRate;
+}
+
+void UdpReceiver::setMaxRate(int maxRate)
+{
+    m_maxRate = qMax(1, maxRate);
+    m_tokens = qMin(m_tokens, static_cast<double>(m_maxRate));
+}
+
+bool UdpReceiver::confirmDatagrams() const
+{
+    return m_confirmDatagrams;
+}
+
+void UdpReceiver::setConfirmDatagrams(bool confirmDatagrams)
+{
+    m_confirmDatagrams = confirmDatagrams;
+}
+
+quint64 UdpReceiver::droppedCount() const
+{
+    return m_droppedCount;
+}
+
+QList<QHostAddress> UdpReceiver::parseMulticastGroups(const QString &groups)
+{
+    QList<QHostAddress> addresses;
+    foreach (const QString &group, groups.split(',')) {
+        if (group.trimmed().isEmpty())
+            continue;
+
+        QHostAddress address(group.trimmed());
+        if (address.isNull() || !address.isMulticast()) {
+            qCWarning(dcUdpCommander()) << "Ignoring invalid multicast group" << group;
+            continue;
+        }
+        addresses.append(address);
+    }
+    return addresses;
+}
+
+void UdpReceiver::readPendingDatagrams()
+{
+    QHostAddress sender;
+    quint16 senderPort = 0;
+
+    while (m_socket && m_socket->hasPendingDatagrams()) {
+        qint64 size = m_socket->readDatagram(m_buffer.data(), m_buffer.size(), &sender, &senderPort);
+        if (size < 0) {
+            qCWarning(dcUdpCommander()) << "Error reading datagram" << m_socket->errorString();
+            break;
+        }
+
+        if (m_confirmDatagrams) {
+            // Send response for verification
+            m_socket->writeDatagram("OK\n", sender, senderPort);
+        }
+
+        switch (m_coalescingPolicy) {
+        case CoalescingNone:
+            emit datagramReceived(QByteArray(m_buffer.constData(), static_cast<int>(size)), sender, senderPort);
+            break;
+        case CoalescingLatestPerSource: {
+            QHash<Source, QByteArray>::iterator latest = m_latest.find(Source(sender, senderPort));
+            if (latest == m_latest.end()) {
+                latest = m_latest.insert(Source(sender, senderPort), QByteArray());
+            } else {
+                m_droppedCount++;
+            }
+
+            // Reuses the allocation of the previous datagram from this source
+            latest.value().resize(static_cast<int>(size));
+            memcpy(latest.value().data(), m_buffer.constData(), static_cast<size_t>(size));
+            break;
+        }
+        case CoalescingRateLimit: {
+            // Token bucket, refilled with maxRate tokens per second and holding at most one second worth
+            qint64 now = m_rateTimer.nsecsElapsed();
+            m_tokens = qMin(static_cast<double>(m_maxRate), m_tokens + (now - m_lastRefill) * m_maxRate / 1e9);
+            m_lastRefill = now;
+            if (m_tokens < 1) {
+                m_droppedCount++;
+                break;
+            }
+            m_tokens -= 1;
+            emit datagramReceived(QByteArray(m_buffer.constData(), static_cast<int>(size)), sender, senderPort);
+            break;
+        }
+        }
+    }
+}
+
+void UdpReceiver::flushLatest()
+{
+    if (m_latest.isEmpty())
+        return;
+
+    QHash<Source, QByteArray> latest;
+    latest.swap(m_latest);
+    for (QHash<Source, QByteArray>::const_iterator it = latest.constBegin(); it != latest.constEnd(); ++it) {
+        emit datagramReceived(it.value(), it.key().first, it.key().second);
+    }
+}
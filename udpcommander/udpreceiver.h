@@ -0,0 +1,110 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*
+* Copyright 2013 - 2020, nymea GmbH
+* Contact: contact@nymea.io
+*
+* This file is part of nymea.
+* This project including source code and documentation is protected by
+* copyright law, and remains the property of nymea GmbH. All rights, including
+* reproduction, publication, editing and translation, are reserved. The use of
+* this project is subject to the terms of a license agreement to be concluded
+* with nymea GmbH in accordance with the terms of use of nymea GmbH, available
+* under https://nymea.io/license
+*
+* GNU Lesser General Public License Usage
+* Alternatively, this project may be redistributed and/or modified under the
+* terms of the GNU Lesser General Public License as published by the Free
+* Software Foundation; version 3. This project is distributed in the hope that
+* it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this project. If not, see <https://www.gnu.org/licenses/>.
+*
+* For any further details and any questions please contact us under
+* contact@nymea.io or see our FAQ/Licensing Information on
+* https://nymea.io/license/faq
+*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef UDPRECEIVER_H
+#define UDPRECEIVER_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QTimer>
+#include <QHash>
+#include <QPair>
+#include <QElapsedTimer>
+
+// Receives datagrams on a port and optionally thins them out before they are turned into events.
+// All pending datagrams are read into one preallocated buffer per wakeup, only datagrams which
+// are passed on get copied.
+class UdpReceiver : public QObject
+{
+    Q_OBJECT
+public:
+    enum CoalescingPolicy {
+        CoalescingNone,             // Every datagram is passed on
+        CoalescingLatestPerSource,  // Only the latest datagram of each sender per coalescing interval
+        CoalescingRateLimit         // At most maxRate datagrams per second, the rest is dropped
+    };
+
+    explicit UdpReceiver(QObject *parent = nullptr);
+
+    // Binds the port and joins the given multicast groups. Coalesced datagrams are delivered
+    // and a previous binding is closed first, so the receiver is closed if this fails.
+    bool open(quint16 port, const QList<QHostAddress> &multicastGroups = QList<QHostAddress>());
+    // Coalesced datagrams which have not been delivered yet count as dropped
+    void close();
+
+    CoalescingPolicy coalescingPolicy() const;
+    void setCoalescingPolicy(CoalescingPolicy coalescingPolicy);
+
+    int coalescingInterval() const;
+    void setCoalescingInterval(int coalescingInterval);
+
+    int maxRate() const;
+    void setMaxRate(int maxRate);
+
+    bool confirmDatagrams() const;
+    void setConfirmDatagrams(bool confirmDatagrams);
+
+    quint64 droppedCount() const;
+
+    // Parses a comma separated list of multicast addresses
+    static QList<QHostAddress> parseMulticastGroups(const QString &groups);
+
+signals:
+    void datagramReceived(const QByteArray &data, const QHostAddress &sender, quint16 senderPort);
+    // Emitted at most once per second
+    void droppedCountChanged(quint64 droppedCount);
+
+private slots:
+    void readPendingDatagrams();
+    void flushLatest();
+
+private:
+    typedef QPair<QHostAddress, quint16> Source;
+
+    QUdpSocket *m_socket = nullptr;
+    QByteArray m_buffer;
+
+    CoalescingPolicy m_coalescingPolicy = CoalescingNone;
+    bool m_confirmDatagrams = true;
+
+    QHash<Source, QByteArray> m_latest;
+    QTimer m_flushTimer;
+
+    int m_maxRate = 10;
+    double m_tokens = 0;
+    QElapsedTimer m_rateTimer;
+    qint64 m_lastRefill = 0;
+
+    quint64 m_droppedCount = 0;
+    quint64 m_reportedDroppedCount = 0;
+    QTimer m_statisticsTimer;
+};
+
+#endif // UDPRECEIVER_H